@@ -22,6 +22,7 @@
 #include "dosbox.h"
 
 #include <stdio.h>
+#include <vector>
 
 class Section;
 enum OPL_Mode {
@@ -48,6 +49,28 @@ extern Bit8u adlib_commandreg;
 FILE * OpenCaptureFile(const char * type,const char * ext);
 
 void CAPTURE_AddWave(Bit32u freq, Bit32u len, Bit16s * data);
+void CAPTURE_WaveStart();
+
+// The wave, MIDI, OPL, and video capture sinks hand their file operations to
+// a writer thread, which performs them in the order they were queued. Only
+// the emulation thread may queue operations.
+class FlacEncoder;
+
+struct CaptureBlock {
+	enum class Action { Append, WriteAt, Close, EncodeFlac, FinishFlac, EncodeVideo };
+
+	Action action = Action::Append;
+	FILE *handle = nullptr;
+	long offset = 0;    // WriteAt only
+	FlacEncoder *flac_encoder = nullptr; // EncodeFlac and FinishFlac only
+	size_t size = 0;    // bytes used in data, which keeps its capacity
+	std::vector<uint8_t> data = {};
+};
+
+void CAPTURE_QueueWrite(FILE *handle, const void *data, size_t size);
+void CAPTURE_QueueWriteAt(FILE *handle, long offset, const void *data, size_t size);
+void CAPTURE_QueueClose(FILE *handle); // after the handle's pending writes
+void CAPTURE_FlushWrites(); // waits until all queued operations are done
 
 #define CAPTURE_FLAG_DBLW	0x1
 #define CAPTURE_FLAG_DBLH	0x2
@@ -25,6 +25,7 @@
 #include "dosbox.h"
 
 #include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string_view>
@@ -101,6 +102,26 @@ public:
 	bool IsInterpolated() const;
 	using apply_level_callback_f = std::function<void(const AudioFrame &level)>;
 	void RegisterLevelCallBack(apply_level_callback_f cb);
+
+	// Channels fed by a render thread report how many of their ring's
+	// buffers are queued for the mixer, which MIXER /STATS tracks
+	struct QueueDepth {
+		size_t queued = 0;
+		size_t capacity = 0;
+	};
+	using queue_depth_callback_f = std::function<QueueDepth()>;
+	void RegisterQueueDepthCallBack(queue_depth_callback_f cb);
+
+	// Sampled at each mix while the channel is enabled
+	struct Stats {
+		uint32_t mixes = 0;
+		int64_t total_lag = 0; // frames the channel trailed the mixer by
+		int peak_lag = 0;
+		int64_t total_queued = 0;
+		size_t min_queued = SIZE_MAX;
+		size_t peak_queued = 0;
+		size_t queue_capacity = 0;
+	};
 	void SetVolume(float _left, float _right);
 	void SetScale(float f);
 	void SetScale(float _left, float _right);
@@ -139,9 +160,21 @@ public:
 	void Enable(bool should_enable);
 	void FlushSamples();
 
+	// Channels configured to sleep stop calling their handler once their
+	// output has held a steady level, whether silence or a DC offset, and
+	// their device has been idle for a few seconds.
+	// Devices call WakeUp() on port access to re-enable a sleeping (or
+	// disabled) channel, which then fades in. Returns true if it was
+	// asleep.
+	void ConfigureSleep(bool should_sleep);
+	bool WakeUp();
+
 	float volmain[2] = {1.0f, 1.0f};
 	std::atomic<int> done = 0; // Timing on how many samples have been done by the mixer
 	bool is_enabled = false;
+	// Only touched on the emulation thread: Mix() updates them without a
+	// lock, and MIXER /STATS reads them from the same thread
+	Stats stats = {};
 
 private:
 	// prevent default construction, copying, and assignment
@@ -149,6 +182,8 @@ private:
 	MixerChannel(const MixerChannel &) = delete;
 	MixerChannel &operator=(const MixerChannel &) = delete;
 
+	void MaybeSleep();
+
 	Envelope envelope;
 	MIXER_Handler handler = nullptr;
 	int freq_add = 0u;           // This gets added the frequency counter each mixer step
@@ -192,17 +227,33 @@ private:
 	// in-place of scaling by volmain[]
 	apply_level_callback_f apply_level = nullptr;
 
+	queue_depth_callback_f queue_depth = nullptr;
+
 	bool interpolate = false;
 	bool last_samples_were_stereo = false;
 	bool last_samples_were_silence = true;
+
+	// Sleep state, see ConfigureSleep()
+	uint32_t last_active_ticks = 0;
+	bool can_sleep = false;
+	bool had_signal = false;
 };
 using mixer_channel_t = std::shared_ptr<MixerChannel>;
 
 mixer_channel_t MIXER_AddChannel(MIXER_Handler handler, const int freq, const char *name);
 mixer_channel_t MIXER_FindChannel(const char *name);
 
+// Renders without an audio device, as the offline setting does, but without
+// starting an audio capture. Takes over from the running mixer, if any.
+void MIXER_StartOffline();
+
 /* PC Speakers functions, tightly related to the timer functions */
 void PCSPEAKER_SetCounter(int cntr, int mode);
 void PCSPEAKER_SetType(int mode);
 
+// Renders the speaker's output for the current tick straight into out,
+// bypassing the mixer and the idle fade-out. The unit tests use this to
+// compare the renderers.
+void PCSPEAKER_Render(uint16_t frames, int16_t *out);
+
 #endif
@@ -48,6 +48,7 @@ class PageDirectory;
 #define PFLAG_NOCODE		0x10			//No dynamic code can be generated here
 #define PFLAG_INIT			0x20			//No dynamic code can be generated here
 #define PFLAG_HASCODE16		0x40			//Page contains 16-bit dynamic code
+#define PFLAG_SPANWRITE		0x80			//String writes can be handed over as spans
 #define PFLAG_HASCODE		(PFLAG_HASCODE32|PFLAG_HASCODE16)
 
 #define LINK_START	((1024+64)/4)			//Start right after the HMA
@@ -73,6 +74,10 @@ public:
 	virtual bool writeb_checked(PhysPt addr, uint8_t val);
 	virtual bool writew_checked(PhysPt addr, uint16_t val);
 	virtual bool writed_checked(PhysPt addr, uint32_t val);
+	// Writes count bytes to ascending addresses within the page, the same
+	// as writeb for each; handlers flagged with PFLAG_SPANWRITE take
+	// these from the string instructions
+	virtual void write_span(PhysPt addr, const uint8_t *data, size_t count);
 
 	Bitu flags = 0x0;
 };
@@ -84,6 +84,9 @@ struct Render_t {
 		uint32_t inHeight = 0;
 		uint32_t inLine = 0;
 		uint32_t outLine = 0;
+		// More than one defers the complex scaler to the end of the
+		// frame, where it runs over this many bands in parallel
+		uint32_t bands = 0;
 	} scale = {};
 #if C_OPENGL
 	char *shader_src = nullptr;
@@ -0,0 +1,228 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_RWRING_H
+#define DOSBOX_RWRING_H
+
+#include "dosbox.h"
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+RWRing is a single-producer, single-consumer ring of pre-allocated blocks.
+
+Unlike the RWQueue, blocks are never moved or re-allocated: the producer fills
+a block in-place and publishes it, and the consumer reads it in-place and then
+hands it back. Publishing and handing back are lock-free; a thread only parks
+on the ring's mutex when the ring is full (producer) or empty (consumer).
+
+Producer:
+  while (auto block = ring.BeginWrite()) {
+  	fill(*block);
+  	ring.EndWrite();
+  }
+
+Consumer:
+  if (const auto block = ring.BeginRead()) {
+  	play(*block);
+  	ring.EndRead();
+  }
+
+Stop() releases both sides, after which BeginWrite() and BeginRead() return
+nullptr. Reset() re-arms the ring once neither side is using it.
+*/
+
+template <typename T>
+class RWRing {
+private:
+	std::vector<T> blocks = {};
+	const size_t capacity = 0;
+
+	// Running block counts; only the producer advances 'written' and only
+	// the consumer advances 'read'.
+	std::atomic<size_t> written = {0};
+	std::atomic<size_t> read = {0};
+
+	// Slow-path only: used when one side has to wait for the other
+	std::mutex mutex = {};
+	std::condition_variable has_changed = {};
+	std::atomic_bool producer_waiting = {false};
+	std::atomic_bool consumer_waiting = {false};
+	std::atomic_bool is_stopped = {false};
+
+	// Before parking on the mutex, a waiting side yields this many times
+	// in case the other side is just about to finish its block
+	static constexpr int yields_before_parking = 32;
+
+	template <typename Predicate>
+	void WaitUntil(std::atomic_bool &waiting, Predicate is_ready);
+	void Notify(const std::atomic_bool &waiting);
+
+public:
+	RWRing() = delete;
+	RWRing(const RWRing<T> &other) = delete;
+	RWRing<T> &operator=(const RWRing<T> &other) = delete;
+
+	// Each block starts as a copy of the prototype
+	RWRing(size_t ring_capacity, const T &prototype = T());
+
+	bool IsEmpty() const;
+	size_t Size() const;
+	size_t MaxCapacity() const;
+
+	// Producer side
+	T *BeginWrite(); // waits for a free block; nullptr once stopped
+	void EndWrite(); // publishes the block returned by BeginWrite
+
+	// Consumer side
+	const T *BeginRead(); // waits for a published block; nullptr once stopped
+	void EndRead(); // hands the block returned by BeginRead back
+
+	void Stop();
+	void Reset();
+};
+
+// The ring is defined here rather than explicitly instantiated, so each user
+// can fill it with its own block type
+
+template <typename T>
+RWRing<T>::RWRing(size_t ring_capacity, const T &prototype)
+        : blocks(ring_capacity, prototype),
+          capacity(ring_capacity)
+{
+	assert(capacity > 0);
+}
+
+template <typename T>
+size_t RWRing<T>::Size() const
+{
+	const auto num_read = read.load(std::memory_order_acquire);
+	return written.load(std::memory_order_acquire) - num_read;
+}
+
+template <typename T>
+size_t RWRing<T>::MaxCapacity() const
+{
+	return capacity;
+}
+
+template <typename T>
+bool RWRing<T>::IsEmpty() const
+{
+	return !Size();
+}
+
+// The waiting flag is raised before the counts are re-checked, and the other
+// side advances its count before checking the flag. Both use sequentially
+// consistent operations, so at least one of them sees the other's change and
+// a wake-up can't be lost.
+template <typename T>
+template <typename Predicate>
+void RWRing<T>::WaitUntil(std::atomic_bool &waiting, Predicate is_ready)
+{
+	for (int i = 0; i < yields_before_parking; ++i) {
+		std::this_thread::yield();
+		if (is_ready() || is_stopped)
+			return;
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	waiting = true;
+	has_changed.wait(lock, [&] { return is_ready() || is_stopped; });
+	waiting = false;
+}
+
+template <typename T>
+void RWRing<T>::Notify(const std::atomic_bool &waiting)
+{
+	if (!waiting)
+		return;
+	// Taking the lock guarantees the waiter is inside wait()
+	{
+		const std::lock_guard<std::mutex> lock(mutex);
+	}
+	has_changed.notify_one();
+}
+
+template <typename T>
+T *RWRing<T>::BeginWrite()
+{
+	const auto num_written = written.load(std::memory_order_relaxed);
+	auto has_room = [&] { return num_written - read.load() < capacity; };
+
+	if (num_written - read.load(std::memory_order_acquire) >= capacity)
+		WaitUntil(producer_waiting, has_room);
+
+	if (is_stopped)
+		return nullptr;
+	return &blocks[num_written % capacity];
+}
+
+template <typename T>
+void RWRing<T>::EndWrite()
+{
+	written.fetch_add(1);
+	Notify(consumer_waiting);
+}
+
+template <typename T>
+const T *RWRing<T>::BeginRead()
+{
+	const auto num_read = read.load(std::memory_order_relaxed);
+	auto has_items = [&] { return written.load() != num_read; };
+
+	if (written.load(std::memory_order_acquire) == num_read)
+		WaitUntil(consumer_waiting, has_items);
+
+	if (is_stopped)
+		return nullptr;
+	return &blocks[num_read % capacity];
+}
+
+template <typename T>
+void RWRing<T>::EndRead()
+{
+	read.fetch_add(1);
+	Notify(producer_waiting);
+}
+
+template <typename T>
+void RWRing<T>::Stop()
+{
+	{
+		const std::lock_guard<std::mutex> lock(mutex);
+		is_stopped = true;
+	}
+	has_changed.notify_all();
+}
+
+template <typename T>
+void RWRing<T>::Reset()
+{
+	written = 0;
+	read = 0;
+	is_stopped = false;
+}
+
+#endif
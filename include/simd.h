@@ -0,0 +1,51 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_SIMD_H
+#define DOSBOX_SIMD_H
+
+// Picks the vector instruction set the compiler targets and pulls in its
+// intrinsics. Code paths test these instead of the compiler's own macros:
+//
+//   SIMD_AVX2 - x86 with AVX2; SIMD_SSE2 is defined alongside it
+//   SIMD_SSE2 - x86 with SSE2, which every x86-64 target has
+//   SIMD_NEON - little-endian ARM with NEON
+//
+// SIMD_SSE2 and SIMD_NEON are never both defined, and none of them are when
+// the target has neither, in which case callers fall back to scalar code.
+// NEON is left out on big-endian hosts because the vector paths load pixels
+// and samples as lanes in host memory order.
+
+#include "config.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_AVX2 1
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SIMD_SSE2 1
+#elif defined(__ARM_NEON) && !defined(WORDS_BIGENDIAN)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#endif
+
+#endif
@@ -133,6 +133,11 @@ private:
 
 	void Release() noexcept;
 
+	void ScaleWithoutNewPeaks(const std::vector<float> &in,
+	                          uint16_t frames,
+	                          const AudioFrame &prescalars,
+	                          std::vector<int16_t> &out) noexcept;
+
 	void SaveTailFrame(uint16_t req_frames,
 	                   const std::vector<int16_t> &out) noexcept;
 
@@ -206,6 +206,16 @@ struct VGA_Draw {
 	} cursor = {};
 	Drawmode mode = {};
 	bool vret_triggered = false;
+	// Changed along with the font, palette or attributes that text mode
+	// lines are drawn from, so the cached lines are drawn again
+	uint32_t text_generation = 0;
+	struct {
+		// Frames in a row without a mid-frame register write
+		uint32_t quiet_frames = 0;
+		// The current frame is drawn in one go at display end
+		bool active = false;
+		double draw_skip = 0;
+	} batch = {};
 };
 
 struct VGA_HWCURSOR {
@@ -482,6 +492,15 @@ void VGA_StartResize(Bitu delay=50);
 void VGA_SetupDrawing(uint32_t val);
 void VGA_CheckScanLength(void);
 void VGA_ChangedBank(void);
+/* Writes through the graphics controller to the planes at a planar address,
+ * a byte at a time or a span of bytes to ascending addresses */
+void VGA_PlanarWrite(PhysPt start, uint8_t val);
+void VGA_PlanarWriteSpan(PhysPt start, const uint8_t *data, size_t count);
+/* Called on writes to the registers that change the picture; a write while the
+ * frame is displayed stops frames being drawn in one go at display end */
+void VGA_NoteRegisterWrite();
+/* Turns drawing quiet frames in one go at display end on or off */
+void VGA_SetFrameBatching(bool enabled);
 
 /* Some DAC/Attribute functions */
 void VGA_DAC_CombineColor(Bit8u attr,Bit8u pal);
@@ -502,6 +521,8 @@ void VGA_SetupGFX(void);
 void VGA_SetupSEQ(void);
 void VGA_SetupOther(void);
 void VGA_SetupXGA(void);
+/* Turns the row at a time XGA rectangle, blit, and pattern paths on or off */
+void XGA_SetBulkDraw(bool enabled);
 void VGA_AddCompositeSettings(Config &conf);
 
 /* Some Support Functions */
@@ -0,0 +1,74 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef DOSBOX_WORKER_POOL_H
+#define DOSBOX_WORKER_POOL_H
+
+#include "dosbox.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of threads that split a batch of independent jobs with the
+// calling thread. Run() hands out job numbers until they're all taken and
+// returns once every job has finished, so the caller can treat it like a
+// parallel for-loop.
+class WorkerPool {
+public:
+	using job_f = std::function<void(int job)>;
+
+	// Starts num_threads - 1 workers; the calling thread is the last one
+	WorkerPool(int num_threads, const char *thread_name);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool &) = delete;
+	WorkerPool &operator=(const WorkerPool &) = delete;
+
+	int NumThreads() const { return static_cast<int>(workers.size()) + 1; }
+
+	// Runs job(0) through job(num_jobs - 1) and waits for all of them
+	void Run(int num_jobs, const job_f &job);
+
+	// A thread count suited to the host, up to the given maximum
+	static int DefaultNumThreads(int max_threads);
+
+private:
+	void Work();
+	void RunJobs();
+
+	std::vector<std::thread> workers = {};
+	std::mutex mutex = {};
+	std::condition_variable has_jobs = {};
+	std::condition_variable jobs_done = {};
+
+	// Guarded by the mutex
+	const job_f *current_job = nullptr;
+	int num_jobs = 0;
+	int next_job = 0;
+	int unfinished_jobs = 0;
+	uint32_t batch = 0;
+	bool should_quit = false;
+};
+
+#endif
@@ -18,8 +18,77 @@
 
 #include "../string_ops.h"
 
+#include <algorithm>
+
+#include "paging.h"
+
 #define LoadD(_BLAH) _BLAH
 
+/* Forward STOS and MOVS into pages whose handler takes span writes, such as
+ * the planar VGA modes, hand it up to a page of bytes at a time rather than
+ * element by element. Takes the elements written off count, and returns how
+ * many of the rest to write the regular way before trying again: one if it
+ * stopped at an element split by a page or index wrap, or at a page not yet
+ * in the TLB, as writing to it links the page, and otherwise those up to the
+ * end of the destination page that stopped it. */
+static uint32_t DoStringSpans(const STRING_OP type, const PhysPt di_base,
+                              uint32_t &di_index, const PhysPt si_base,
+                              uint32_t &si_index, const uint32_t add_mask,
+                              uint32_t &count, const uint32_t size)
+{
+	const bool movs = (type >= R_MOVSB && type <= R_MOVSD);
+	uint8_t fill[MEM_PAGE_SIZE];
+	bool fill_ready = false;
+	bool one_element = false;
+	while (count) {
+		const PhysPt dst = di_base + di_index;
+		if (get_tlb_write(dst))
+			break;
+		PageHandler *handler = get_tlb_writehandler(dst);
+		if (!(handler->flags & PFLAG_SPANWRITE)) {
+			one_element = (handler->flags & PFLAG_INIT) != 0;
+			break;
+		}
+		uint64_t bytes = std::min<uint64_t>(uint64_t{count} * size,
+		                                    MEM_PAGE_SIZE - (dst & (MEM_PAGE_SIZE - 1)));
+		bytes = std::min<uint64_t>(bytes, uint64_t{add_mask} - di_index + 1);
+		const uint8_t *data = fill;
+		if (movs) {
+			const PhysPt src_addr = si_base + si_index;
+			const HostPt src = get_tlb_read(src_addr);
+			if (!src) {
+				one_element = (get_tlb_readhandler(src_addr)->flags &
+				               PFLAG_INIT) != 0;
+				break;
+			}
+			data = src + src_addr;
+			bytes = std::min<uint64_t>(bytes, MEM_PAGE_SIZE - (src_addr & (MEM_PAGE_SIZE - 1)));
+			bytes = std::min<uint64_t>(bytes, uint64_t{add_mask} - si_index + 1);
+		} else if (!fill_ready) {
+			const uint32_t val = (type == R_STOSB) ? reg_al
+			                     : (type == R_STOSW) ? reg_ax : reg_eax;
+			for (size_t i = 0; i < sizeof(fill); ++i)
+				fill[i] = static_cast<uint8_t>(val >> (8 * (i % size)));
+			fill_ready = true;
+		}
+		bytes -= bytes % size;
+		if (!bytes) {
+			one_element = true;
+			break;
+		}
+		const auto n = static_cast<uint32_t>(bytes);
+		handler->write_span(dst, data, n);
+		di_index = (di_index + n) & add_mask;
+		if (movs)
+			si_index = (si_index + n) & add_mask;
+		count -= n / size;
+	}
+	if (one_element)
+		return std::min(count, 1u);
+	const PhysPt page_left = MEM_PAGE_SIZE - ((di_base + di_index) & (MEM_PAGE_SIZE - 1));
+	return std::min(count, (page_left + size - 1) / size);
+}
+
 static void DoString(STRING_OP type) {
 	const auto si_base = BaseDS;
 	const auto di_base = SegBase(es);
@@ -92,46 +161,88 @@ static void DoString(STRING_OP type) {
 		}
 		break;
 	case R_STOSB:
-		for (;count>0;count--) {
-			SaveMb(di_base+di_index,reg_al);
-			di_index=(di_index+add_index) & add_mask;
+		while (count > 0) {
+			auto elements = count;
+			if (add_index > 0)
+				elements = DoStringSpans(type, di_base, di_index,
+				                         si_base, si_index,
+				                         add_mask, count, 1);
+			for (count -= elements; elements > 0; elements--) {
+				SaveMb(di_base+di_index,reg_al);
+				di_index=(di_index+add_index) & add_mask;
+			}
 		}
 		break;
 	case R_STOSW:
 		add_index *= 2;
-		for (;count>0;count--) {
-			SaveMw(di_base+di_index,reg_ax);
-			di_index=(di_index+add_index) & add_mask;
+		while (count > 0) {
+			auto elements = count;
+			if (add_index > 0)
+				elements = DoStringSpans(type, di_base, di_index,
+				                         si_base, si_index,
+				                         add_mask, count, 2);
+			for (count -= elements; elements > 0; elements--) {
+				SaveMw(di_base+di_index,reg_ax);
+				di_index=(di_index+add_index) & add_mask;
+			}
 		}
 		break;
 	case R_STOSD:
 		add_index *= 4;
-		for (;count>0;count--) {
-			SaveMd(di_base+di_index,reg_eax);
-			di_index=(di_index+add_index) & add_mask;
+		while (count > 0) {
+			auto elements = count;
+			if (add_index > 0)
+				elements = DoStringSpans(type, di_base, di_index,
+				                         si_base, si_index,
+				                         add_mask, count, 4);
+			for (count -= elements; elements > 0; elements--) {
+				SaveMd(di_base+di_index,reg_eax);
+				di_index=(di_index+add_index) & add_mask;
+			}
 		}
 		break;
 	case R_MOVSB:
-		for (;count>0;count--) {
-			SaveMb(di_base+di_index,LoadMb(si_base+si_index));
-			di_index=(di_index+add_index) & add_mask;
-			si_index=(si_index+add_index) & add_mask;
+		while (count > 0) {
+			auto elements = count;
+			if (add_index > 0)
+				elements = DoStringSpans(type, di_base, di_index,
+				                         si_base, si_index,
+				                         add_mask, count, 1);
+			for (count -= elements; elements > 0; elements--) {
+				SaveMb(di_base+di_index,LoadMb(si_base+si_index));
+				di_index=(di_index+add_index) & add_mask;
+				si_index=(si_index+add_index) & add_mask;
+			}
 		}
 		break;
 	case R_MOVSW:
 		add_index *= 2;
-		for (;count>0;count--) {
-			SaveMw(di_base+di_index,LoadMw(si_base+si_index));
-			di_index=(di_index+add_index) & add_mask;
-			si_index=(si_index+add_index) & add_mask;
+		while (count > 0) {
+			auto elements = count;
+			if (add_index > 0)
+				elements = DoStringSpans(type, di_base, di_index,
+				                         si_base, si_index,
+				                         add_mask, count, 2);
+			for (count -= elements; elements > 0; elements--) {
+				SaveMw(di_base+di_index,LoadMw(si_base+si_index));
+				di_index=(di_index+add_index) & add_mask;
+				si_index=(si_index+add_index) & add_mask;
+			}
 		}
 		break;
 	case R_MOVSD:
 		add_index *= 4;
-		for (;count>0;count--) {
-			SaveMd(di_base+di_index,LoadMd(si_base+si_index));
-			di_index=(di_index+add_index) & add_mask;
-			si_index=(si_index+add_index) & add_mask;
+		while (count > 0) {
+			auto elements = count;
+			if (add_index > 0)
+				elements = DoStringSpans(type, di_base, di_index,
+				                         si_base, si_index,
+				                         add_mask, count, 4);
+			for (count -= elements; elements > 0; elements--) {
+				SaveMd(di_base+di_index,LoadMd(si_base+si_index));
+				di_index=(di_index+add_index) & add_mask;
+				si_index=(si_index+add_index) & add_mask;
+			}
 		}
 		break;
 	case R_LODSB:
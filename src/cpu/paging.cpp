@@ -110,6 +110,11 @@ bool PageHandler::writed_checked(PhysPt addr, uint32_t val)
 {
 	writed(addr,val);	return false;
 }
+void PageHandler::write_span(PhysPt addr, const uint8_t *data, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+		writeb(addr + static_cast<PhysPt>(i), data[i]);
+}
 
 struct PF_Entry {
 	Bitu cs;
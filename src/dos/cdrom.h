@@ -24,13 +24,16 @@
 
 #include "dosbox.h"
 
+#include <condition_variable>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <SDL.h>
@@ -222,6 +225,10 @@ private:
 		virtual int      getLength() = 0;
 		virtual void setAudioPosition(uint32_t pos) = 0;
 		const Bit16u chunkSize = 0;
+
+		// Held while reading or decoding, which can happen concurrently
+		// on the main thread and the audio decoder thread
+		std::mutex mutex = {};
 	};
 
 	class BinaryFile final : public TrackFile {
@@ -273,6 +280,48 @@ private:
 		Sound_Sample *sample = nullptr;
 	};
 
+	// Decodes the playing track ahead of the play position on a
+	// background thread, so seeks and slow codecs don't stall the mixer.
+	class AudioDecoder {
+	public:
+		enum class Status { Playing, Buffering, TrackEnded, Failed };
+
+		AudioDecoder() = default;
+		AudioDecoder(const AudioDecoder &) = delete;
+		AudioDecoder &operator=(const AudioDecoder &) = delete;
+		~AudioDecoder() { ShutDown(); }
+
+		void SetWindow(uint32_t milliseconds);
+		void Play(const std::shared_ptr<TrackFile> &track_file,
+		          uint32_t byte_offset);
+		void Stop();
+		uint32_t Read(int16_t *buffer, uint32_t desired_frames, Status &status);
+		void ShutDown();
+
+	private:
+		void Decode();
+		void ReportHealth();
+
+		std::thread thread = {};
+		std::mutex mutex = {};
+		std::condition_variable has_work = {};
+		std::shared_ptr<TrackFile> file = nullptr;
+		std::vector<int16_t> ring = {}; // decoded samples
+		size_t ring_pos = 0;            // read position in samples
+		size_t ring_fill = 0;           // decoded samples ahead of it
+		size_t lowest_fill = 0;         // since the last play request
+		uint32_t window_ms = 500;
+		uint32_t seek_offset = 0;
+		uint32_t generation = 0; // bumped by every play and stop request
+		uint32_t underruns = 0;
+		uint32_t decoded_frames = 0;
+		uint8_t channels = REDBOOK_CHANNELS;
+		bool is_seek_pending = false;
+		bool has_track_ended = false;
+		bool has_failed = false;
+		bool keep_decoding = false;
+	};
+
 public:
 	// Nested struct definition
 	struct Track {
@@ -306,6 +355,8 @@ public:
 	bool	LoadUnloadMedia         (bool unload);
 	bool	ReadSector              (uint8_t *buffer, const bool raw, const uint32_t sector);
 	bool	HasDataTrack            ();
+	static void ConfigureDecoder(uint32_t window_ms);
+	static void ShutDownDecoder();
 	static CDROM_Interface_Image* images[26];
 
 private:
@@ -320,6 +371,7 @@ private:
 		uint32_t                 startSector        = 0;
 		uint32_t                 totalRedbookFrames = 0;
 		int16_t                  buffer[MIXER_BUFSIZE * REDBOOK_CHANNELS] = {0};
+		AudioDecoder             decoder            = {};
 		bool                     isPlaying          = false;
 		bool                     isPaused           = false;
 	} player;
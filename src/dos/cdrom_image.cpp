@@ -41,6 +41,7 @@
 #include <cstring>
 #endif
 
+#include "cross.h"
 #include "drives.h"
 #include "fs_utils.h"
 #include "setup.h"
@@ -720,16 +721,9 @@ bool CDROM_Interface_Image::PlayAudioSector(uint32_t start, uint32_t len)
 	const auto sector_offset = start - track->start;
 	const auto byte_offset = track->skip + sector_offset * track->sectorSize;
 
-	// Guard: Bail if our track could not be seeked
-	if (!track_file->seek(byte_offset)) {
-		LOG_MSG("CDROM: Track %d failed to seek to byte %u, so cancelling playback",
-		        track->number, byte_offset);
-		StopAudio();
-		return false;
-	}
-
-	// We're performing an audio-task, so update the audio position
-	track_file->setAudioPosition(byte_offset);
+	// Hand the seek to the decoder, which then starts decoding ahead of
+	// the play position. A failed seek cancels playback from the callback.
+	player.decoder.Play(track_file, byte_offset);
 
 	// Get properties about the current track
 	const uint8_t track_channels = track_file->getChannels();
@@ -809,6 +803,7 @@ bool CDROM_Interface_Image::StopAudio(void)
 {
 	player.isPlaying = false;
 	player.isPaused = false;
+	player.decoder.Stop();
 	if (player.channel)
 		player.channel->Enable(false);
 #ifdef DEBUG
@@ -972,6 +967,7 @@ bool CDROM_Interface_Image::ReadSector(uint8_t *buffer, const bool raw, const ui
 	        length);
 #endif
 #endif
+	const std::lock_guard<std::mutex> lock(track->file->mutex);
 	return track->file->read(buffer, offset, length);
 }
 
@@ -1011,17 +1007,29 @@ void CDROM_Interface_Image::CDAudioCallBack(uint16_t desired_track_frames)
 		return;
 	}
 
-	const uint32_t decoded_track_frames = track_file->decode(player.buffer,
-	                                                         static_cast<uint32_t>(desired_track_frames));
+	auto status = AudioDecoder::Status::Playing;
+	const uint32_t decoded_track_frames = player.decoder.Read(player.buffer,
+	                                                          desired_track_frames,
+	                                                          status);
 	player.playedTrackFrames += decoded_track_frames;
 
 	/**
 	 *  Uses either the stereo or mono and native or nonnative
 	 *  AddSamples call assigned during construction
 	 */
-	(player.channel.get()->*player.addFrames)(decoded_track_frames, player.buffer);
+	if (decoded_track_frames)
+		(player.channel.get()->*player.addFrames)(decoded_track_frames,
+		                                          player.buffer);
 
-	if (player.playedTrackFrames >= player.totalTrackFrames) {
+	if (status == AudioDecoder::Status::Failed) {
+		player.cd->StopAudio();
+
+	} else if (status == AudioDecoder::Status::Buffering) {
+		// The decoder hasn't caught up yet (typically just after a
+		// seek), so pad with silence rather than stalling the mixer.
+		player.channel->AddSilence();
+
+	} else if (player.playedTrackFrames >= player.totalTrackFrames) {
 #ifdef DEBUG
 		LOG_MSG("CDROM: CDAudioCallBack stopping because "
 		"playedTrackFrames (%u) >= totalTrackFrames (%u)",
@@ -1029,7 +1037,8 @@ void CDROM_Interface_Image::CDAudioCallBack(uint16_t desired_track_frames)
 #endif
 		player.cd->StopAudio();
 
-	} else if (decoded_track_frames == 0) {
+	} else if (status == AudioDecoder::Status::TrackEnded &&
+	           decoded_track_frames == 0) {
 		// Our track has run dry but we still have more music left to play!
 		const double percent_played = static_cast<double>(
 		                              player.playedTrackFrames)
@@ -1046,6 +1055,210 @@ void CDROM_Interface_Image::CDAudioCallBack(uint16_t desired_track_frames)
 	}
 }
 
+// The decoder works in chunks of this many track frames
+constexpr uint32_t DECODE_CHUNK_FRAMES = 2048;
+
+void CDROM_Interface_Image::AudioDecoder::SetWindow(const uint32_t milliseconds)
+{
+	const std::lock_guard<std::mutex> lock(mutex);
+	window_ms = milliseconds;
+}
+
+void CDROM_Interface_Image::AudioDecoder::Play(const std::shared_ptr<TrackFile> &track_file,
+                                               const uint32_t byte_offset)
+{
+	const std::lock_guard<std::mutex> lock(mutex);
+	ReportHealth();
+
+	++generation;
+	file = track_file;
+	seek_offset = byte_offset;
+	is_seek_pending = true;
+	has_track_ended = false;
+	has_failed = false;
+
+	// Size the ring to hold the decode-ahead window at the track's rate
+	channels = std::max(track_file->getChannels(), static_cast<uint8_t>(1));
+	const auto window_frames = std::max(window_ms * track_file->getRate() / 1000,
+	                                    DECODE_CHUNK_FRAMES * 2);
+	ring.resize(window_frames * channels);
+	ring_pos = 0;
+	ring_fill = 0;
+	lowest_fill = ring.size();
+
+	if (!thread.joinable()) {
+		keep_decoding = true;
+		thread = std::thread(&AudioDecoder::Decode, this);
+		set_thread_name(thread, "dosbox:cdaudio");
+	}
+	has_work.notify_one();
+}
+
+void CDROM_Interface_Image::AudioDecoder::Stop()
+{
+	const std::lock_guard<std::mutex> lock(mutex);
+	ReportHealth();
+
+	++generation;
+	file.reset();
+	is_seek_pending = false;
+	ring_fill = 0;
+}
+
+// Copies up to the desired frames from the ring into the buffer, and returns
+// the number of frames copied. Never waits on the decoder.
+uint32_t CDROM_Interface_Image::AudioDecoder::Read(int16_t *buffer,
+                                                   const uint32_t desired_frames,
+                                                   Status &status)
+{
+	const std::lock_guard<std::mutex> lock(mutex);
+	if (has_failed) {
+		status = Status::Failed;
+		return 0;
+	}
+	const auto frames = std::min(desired_frames,
+	                             static_cast<uint32_t>(ring_fill / channels));
+	size_t samples = frames * channels;
+	ring_fill -= samples;
+	while (samples) {
+		const auto n = std::min(samples, ring.size() - ring_pos);
+		std::copy_n(ring.begin() + static_cast<ptrdiff_t>(ring_pos), n, buffer);
+		buffer += n;
+		samples -= n;
+		ring_pos = (ring_pos + n) % ring.size();
+	}
+
+	if (frames == desired_frames) {
+		status = Status::Playing;
+		lowest_fill = std::min(lowest_fill, ring_fill);
+	} else if (has_track_ended) {
+		status = Status::TrackEnded;
+	} else {
+		status = Status::Buffering;
+		// Count the decoder falling behind, but not its initial seek
+		if (decoded_frames)
+			++underruns;
+	}
+	has_work.notify_one();
+	return frames;
+}
+
+// Logs how well the decoder kept ahead of the play position since the
+// previous play request. Must be called with the mutex held.
+void CDROM_Interface_Image::AudioDecoder::ReportHealth()
+{
+	if (!decoded_frames)
+		return;
+
+	if (underruns) {
+		LOG_MSG("CDROM: Audio decoder fell behind playback %u times; "
+		        "consider raising 'cdaudio_prebuffer' above %u ms",
+		        underruns, window_ms);
+	} else {
+		[[maybe_unused]] const auto lowest_percent = static_cast<uint32_t>(
+		        100 * lowest_fill / std::max(ring.size(), size_t(1)));
+		DEBUG_LOG_MSG("CDROM: Audio decoder decoded %u frames, and its "
+		              "%u ms buffer stayed at least %u%% full",
+		              decoded_frames, window_ms, lowest_percent);
+	}
+	underruns = 0;
+	decoded_frames = 0;
+}
+
+void CDROM_Interface_Image::AudioDecoder::ShutDown()
+{
+	{
+		const std::lock_guard<std::mutex> lock(mutex);
+		keep_decoding = false;
+		file.reset();
+	}
+	has_work.notify_all();
+	if (thread.joinable())
+		thread.join();
+}
+
+void CDROM_Interface_Image::AudioDecoder::Decode()
+{
+	std::vector<int16_t> chunk(DECODE_CHUNK_FRAMES * REDBOOK_CHANNELS);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (keep_decoding) {
+		has_work.wait(lock, [this] {
+			const auto has_room = ring_fill + DECODE_CHUNK_FRAMES * channels <=
+			                      ring.size();
+			return !keep_decoding || is_seek_pending ||
+			       (file && !has_track_ended && !has_failed && has_room);
+		});
+		if (!keep_decoding)
+			break;
+
+		// Hold the track and note the request we're serving, so the
+		// results can be discarded if playback moves on meanwhile.
+		const auto track_file = file;
+		const auto request = generation;
+
+		if (is_seek_pending) {
+			is_seek_pending = false;
+			const auto offset = seek_offset;
+			lock.unlock();
+			bool is_seeked = false;
+			{
+				const std::lock_guard<std::mutex> file_lock(track_file->mutex);
+				is_seeked = track_file->seek(offset);
+				// We're performing an audio-task, so update the
+				// audio position
+				if (is_seeked)
+					track_file->setAudioPosition(offset);
+			}
+			lock.lock();
+			if (!is_seeked && request == generation) {
+				LOG_MSG("CDROM: Failed to seek to byte %u, so cancelling playback",
+				        offset);
+				has_failed = true;
+			}
+			continue;
+		}
+
+		lock.unlock();
+		uint32_t frames = 0;
+		{
+			const std::lock_guard<std::mutex> file_lock(track_file->mutex);
+			frames = track_file->decode(chunk.data(), DECODE_CHUNK_FRAMES);
+		}
+		lock.lock();
+
+		if (request != generation)
+			continue; // superseded by a seek or stop
+		if (!frames) {
+			has_track_ended = true;
+			continue;
+		}
+
+		size_t samples = frames * channels;
+		auto write_pos = (ring_pos + ring_fill) % ring.size();
+		auto source = chunk.begin();
+		ring_fill += samples;
+		decoded_frames += frames;
+		while (samples) {
+			const auto n = std::min(samples, ring.size() - write_pos);
+			std::copy_n(source, n, ring.begin() + static_cast<ptrdiff_t>(write_pos));
+			source += static_cast<ptrdiff_t>(n);
+			samples -= n;
+			write_pos = 0;
+		}
+	}
+}
+
+void CDROM_Interface_Image::ConfigureDecoder(const uint32_t window_ms)
+{
+	player.decoder.SetWindow(window_ms);
+}
+
+void CDROM_Interface_Image::ShutDownDecoder()
+{
+	player.decoder.ShutDown();
+}
+
 bool CDROM_Interface_Image::LoadIsoFile(char* filename)
 {
 	tracks.clear();
@@ -1440,12 +1653,19 @@ bool CDROM_Interface_Image::GetCueString(string &str, istream &in)
 }
 
 void CDROM_Image_Destroy(Section*) {
+	// The decoder thread must be done with the codecs before they're shut
+	CDROM_Interface_Image::ShutDownDecoder();
 	Sound_Quit();
 }
 
 void CDROM_Image_Init(Section* sec) {
 	if (sec != nullptr) {
 		sec->AddDestroyFunction(CDROM_Image_Destroy, false);
+		const auto conf = static_cast<Section_prop *>(sec);
+		const auto prebuffer_ms = conf->Get_int("cdaudio_prebuffer");
+		CDROM_Interface_Image::ConfigureDecoder(check_cast<uint32_t>(prebuffer_ms));
 	}
+	const auto seek_table_dir = CROSS_GetPlatformConfigDir() + "mp3-seek-tables";
+	Sound_SetSeekTableCacheDir(seek_table_dir.c_str());
 	Sound_Init();
 }
@@ -203,6 +203,7 @@ void DOS_SetupPrograms(void)
 	        "Usage:\n"
 	        "  [color=green]mixer[reset] [color=cyan]CHANNEL[reset] [color=white]VOLUME[reset] [/noshow]\n"
 	        "  [color=green]mixer[reset] [/listmidi][reset]\n"
+	        "  [color=green]mixer[reset] [/stats][reset]\n"
 	        "\n"
 	        "Where:\n"
 	        "  [color=cyan]CHANNEL[reset] is the sound channel you want to change the volume.\n"
@@ -211,6 +212,7 @@ void DOS_SetupPrograms(void)
 	        "Notes:\n"
 	        "  Running [color=green]mixer[reset] without an argument shows the volumes of all sound channels.\n"
 	        "  You can view available MIDI devices and user options with /listmidi option.\n"
+	        "  The /stats option shows audio buffer health and each channel's latency.\n"
 	        "  You may change the volumes of more than one sound channels in one command.\n"
 	        "  The /noshow option causes mixer not to show the volumes when making a change.\n"
 	        "\n"
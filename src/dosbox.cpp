@@ -402,6 +402,7 @@ static void DOSBOX_RealInit(Section * sec) {
 		int10.vesa_mode_preference = VESA_MODE_PREF::COMPATIBLE;
 
 	VGA_SetRatePreference(section->Get_string("dos_rate"));
+	VGA_SetFrameBatching(section->Get_bool("batch_frames"));
 
 	CPU_AllowSpeedMods = section->Get_bool("speed_mods");
 	LOG_MSG("SYSTEM: Speed modifications are %s",
@@ -454,6 +455,15 @@ void DOSBOX_Init() {
 	pstring->Set_help(
 	        "Directory where things like wave, midi, screenshot get captured.");
 
+	const char *audio_capture_formats[] = {"wav", "flac", 0};
+	pstring = secprop->Add_string("audio_capture_format", always, "wav");
+	pstring->Set_values(audio_capture_formats);
+	pstring->Set_help(
+	        "File format of audio captures:\n"
+	        "  wav:   Uncompressed 16-bit PCM.\n"
+	        "  flac:  Lossless compression; how much smaller than wav depends\n"
+	        "         on the audio.");
+
 #if C_DEBUG
 	LOG_StartUp();
 #endif
@@ -488,6 +498,12 @@ void DOSBOX_Init() {
 	        "<value>:  Sets the rate to an exact value, between 24.000 and 1000.000 (Hz).\n"
 	        "We recommend the 'default' rate; otherwise test and set on a per-game basis.");
 
+	Pbool = secprop->Add_bool("batch_frames", when_idle, true);
+	Pbool->Set_help(
+	        "Draw the frame in one go at display end while the game isn't changing\n"
+	        "video registers mid-frame (enabled by default). Disable this if a game's\n"
+	        "raster effects, such as split screens or palette bars, don't show.");
+
 	const char *vesa_modes_choices[] = {"compatible", "all", 0};
 	Pstring = secprop->Add_string("vesa_modes", only_at_start, "compatible");
 	Pstring->Set_values(vesa_modes_choices);
@@ -585,6 +601,12 @@ void DOSBOX_Init() {
 	pstring = pmulti->GetSection()->Add_string("force", always, "");
 	pstring->Set_values(force);
 
+	pint = secprop->Add_int("scaler_threads", always, 0);
+	pint->SetMinMax(0, 16);
+	pint->Set_help("Number of threads the advmame, advinterp, hq, and sai scalers split\n"
+	               "each frame across (0 picks a number based on the host's cores, and\n"
+	               "1 scales each line on the emulation thread as it's drawn).");
+
 #if C_OPENGL
 	pstring = secprop->Add_path("glshader", always, "default");
 	pstring->Set_help("Either 'none' or a GLSL shader name. Works only with\n"
@@ -677,6 +699,11 @@ void DOSBOX_Init() {
 	Pbool = secprop->Add_bool("nosound", only_at_start, false);
 	Pbool->Set_help("Enable silent mode, sound is still emulated though.");
 
+	Pbool = secprop->Add_bool("offline", only_at_start, false);
+	Pbool->Set_help("Render audio without a sound device, as fast as possible, into a\n"
+	                "wave or FLAC capture (see audio_capture_format). The capture\n"
+	                "holds exactly 'rate' frames per second of emulated time.");
+
 	Pint = secprop->Add_int("rate", only_at_start, default_mixer_rate);
 	Pint->Set_values(rates);
 	Pint->Set_help("Mixer sample rate, setting any device's rate higher than this will probably lower their sound quality.");
@@ -858,6 +885,15 @@ void DOSBOX_Init() {
 	pint->SetMinMax(8000, 48000);
 	pint->Set_help("Sample rate of the PC-Speaker sound generation.");
 
+	const char *pcrender_opts[] = {"bandlimited", "integrated", 0};
+	pstring = secprop->Add_string("pcrender", when_idle, pcrender_opts[0]);
+	pstring->Set_values(pcrender_opts);
+	pstring->Set_help(
+	        "How the PC-Speaker's transitions are turned into samples.\n"
+	        "'bandlimited' places filtered steps at their exact times, which avoids\n"
+	        "aliasing and stays fast with digitized (RealSound) playback.\n"
+	        "'integrated' averages the speaker's level over each sample.");
+
 	const char *zero_offset_opts[] = {"auto", "true", "false", 0};
 	pstring = secprop->Add_string("zero_offset", when_idle, zero_offset_opts[0]);
 	pstring->Set_values(zero_offset_opts);
@@ -1010,6 +1046,11 @@ void DOSBOX_Init() {
 	secprop->AddInitFunction(&MSCDEX_Init);
 	secprop->AddInitFunction(&DRIVES_Init);
 	secprop->AddInitFunction(&CDROM_Image_Init);
+	pint = secprop->Add_int("cdaudio_prebuffer", when_idle, 500);
+	pint->SetMinMax(100, 5000);
+	pint->Set_help("How many milliseconds of CD audio to decode ahead of the play\n"
+	               "position (500 by default). Raise this if CD audio stutters\n"
+	               "with compressed (FLAC, Opus, Vorbis, or MP3) tracks.");
 #if C_IPX
 	secprop=control->AddSection_prop("ipx",&IPX_Init,true);
 	Pbool = secprop->Add_bool("ipx", when_idle,  false);
@@ -18,12 +18,16 @@
 
 #include "dosbox.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <memory>
 #include <sstream>
 #include <unordered_map>
+#include <vector>
 
 #include <sys/types.h>
 
@@ -36,8 +40,10 @@
 #include "hardware.h"
 #include "support.h"
 #include "shell.h"
+#include "simd.h"
 #include "string_utils.h"
 #include "vga.h"
+#include "worker_pool.h"
 
 #include "render_crt_glsl.h"
 #include "render_glsl.h"
@@ -46,6 +52,21 @@
 Render_t render;
 ScalerLineHandler_t RENDER_DrawLine;
 
+// Runs the complex scalers over horizontal bands of the frame in parallel
+static struct {
+	std::unique_ptr<WorkerPool> pool = {};
+	std::vector<ScalerBand_t> bands = {};
+	std::vector<std::vector<Bit16u>> changed_lines = {};
+	std::vector<scalerWriteCache_t> write_caches = {};
+} scaler_bands;
+
+// Hashes of the cached source lines, which let unchanged lines in large
+// 32-bit modes be skipped without reading the cache. Zero means unknown.
+static struct {
+	std::vector<uint64_t> lines = {};
+	bool enabled = false;
+} line_hashes;
+
 static void RENDER_CallBack( GFX_CallBackFunctions_t function );
 
 static void Check_Palette(void) {
@@ -105,24 +126,150 @@ void RENDER_SetPal(Bit8u entry,Bit8u red,Bit8u green,Bit8u blue) {
 static void RENDER_EmptyLineHandler(const void *)
 {}
 
+// Compares 64 bytes at a time and stops at the first block that differs
+static bool RENDER_LineDiffers(const uint8_t *src, const uint8_t *cache, size_t bytes)
+{
+	size_t i = 0;
+#if defined(SIMD_SSE2)
+	const auto zero = _mm_setzero_si128();
+	for (; i + 64 <= bytes; i += 64) {
+		auto diff = _mm_setzero_si128();
+		for (size_t j = i; j < i + 64; j += 16) {
+			const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + j));
+			const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(cache + j));
+			diff = _mm_or_si128(diff, _mm_xor_si128(a, b));
+		}
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, zero)) != 0xffff)
+			return true;
+	}
+#elif defined(SIMD_NEON)
+	for (; i + 64 <= bytes; i += 64) {
+		auto diff = vdupq_n_u8(0);
+		for (size_t j = i; j < i + 64; j += 16)
+			diff = vorrq_u8(diff, veorq_u8(vld1q_u8(src + j), vld1q_u8(cache + j)));
+		const auto halves = vreinterpretq_u64_u8(diff);
+		if (vgetq_lane_u64(halves, 0) | vgetq_lane_u64(halves, 1))
+			return true;
+	}
+#endif
+	return memcmp(src + i, cache + i, bytes - i) != 0;
+}
+
+// Accumulates 32 bytes per step in four 64-bit lanes, XXH3-style: each word
+// is keyed by its position, its halves are multiplied together, and the word
+// itself is added to the neighbouring lane. The lanes are then mixed down.
+static uint64_t RENDER_HashLine(const uint8_t *src, size_t bytes)
+{
+	constexpr uint64_t prime1 = 0x9e3779b185ebca87ULL;
+	constexpr uint64_t prime2 = 0xc2b2ae3d27d4eb4fULL;
+	constexpr uint64_t key_step = 0x9e3779b97f4a7c15ULL;
+	alignas(16) uint64_t acc[4] = {prime1, prime2, ~prime1, ~prime2};
+	alignas(16) uint64_t key[4] = {0x165667b19e3779f9ULL, 0x27d4eb2f165667c5ULL,
+	                               0x85ebca77c2b2ae63ULL, 0xff51afd7ed558ccdULL};
+	size_t i = 0;
+#if defined(SIMD_SSE2)
+	auto acc01 = _mm_load_si128(reinterpret_cast<const __m128i *>(acc));
+	auto acc23 = _mm_load_si128(reinterpret_cast<const __m128i *>(acc + 2));
+	auto key01 = _mm_load_si128(reinterpret_cast<const __m128i *>(key));
+	auto key23 = _mm_load_si128(reinterpret_cast<const __m128i *>(key + 2));
+	const auto step = _mm_set1_epi64x(static_cast<int64_t>(key_step));
+	auto accumulate = [](__m128i accs, __m128i data, __m128i keys) {
+		const auto keyed = _mm_xor_si128(data, keys);
+		const auto product = _mm_mul_epu32(keyed, _mm_srli_epi64(keyed, 32));
+		const auto swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+		return _mm_add_epi64(accs, _mm_add_epi64(product, swapped));
+	};
+	for (; i + 32 <= bytes; i += 32) {
+		acc01 = accumulate(acc01, _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), key01);
+		acc23 = accumulate(acc23, _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 16)), key23);
+		key01 = _mm_add_epi64(key01, step);
+		key23 = _mm_add_epi64(key23, step);
+	}
+	_mm_store_si128(reinterpret_cast<__m128i *>(acc), acc01);
+	_mm_store_si128(reinterpret_cast<__m128i *>(acc + 2), acc23);
+#elif defined(SIMD_NEON)
+	auto acc01 = vld1q_u64(acc);
+	auto acc23 = vld1q_u64(acc + 2);
+	auto key01 = vld1q_u64(key);
+	auto key23 = vld1q_u64(key + 2);
+	const auto step = vdupq_n_u64(key_step);
+	auto accumulate = [](uint64x2_t accs, uint64x2_t data, uint64x2_t keys) {
+		const auto keyed = veorq_u64(data, keys);
+		const auto product = vmull_u32(vmovn_u64(keyed), vshrn_n_u64(keyed, 32));
+		const auto swapped = vextq_u64(data, data, 1);
+		return vaddq_u64(accs, vaddq_u64(product, swapped));
+	};
+	for (; i + 32 <= bytes; i += 32) {
+		acc01 = accumulate(acc01, vreinterpretq_u64_u8(vld1q_u8(src + i)), key01);
+		acc23 = accumulate(acc23, vreinterpretq_u64_u8(vld1q_u8(src + i + 16)), key23);
+		key01 = vaddq_u64(key01, step);
+		key23 = vaddq_u64(key23, step);
+	}
+	vst1q_u64(acc, acc01);
+	vst1q_u64(acc + 2, acc23);
+#endif
+	for (; i + 32 <= bytes; i += 32) {
+		uint64_t words[4];
+		memcpy(words, src + i, sizeof(words));
+		for (int l = 0; l < 4; ++l) {
+			const uint64_t keyed = words[l] ^ key[l];
+			acc[l] += (keyed & 0xffffffff) * (keyed >> 32) + words[l ^ 1];
+			key[l] += key_step;
+		}
+	}
+
+	uint64_t hash = bytes * prime1;
+	for (const auto lane : acc)
+		hash = (hash ^ lane) * prime2;
+	for (; i < bytes; ++i)
+		hash = (hash ^ src[i]) * prime1;
+	hash ^= hash >> 29;
+	hash *= prime1;
+	hash ^= hash >> 32;
+	return hash ? hash : 1;
+}
+
+static void RENDER_ForgetLineHashes(const size_t first_line)
+{
+	auto &lines = line_hashes.lines;
+	if (first_line < lines.size())
+		std::fill(lines.begin() + first_line, lines.end(), 0);
+}
+
 static void RENDER_StartLineHandler(const void * s) {
 	if (s) {
-		const Bitu *src = (Bitu*)s;
-		Bitu *cache = (Bitu*)(render.scale.cacheRead);
-		for (Bits x=render.src.start;x>0;) {
-			const auto src_ptr = reinterpret_cast<const uint8_t *>(src);
-			const auto src_val = read_unaligned_size_t(src_ptr);
-			if (GCC_UNLIKELY(src_val != cache[0])) {
-				if (!GFX_StartUpdate(render.scale.outWrite, render.scale.outPitch)) {
-					RENDER_DrawLine = RENDER_EmptyLineHandler;
-					return;
-				}
-				render.scale.outWrite += render.scale.outPitch * Scaler_ChangedLines[0];
-				RENDER_DrawLine = render.scale.lineHandler;
-				RENDER_DrawLine( s );
+		const auto src = static_cast<const uint8_t *>(s);
+		const auto bytes = render.scale.cachePitch;
+		uint64_t hash = 0;
+		bool changed = true;
+		if (line_hashes.enabled) {
+			hash = RENDER_HashLine(src, bytes);
+			auto &known_hash = line_hashes.lines[render.scale.inLine];
+			if (hash == known_hash) {
+				changed = false;
+			} else {
+				changed = RENDER_LineDiffers(src, render.scale.cacheRead, bytes);
+				if (!changed)
+					known_hash = hash;
+			}
+		} else {
+			changed = RENDER_LineDiffers(src, render.scale.cacheRead, bytes);
+		}
+		if (GCC_UNLIKELY(changed)) {
+			if (!GFX_StartUpdate(render.scale.outWrite, render.scale.outPitch)) {
+				RENDER_DrawLine = RENDER_EmptyLineHandler;
 				return;
 			}
-			x--; src++; cache++;
+			// The scaler brings this line's cache up to date and takes
+			// over the rest of the frame without hashing it
+			if (line_hashes.enabled) {
+				line_hashes.lines[render.scale.inLine] = hash;
+				RENDER_ForgetLineHashes(render.scale.inLine + 1);
+			}
+			render.scale.outWrite += render.scale.outPitch * Scaler_ChangedLines[0];
+			RENDER_DrawLine = render.scale.lineHandler;
+			RENDER_DrawLine( s );
+			return;
 		}
 	}
 	render.scale.cacheRead += render.scale.cachePitch;
@@ -132,14 +279,8 @@ static void RENDER_StartLineHandler(const void * s) {
 }
 
 static void RENDER_FinishLineHandler(const void * s) {
-	if (s) {
-		const Bitu *src = (Bitu*)s;
-		Bitu *cache = (Bitu*)(render.scale.cacheRead);
-		for (Bits x=render.src.start;x>0;) {
-			cache[0] = src[0];
-			x--; src++; cache++;
-		}
-	}
+	if (s)
+		memcpy(render.scale.cacheRead, s, render.scale.cachePitch);
 	render.scale.cacheRead += render.scale.cachePitch;
 }
 
@@ -184,6 +325,7 @@ bool RENDER_StartUpdate(void) {
 		render.fullFrame = true;
 		render.scale.clearCache = false;
 		RENDER_DrawLine = RENDER_ClearCacheHandler;
+		RENDER_ForgetLineHashes(0);
 	} else {
 		if (render.pal.changed) {
 			/* Assume pal changes always do a full screen update anyway */
@@ -191,6 +333,7 @@ bool RENDER_StartUpdate(void) {
 				return false;
 			RENDER_DrawLine = render.scale.linePalHandler;
 			render.fullFrame = true;
+			RENDER_ForgetLineHashes(0);
 		} else {
 			RENDER_DrawLine = RENDER_StartLineHandler;
 			if (GCC_UNLIKELY(CaptureState & (CAPTURE_IMAGE|CAPTURE_VIDEO))) 
@@ -210,6 +353,69 @@ static void RENDER_Halt( void ) {
 	render.active=false;
 }
 
+#if RENDER_USE_ADVANCED_SCALERS>1
+static void RENDER_ScaleBands()
+{
+	// Frame cache lines 1 through inHeight hold the frame. The scalers
+	// only read the lines around their own, so the bands need no overlap.
+	const Bitu num_lines = render.scale.inHeight;
+	const int num_threads = scaler_bands.pool ? scaler_bands.pool->NumThreads() : 1;
+	const auto num_bands = static_cast<int>(std::min<Bitu>(
+	        std::min<Bitu>(render.scale.bands, num_threads), num_lines));
+	if (num_bands < 1)
+		return;
+
+	auto &bands = scaler_bands.bands;
+	bands.resize(num_bands);
+	scaler_bands.changed_lines.resize(num_bands);
+	scaler_bands.write_caches.resize(num_bands);
+
+	// The line handlers skip over unchanged lines before the first change
+	Bit8u *out = render.scale.outWrite -
+	             render.scale.outPitch * Scaler_ChangedLines[0];
+	Bitu line = 0;
+	for (int b = 0; b < num_bands; ++b) {
+		const Bitu first = 1 + num_lines * b / num_bands;
+		for (; line < first; ++line)
+			out += render.scale.outPitch * Scaler_Aspect[line];
+		auto &changed_lines = scaler_bands.changed_lines[b];
+		changed_lines.resize(SCALER_MAXHEIGHT);
+		changed_lines[0] = 0;
+		bands[b] = {first, out, changed_lines.data(), 0,
+		            &scaler_bands.write_caches[b]};
+	}
+
+	Scaler_PrepareBands();
+	const auto handler = render.scale.complexHandler;
+	auto scale_band = [&](const int b) {
+		const Bitu end = 1 + num_lines * (b + 1) / num_bands;
+		auto &band = bands[b];
+		while (band.outLine < end)
+			handler(band);
+	};
+	if (scaler_bands.pool)
+		scaler_bands.pool->Run(num_bands, scale_band);
+	else
+		for (int b = 0; b < num_bands; ++b)
+			scale_band(b);
+
+	// Join the bands' runs of unchanged and changed lines
+	Scaler_ChangedLines[0] = 0;
+	Scaler_ChangedLineIndex = 0;
+	for (const auto &band : bands) {
+		for (Bitu i = 0; i <= band.changedLineIndex; ++i) {
+			const auto count = band.changedLines[i];
+			if (!count)
+				continue;
+			if ((Scaler_ChangedLineIndex & 1) == (i & 1))
+				Scaler_ChangedLines[Scaler_ChangedLineIndex] += count;
+			else
+				Scaler_ChangedLines[++Scaler_ChangedLineIndex] = count;
+		}
+	}
+}
+#endif
+
 extern uint32_t PIC_Ticks;
 void RENDER_EndUpdate( bool abort ) {
 	if (GCC_UNLIKELY(!render.updating))
@@ -233,6 +439,10 @@ void RENDER_EndUpdate( bool abort ) {
 		                 (Bit8u *)&render.pal.rgb);
 	}
 	if ( render.scale.outWrite ) {
+#if RENDER_USE_ADVANCED_SCALERS>1
+		if (render.scale.bands > 1 && !abort)
+			RENDER_ScaleBands();
+#endif
 		GFX_EndUpdate( abort? NULL : Scaler_ChangedLines );
 		render.frameskip.hadSkip[render.frameskip.index] = 0;
 	} else {
@@ -535,9 +745,17 @@ forcenormal:
 	default:
 		E_Exit("RENDER:Wrong source bpp %u", render.src.bpp);
 	}
+	render.scale.bands = 0;
+	if (render.scale.complexHandler && scaler_bands.pool)
+		render.scale.bands = scaler_bands.pool->NumThreads();
 	render.scale.blocks = render.src.width / SCALER_BLOCKSIZE;
 	render.scale.lastBlock = render.src.width % SCALER_BLOCKSIZE;
 	render.scale.inHeight = render.src.height;
+	// Hashing only pays off when it saves reading large cache lines
+	constexpr uint32_t min_hashed_line_bytes = 640 * 4;
+	line_hashes.enabled = render.src.bpp == 32 &&
+	                      render.scale.cachePitch >= min_hashed_line_bytes;
+	line_hashes.lines.assign(render.src.height, 0);
 	/* Reset the palette change detection to it's initial value */
 	render.pal.first= 0;
 	render.pal.last = 255;
@@ -623,6 +841,19 @@ static void ChangeScaler(bool pressed) {
 	RENDER_CallBack( GFX_CallBackReset );
 } */
 
+// Returns true if the number of threads changed
+static bool RENDER_SetScalerThreads(const int num_threads)
+{
+	const int current = scaler_bands.pool ? scaler_bands.pool->NumThreads() : 1;
+	if (num_threads == current)
+		return false;
+	scaler_bands.pool.reset();
+	if (num_threads > 1)
+		scaler_bands.pool = std::make_unique<WorkerPool>(num_threads,
+		                                                 "dosbox:scaler");
+	return true;
+}
+
 #if C_OPENGL
 static bool RENDER_GetShader(std::string &shader_path, char *old_src)
 {
@@ -707,6 +938,13 @@ void RENDER_Init(Section * sec) {
 	render.aspect=section->Get_bool("aspect");
 	render.frameskip.max=section->Get_int("frameskip");
 	render.frameskip.count=0;
+
+	constexpr int max_auto_scaler_threads = 8;
+	const int scaler_threads = section->Get_int("scaler_threads");
+	const bool scaler_threads_changed = RENDER_SetScalerThreads(
+	        scaler_threads > 0
+	                ? scaler_threads
+	                : WorkerPool::DefaultNumThreads(max_auto_scaler_threads));
 	VGA_SetMonoPalette(section->Get_string("monochrome_palette"));
 	std::string cline;
 	std::string scaler;
@@ -776,6 +1014,7 @@ void RENDER_Init(Section * sec) {
 	// Only ReInit when there is a src.bpp (fixes crashes on startup and directly changing the scaler without a screen specified yet)
 	if(running && render.src.bpp && ((render.aspect != aspect) || (render.scale.op != scaleOp) || 
 				  (render.scale.size != scalersize) || (render.scale.forced != scalerforced) ||
+				  scaler_threads_changed ||
 #if C_OPENGL
 				  (render.shader_src != shader_src) ||
 #endif
@@ -16,33 +16,29 @@
  *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+/* Scales frame cache line band.outLine to band.outWrite and moves on to the
+ * next line. The band holds all the output state, so that separate bands of
+ * the frame can be scaled at the same time. */
 #if defined (SCALERLINEAR)
-static void conc3d(SCALERNAME,SBPP,L)(void) {
+static void conc3d(SCALERNAME,SBPP,L)(ScalerBand_t &band) {
 #else
-static void conc3d(SCALERNAME,SBPP,R)(void) {
+static void conc3d(SCALERNAME,SBPP,R)(ScalerBand_t &band) {
 #endif
-//Skip the first one for multiline input scalers
-	if (!render.scale.outLine) {
-		render.scale.outLine++;
-		return;
-	}
-lastagain:
-	if (!CC[render.scale.outLine][0]) {
+	if (!CC[band.outLine][0]) {
 #if defined(SCALERLINEAR) 
 		Bitu scaleLines = SCALERHEIGHT;
 #else
-		Bitu scaleLines = Scaler_Aspect[ render.scale.outLine ];
+		Bitu scaleLines = Scaler_Aspect[ band.outLine ];
 #endif
-		ScalerAddLines( 0, scaleLines );
-		if (++render.scale.outLine == render.scale.inHeight)
-			goto lastagain;
+		ScalerAddLines( band, 0, scaleLines );
+		band.outLine++;
 		return;
 	}
 	/* Clear the complete line marker */
-	CC[render.scale.outLine][0] = 0;
-	const PTYPE * fc = &FC[render.scale.outLine][1];
-	PTYPE * line0=(PTYPE *)(render.scale.outWrite);
-	Bit8u * changed = &CC[render.scale.outLine][1];
+	CC[band.outLine][0] = 0;
+	const PTYPE * fc = &FC[band.outLine][1];
+	PTYPE * line0=(PTYPE *)(band.outWrite);
+	Bit8u * changed = &CC[band.outLine][1];
 	Bitu b;
 	for (b=0;b<render.scale.blocks;b++) {
 #if (SCALERHEIGHT > 1) 
@@ -131,16 +127,16 @@ lastagain:
 		default:
 #if defined(SCALERLINEAR)
 #if (SCALERHEIGHT > 1) 
-			line1 = WC[0];
+			line1 = BAND_WC(band)[0];
 #endif
 #if (SCALERHEIGHT > 2) 
-			line2 = WC[1];
+			line2 = BAND_WC(band)[1];
 #endif
 #if (SCALERHEIGHT > 3) 
-			line3 = WC[2];
+			line3 = BAND_WC(band)[2];
 #endif
 #if (SCALERHEIGHT > 4) 
-			line4 = WC[3];
+			line4 = BAND_WC(band)[3];
 #endif
 #else
 #if (SCALERHEIGHT > 1) 
@@ -175,16 +171,16 @@ lastagain:
 			}
 #if defined(SCALERLINEAR)
 #if (SCALERHEIGHT > 1) 
-			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch  ,WC[0], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
+			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch  ,BAND_WC(band)[0], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
 #endif
 #if (SCALERHEIGHT > 2) 
-			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch*2,WC[1], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
+			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch*2,BAND_WC(band)[1], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
 #endif
 #if (SCALERHEIGHT > 3) 
-			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch*3,WC[2], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
+			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch*3,BAND_WC(band)[2], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
 #endif
 #if (SCALERHEIGHT > 4) 
-			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch*4,WC[3], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
+			BituMove((Bit8u*)(&line0[-SCALER_BLOCKSIZE*SCALERWIDTH])+render.scale.outPitch*4,BAND_WC(band)[3], SCALER_BLOCKSIZE *SCALERWIDTH*PSIZE);
 #endif
 #endif //defined(SCALERLINEAR)
 			break;
@@ -193,16 +189,15 @@ lastagain:
 #if defined(SCALERLINEAR) 
 	Bitu scaleLines = SCALERHEIGHT;
 #else
-	Bitu scaleLines = Scaler_Aspect[ render.scale.outLine ];
+	Bitu scaleLines = Scaler_Aspect[ band.outLine ];
 	if ( ((Bits)(scaleLines - SCALERHEIGHT)) > 0 ) {
-		BituMove( render.scale.outWrite + render.scale.outPitch * SCALERHEIGHT,
-			render.scale.outWrite + render.scale.outPitch * (SCALERHEIGHT-1),
+		BituMove( band.outWrite + render.scale.outPitch * SCALERHEIGHT,
+			band.outWrite + render.scale.outPitch * (SCALERHEIGHT-1),
 			render.src.width * SCALERWIDTH * PSIZE);
 	}
 #endif
-	ScalerAddLines( 1, scaleLines );
-	if (++render.scale.outLine == render.scale.inHeight)
-		goto lastagain;
+	ScalerAddLines( band, 1, scaleLines );
+	band.outLine++;
 }
 
 #if !defined(SCALERLINEAR) 
@@ -23,18 +23,14 @@
 
 #include "dosbox.h"
 #include "render.h"
+#include "simd.h"
 #include <string.h>
 
 Bit8u Scaler_Aspect[SCALER_MAXHEIGHT];
 Bit16u Scaler_ChangedLines[SCALER_MAXHEIGHT];
 Bitu Scaler_ChangedLineIndex;
 
-static union {
-	 //The +1 is a at least for the normal scalers not needed. (-1 is enough)
-	Bit32u b32 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
-	Bit16u b16 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
-	Bit8u   b8 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
-} scalerWriteCache;
+static scalerWriteCache_t scalerWriteCache;
 //scalerFrameCache_t scalerFrameCache;
 scalerSourceCache_t scalerSourceCache;
 #if RENDER_USE_ADVANCED_SCALERS>1
@@ -71,6 +67,166 @@ static inline void ScalerAddLines( Bitu changed, Bitu count ) {
 	render.scale.outWrite += render.scale.outPitch * count;
 }
 
+static inline void ScalerAddLines(ScalerBand_t &band, Bitu changed, Bitu count)
+{
+	if ((band.changedLineIndex & 1) == changed) {
+		band.changedLines[band.changedLineIndex] += count;
+	} else {
+		band.changedLines[++band.changedLineIndex] = count;
+	}
+	band.outWrite += render.scale.outPitch * count;
+}
+
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+/* The simple scalers with 32-bit output write each span of changed pixels
+ * with these, rather than pixel by pixel, when SIMD is enabled */
+static bool scaler_simd = true;
+
+// Interleaves a and b into dst, as in dst = a0 b0 a1 b1 ...
+static inline void Scaler_Span2(Bit32u *dst, const Bit32u *a, const Bit32u *b, Bitu n)
+{
+	Bitu i = 0;
+#if defined(SIMD_SSE2)
+	for (; i + 4 <= n; i += 4) {
+		const auto va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+		const auto vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2),
+		                 _mm_unpacklo_epi32(va, vb));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2 + 4),
+		                 _mm_unpackhi_epi32(va, vb));
+	}
+#else
+	for (; i + 4 <= n; i += 4)
+		vst2q_u32(dst + i * 2, (uint32x4x2_t{{vld1q_u32(a + i), vld1q_u32(b + i)}}));
+#endif
+	for (; i < n; i++) {
+		dst[i * 2] = a[i];
+		dst[i * 2 + 1] = b[i];
+	}
+}
+
+// Interleaves a, b, and c into dst, as in dst = a0 b0 c0 a1 b1 c1 ...
+static inline void Scaler_Span3(Bit32u *dst, const Bit32u *a, const Bit32u *b,
+                                const Bit32u *c, Bitu n)
+{
+	Bitu i = 0;
+#if defined(SIMD_SSE2)
+	for (; i + 4 <= n; i += 4) {
+		const auto va = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)));
+		const auto vb = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+		const auto vc = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(c + i)));
+		const auto ab_lo = _mm_unpacklo_ps(va, vb); // a0 b0 a1 b1
+		const auto ab_hi = _mm_unpackhi_ps(va, vb); // a2 b2 a3 b3
+		const auto bc_lo = _mm_unpacklo_ps(vb, vc); // b0 c0 b1 c1
+		const auto bc_hi = _mm_unpackhi_ps(vb, vc); // b2 c2 b3 c3
+		const auto ca_lo = _mm_unpacklo_ps(vc, va); // c0 a0 c1 a1
+		const auto ca_hi = _mm_unpackhi_ps(vc, va); // c2 a2 c3 a3
+		float *out = reinterpret_cast<float *>(dst + i * 3);
+		_mm_storeu_ps(out, _mm_shuffle_ps(ab_lo, ca_lo, _MM_SHUFFLE(3, 0, 1, 0)));
+		_mm_storeu_ps(out + 4, _mm_shuffle_ps(bc_lo, ab_hi, _MM_SHUFFLE(1, 0, 3, 2)));
+		_mm_storeu_ps(out + 8, _mm_shuffle_ps(ca_hi, bc_hi, _MM_SHUFFLE(3, 2, 3, 0)));
+	}
+#else
+	for (; i + 4 <= n; i += 4)
+		vst3q_u32(dst + i * 3, (uint32x4x3_t{{vld1q_u32(a + i), vld1q_u32(b + i),
+		                                      vld1q_u32(c + i)}}));
+#endif
+	for (; i < n; i++) {
+		dst[i * 3] = a[i];
+		dst[i * 3 + 1] = b[i];
+		dst[i * 3 + 2] = c[i];
+	}
+}
+
+static inline void Scaler_SpanMask(Bit32u *dst, const Bit32u *src, Bit32u mask, Bitu n)
+{
+	Bitu i = 0;
+#if defined(SIMD_SSE2)
+	const auto vmask = _mm_set1_epi32(static_cast<int>(mask));
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+		                 _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), vmask));
+#else
+	const auto vmask = vdupq_n_u32(mask);
+	for (; i + 4 <= n; i += 4)
+		vst1q_u32(dst + i, vandq_u32(vld1q_u32(src + i), vmask));
+#endif
+	for (; i < n; i++)
+		dst[i] = src[i] & mask;
+}
+
+// Darkens each colour channel to 5/8 (shift 3) or 5/16 (shift 4) for the TV
+// scalers' in-between lines
+static inline void Scaler_SpanTV(Bit32u *dst, const Bit32u *src, int shift, Bitu n)
+{
+	Bitu i = 0;
+#if defined(SIMD_SSE2)
+	const auto zero = _mm_setzero_si128();
+	const auto five = _mm_set1_epi16(5);
+	const auto rgb = _mm_set1_epi32(0x00ffffff);
+	const auto count = _mm_cvtsi32_si128(shift);
+	for (; i + 4 <= n; i += 4) {
+		const auto p = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+		const auto lo = _mm_srl_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(p, zero), five), count);
+		const auto hi = _mm_srl_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(p, zero), five), count);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i),
+		                 _mm_and_si128(_mm_packus_epi16(lo, hi), rgb));
+	}
+#else
+	const auto rgb = vdupq_n_u32(0x00ffffff);
+	const auto right = vdupq_n_s16(static_cast<int16_t>(-shift));
+	for (; i + 4 <= n; i += 4) {
+		const auto p = vreinterpretq_u8_u32(vld1q_u32(src + i));
+		const auto lo = vshlq_u16(vmulq_n_u16(vmovl_u8(vget_low_u8(p)), 5), right);
+		const auto hi = vshlq_u16(vmulq_n_u16(vmovl_u8(vget_high_u8(p)), 5), right);
+		const auto packed = vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+		vst1q_u32(dst + i, vandq_u32(vreinterpretq_u32_u8(packed), rgb));
+	}
+#endif
+	for (; i < n; i++) {
+		const Bit32u p = src[i];
+		dst[i] = ((((p & 0xff00ff) * 5) >> shift) & 0xff00ff) |
+		         ((((p & 0x00ff00) * 5) >> shift) & 0x00ff00);
+	}
+}
+#else
+static constexpr bool scaler_simd = false;
+#endif
+
+bool Scaler_SetSIMD(const bool enabled)
+{
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+	scaler_simd = enabled;
+#endif
+	return scaler_simd == enabled;
+}
+
+#if RENDER_USE_ADVANCED_SCALERS>1
+/* Runs the complex scaler behind the cache line handlers, one line behind
+ * them because it needs the following line. When the frame is scaled in
+ * bands, this is left to RENDER_EndUpdate. */
+static inline void ScalerComplexLine()
+{
+	if (render.scale.bands > 1)
+		return;
+	//Skip the first one for multiline input scalers
+	if (!render.scale.outLine) {
+		render.scale.outLine++;
+		return;
+	}
+	ScalerBand_t band = {render.scale.outLine, render.scale.outWrite,
+	                     Scaler_ChangedLines, Scaler_ChangedLineIndex,
+	                     &scalerWriteCache};
+	render.scale.complexHandler(band);
+	//The last line has no following line to wait for
+	if (band.outLine == render.scale.inHeight)
+		render.scale.complexHandler(band);
+	render.scale.outLine = band.outLine;
+	render.scale.outWrite = band.outWrite;
+	Scaler_ChangedLineIndex = band.changedLineIndex;
+}
+#endif
+
 
 #define BituMove2(_DST,_SRC,_SIZE)			\
 {											\
@@ -175,6 +331,16 @@ static inline void ScalerAddLines( Bitu changed, Bitu count ) {
 
 
 #if RENDER_USE_ADVANCED_SCALERS>1
+void Scaler_PrepareBands()
+{
+#if RENDER_USE_ADVANCED_SCALERS>2
+	// The HQnx scalers otherwise build their (bpp-independent) colour
+	// table on first use, which could happen on several threads at once
+	if (!_RGBtoYUV)
+		InitLUTs_32();
+#endif
+}
+
 ScalerLineBlock_t ScalerCache = {
 {	Cache_8_8,	Cache_8_15 ,	Cache_8_16 ,	Cache_8_32 },
 {	        0,	Cache_15_15,	Cache_15_16,	Cache_15_32},
@@ -72,8 +72,27 @@ typedef enum scalerOperation {
 	scalerLast
 } scalerOperation_t;
 
+typedef union {
+	//The +1 is a at least for the normal scalers not needed. (-1 is enough)
+	Bit32u b32 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
+	Bit16u b16 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
+	Bit8u   b8 [SCALER_MAX_MUL_HEIGHT + 1][SCALER_MAXLINE_WIDTH];
+} scalerWriteCache_t;
+
+/* The output state of the complex scalers for a horizontal band of the frame.
+ * Lines are scaled on the emulation thread as they arrive using a single
+ * band, or, when bands are enabled, all at once at the end of the frame with
+ * one band per thread. */
+typedef struct {
+	Bitu outLine;
+	Bit8u *outWrite;
+	Bit16u *changedLines;
+	Bitu changedLineIndex;
+	scalerWriteCache_t *writeCache;
+} ScalerBand_t;
+
 typedef void (*ScalerLineHandler_t)(const void *src);
-typedef void (*ScalerComplexHandler_t)(void);
+typedef void (*ScalerComplexHandler_t)(ScalerBand_t &band);
 
 extern Bit8u Scaler_Aspect[];
 extern Bit8u diff_table[];
@@ -121,6 +140,9 @@ typedef struct {
 #define SCALE_FULL	0x4
 
 /* Simple scalers */
+/* Turns the vectorised 8 and 32-bit to 32-bit simple scalers on or off;
+ * returns false if they can't be turned on in this build */
+bool Scaler_SetSIMD(bool enabled);
 extern ScalerSimpleBlock_t ScaleNormal1x;
 extern ScalerSimpleBlock_t ScaleNormalDw;
 extern ScalerSimpleBlock_t ScaleNormalDh;
@@ -148,5 +170,8 @@ extern ScalerComplexBlock_t ScaleAdvInterp3x;
 #endif
 #if RENDER_USE_ADVANCED_SCALERS>1
 extern ScalerLineBlock_t ScalerCache;
+/* Sets up the complex scalers' shared lookup tables before bands of the
+ * frame are scaled in parallel */
+void Scaler_PrepareBands();
 #endif
 #endif
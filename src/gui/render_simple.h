@@ -105,6 +105,26 @@ static void conc4d(SCALERNAME,SBPP,DBPP,R)(const void *s) {
 #endif
 #endif //defined(SCALERLINEAR)
 			hadChange = 1;
+#if defined(SCALERSPAN)
+			if (scaler_simd) {
+				const Bitu count = x > 32 ? 32 : x;
+				PTYPE pixels[32];
+				for (Bitu i = 0; i < count; i++)
+					pixels[i] = PMAKE(src[i]);
+				memcpy(cache, src, count * sizeof(SRCTYPE));
+				SCALERSPAN;
+				x -= count;
+				src += count;
+				cache += count;
+				line0 += count * SCALERWIDTH;
+#if (SCALERHEIGHT > 1)
+				line1 += count * SCALERWIDTH;
+#endif
+#if (SCALERHEIGHT > 2)
+				line2 += count * SCALERWIDTH;
+#endif
+			} else
+#endif
 			for (Bitu i = x > 32 ? 32 : x;i>0;i--,x--) {
 				const SRCTYPE S = *src;
 				*cache = S;
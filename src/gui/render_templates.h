@@ -20,6 +20,7 @@
 #define PSIZE 1
 #define PTYPE Bit8u
 #define WC scalerWriteCache.b8
+#define BAND_WC(band) (band).writeCache->b8
 //#define FC scalerFrameCache.b8
 #define FC (*(scalerFrameCache_t*)(&scalerSourceCache.b32[400][0])).b8
 #define redMask		0
@@ -35,6 +36,7 @@
 #define PSIZE 2
 #define PTYPE Bit16u
 #define WC scalerWriteCache.b16
+#define BAND_WC(band) (band).writeCache->b16
 //#define FC scalerFrameCache.b16
 #define FC (*(scalerFrameCache_t*)(&scalerSourceCache.b32[400][0])).b16
 #if DBPP == 15
@@ -62,6 +64,7 @@
 #define PSIZE 4
 #define PTYPE Bit32u
 #define WC scalerWriteCache.b32
+#define BAND_WC(band) (band).writeCache->b32
 //#define FC scalerFrameCache.b32
 #define FC (*(scalerFrameCache_t*)(&scalerSourceCache.b32[400][0])).b32
 #define redMask		0xff0000
@@ -202,7 +205,7 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	if (!s) {
 		render.scale.cacheRead += render.scale.cachePitch;
 		render.scale.inLine++;
-		render.scale.complexHandler();
+		ScalerComplexLine();
 		return;
 	}
 #endif
@@ -251,21 +254,33 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 		CC[render.scale.inLine+2][0] = 1;
 	}
 	render.scale.inLine++;
-	render.scale.complexHandler();
+	ScalerComplexLine();
 }
 #endif
 
 /* Simple scalers */
+/* With 32-bit output, spans of changed pixels from 8 or 32-bit sources can be
+ * written with the vectorised helpers instead of SCALERFUNC */
+#if (DBPP == 32) && (SBPP == 8 || SBPP == 9 || SBPP == 32) && \
+        (defined(SIMD_SSE2) || defined(SIMD_NEON))
+#define SCALER_SIMD_SPANS 1
+#endif
+
 #define SCALERNAME		Normal1x
 #define SCALERWIDTH		1
 #define SCALERHEIGHT	1
 #define SCALERFUNC								\
 	line0[0] = P;
+#if defined(SCALER_SIMD_SPANS)
+#define SCALERSPAN	\
+	memcpy(line0, pixels, count * PSIZE);
+#endif
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERSPAN
 
 #define SCALERNAME		Normal2x
 #define SCALERWIDTH		2
@@ -275,11 +290,17 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line0[1] = P;								\
 	line1[0] = P;								\
 	line1[1] = P;
+#if defined(SCALER_SIMD_SPANS)
+#define SCALERSPAN	\
+	Scaler_Span2(line0, pixels, pixels, count);	\
+	Scaler_Span2(line1, pixels, pixels, count);
+#endif
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERSPAN
 
 #define SCALERNAME		Normal3x
 #define SCALERWIDTH		3
@@ -294,11 +315,18 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line2[0] = P;								\
 	line2[1] = P;								\
 	line2[2] = P;
+#if defined(SCALER_SIMD_SPANS)
+#define SCALERSPAN	\
+	Scaler_Span3(line0, pixels, pixels, pixels, count);	\
+	Scaler_Span3(line1, pixels, pixels, pixels, count);	\
+	Scaler_Span3(line2, pixels, pixels, pixels, count);
+#endif
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERSPAN
 
 #define SCALERNAME		NormalDw
 #define SCALERWIDTH		2
@@ -306,11 +334,16 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 #define SCALERFUNC								\
 	line0[0] = P;								\
 	line0[1] = P;
+#if defined(SCALER_SIMD_SPANS)
+#define SCALERSPAN	\
+	Scaler_Span2(line0, pixels, pixels, count);
+#endif
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERSPAN
 
 #define SCALERNAME		NormalDh
 #define SCALERWIDTH		1
@@ -318,11 +351,17 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 #define SCALERFUNC								\
 	line0[0] = P;								\
 	line1[0] = P;
+#if defined(SCALER_SIMD_SPANS)
+#define SCALERSPAN	\
+	memcpy(line0, pixels, count * PSIZE);	\
+	memcpy(line1, pixels, count * PSIZE);
+#endif
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERSPAN
 
 #endif // (SBPP != 9) || (DBPP != 8)
 
@@ -342,11 +381,21 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line1[0]=halfpixel;						\
 	line1[1]=halfpixel;						\
 }
+#if defined(SCALER_SIMD_SPANS)
+#define SCALERSPAN	\
+{	\
+	PTYPE shade[32];	\
+	Scaler_Span2(line0, pixels, pixels, count);	\
+	Scaler_SpanTV(shade, pixels, 3, count);	\
+	Scaler_Span2(line1, shade, shade, count);	\
+}
+#endif
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERSPAN
 
 #define SCALERNAME		TV3x
 #define SCALERWIDTH		3
@@ -367,11 +416,23 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line2[1]=halfpixel;						\
 	line2[2]=halfpixel;						\
 }
+#if defined(SCALER_SIMD_SPANS)
+#define SCALERSPAN	\
+{	\
+	PTYPE shade[32];	\
+	Scaler_Span3(line0, pixels, pixels, pixels, count);	\
+	Scaler_SpanTV(shade, pixels, 3, count);	\
+	Scaler_Span3(line1, shade, shade, shade, count);	\
+	Scaler_SpanTV(shade, pixels, 4, count);	\
+	Scaler_Span3(line2, shade, shade, shade, count);	\
+}
+#endif
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERSPAN
 
 #define SCALERNAME		RGB2x
 #define SCALERWIDTH		2
@@ -381,11 +442,23 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line0[1]=P & greenMask;			\
 	line1[0]=P & blueMask;				\
 	line1[1]=P;
+#if defined(SCALER_SIMD_SPANS)
+#define SCALERSPAN	\
+{	\
+	PTYPE red[32], green[32], blue[32];	\
+	Scaler_SpanMask(red, pixels, redMask, count);	\
+	Scaler_SpanMask(green, pixels, greenMask, count);	\
+	Scaler_SpanMask(blue, pixels, blueMask, count);	\
+	Scaler_Span2(line0, red, green, count);	\
+	Scaler_Span2(line1, blue, pixels, count);	\
+}
+#endif
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERSPAN
 
 #define SCALERNAME		RGB3x
 #define SCALERWIDTH		3
@@ -400,11 +473,24 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line2[0]=P;				\
 	line2[1]=P & blueMask;				\
 	line2[2]=P & redMask;
+#if defined(SCALER_SIMD_SPANS)
+#define SCALERSPAN	\
+{	\
+	PTYPE red[32], green[32], blue[32];	\
+	Scaler_SpanMask(red, pixels, redMask, count);	\
+	Scaler_SpanMask(green, pixels, greenMask, count);	\
+	Scaler_SpanMask(blue, pixels, blueMask, count);	\
+	Scaler_Span3(line0, pixels, green, blue, count);	\
+	Scaler_Span3(line1, green, red, pixels, count);	\
+	Scaler_Span3(line2, pixels, blue, red, count);	\
+}
+#endif
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERSPAN
 
 #define SCALERNAME		Scan2x
 #define SCALERWIDTH		2
@@ -414,11 +500,17 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line0[1]=P;							\
 	line1[0]=0;							\
 	line1[1]=0;
+#if defined(SCALER_SIMD_SPANS)
+#define SCALERSPAN	\
+	Scaler_Span2(line0, pixels, pixels, count);	\
+	memset(line1, 0, count * 2 * PSIZE);
+#endif
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERSPAN
 
 #define SCALERNAME		Scan3x
 #define SCALERWIDTH		3
@@ -433,11 +525,18 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 	line2[0]=0;				\
 	line2[1]=0;				\
 	line2[2]=0;
+#if defined(SCALER_SIMD_SPANS)
+#define SCALERSPAN	\
+	Scaler_Span3(line0, pixels, pixels, pixels, count);	\
+	Scaler_Span3(line1, pixels, pixels, pixels, count);	\
+	memset(line2, 0, count * 3 * PSIZE);
+#endif
 #include "render_simple.h"
 #undef SCALERNAME
 #undef SCALERWIDTH
 #undef SCALERHEIGHT
 #undef SCALERFUNC
+#undef SCALERSPAN
 
 #endif		//#if RENDER_USE_ADVANCED_SCALERS>0
 
@@ -616,6 +715,8 @@ static void conc3d(Cache,SBPP,DBPP) (const void * s) {
 #undef PTYPE
 #undef PMAKE
 #undef WC
+#undef BAND_WC
+#undef SCALER_SIMD_SPANS
 #undef LC
 #undef FC
 #undef SC
@@ -24,13 +24,17 @@
 #include <array>
 #include <cassert>
 #include <cerrno>
+#include <condition_variable>
 #include <cstdlib>
+#include <mutex>
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <stdarg.h>
 #include <sys/types.h>
+#include <thread>
 #include <tuple>
+#include <vector>
 #include <math.h>
 #ifdef WIN32
 #include <signal.h>
@@ -497,6 +501,226 @@ static SDL_Rect calc_viewport(int width, int height);
 static void CleanupSDLResources();
 static void HandleVideoResize(int width, int height);
 
+// Presentation thread
+// ~~~~~~~~~~~~~~~~~~~
+// The texture and OpenGL outputs can hand their completed frames to a
+// dedicated thread that owns the renderer (or GL context) and performs the
+// upload and presentation, so vsync waits and driver stalls no longer stall
+// the emulation.
+//
+// Frames move through a triple-buffered mailbox: the emulation thread copies
+// each new frame into the back buffer and swaps it with the ready buffer,
+// which the presenter then swaps with its front buffer. Neither side waits on
+// the other; if the presenter falls behind, a newer ready frame replaces the
+// one it didn't get to.
+//
+// The renderer and its surroundings (clip rectangle, shader, pacer) are only
+// reconfigured while the thread is stopped.
+struct Presenter {
+	bool enabled = false;
+	bool running = false;
+	std::thread thread = {};
+
+	std::mutex mutex = {};
+	std::condition_variable wake = {};
+	bool present_requested = false; // guarded by the mutex
+	bool should_quit = false;       // guarded by the mutex
+	bool ready_is_new = false;      // guarded by the mutex
+	bool back_is_new = false;       // emulation thread only
+
+	std::array<std::vector<uint8_t>, 3> frames = {};
+	int back = 0;  // written by the emulation thread
+	int ready = 1; // swapped under the mutex
+	int front = 2; // read by the presentation thread
+
+	const uint8_t *source = nullptr;
+	int pitch = 0;
+	void (*upload)(const uint8_t *pixels) = nullptr;
+
+	// The output's own functions, which present on the calling thread
+	update_frame_buffer_f *direct_update = nullptr;
+	present_frame_f *direct_present = nullptr;
+};
+
+static Presenter presenter;
+
+static void upload_frame_texture(const uint8_t *pixels)
+{
+	SDL_UpdateTexture(sdl.texture.texture, nullptr, pixels, presenter.pitch);
+}
+
+#if C_OPENGL
+static void upload_frame_gl(const uint8_t *pixels)
+{
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, sdl.draw.width, sdl.draw.height,
+	                GL_BGRA_EXT, GL_UNSIGNED_INT_8_8_8_8_REV, pixels);
+}
+#endif
+
+static void present_frames()
+{
+#if C_OPENGL
+	if (sdl.desktop.type == SCREEN_OPENGL)
+		SDL_GL_MakeCurrent(sdl.window, sdl.opengl.context);
+#endif
+	std::unique_lock<std::mutex> lock(presenter.mutex);
+	while (true) {
+		presenter.wake.wait(lock, [] {
+			return presenter.present_requested || presenter.should_quit;
+		});
+		if (presenter.should_quit)
+			break;
+		presenter.present_requested = false;
+
+		const bool is_new = presenter.ready_is_new;
+		if (is_new) {
+			std::swap(presenter.ready, presenter.front);
+			presenter.ready_is_new = false;
+		}
+		lock.unlock();
+
+		if (is_new)
+			presenter.upload(presenter.frames[presenter.front].data());
+		presenter.direct_present();
+
+		lock.lock();
+	}
+	lock.unlock();
+#if C_OPENGL
+	if (sdl.desktop.type == SCREEN_OPENGL)
+		SDL_GL_MakeCurrent(sdl.window, nullptr);
+#endif
+}
+
+// Copies the completed frame into the back buffer. The scalers only redraw
+// changed lines into their persistent buffer, so the whole frame is copied.
+static void update_frame_handoff(const uint16_t *changedLines)
+{
+	if (!changedLines || !sdl.updating)
+		return;
+	auto &frame = presenter.frames[presenter.back];
+	memcpy(frame.data(), presenter.source, frame.size());
+	presenter.back_is_new = true;
+}
+
+// Hands the back buffer to the presentation thread if it holds a new frame.
+// Returns whether it did, so the callers' skipped-frame tracking sees frames
+// that were never handed over as not shown.
+static bool present_frame_handoff()
+{
+	if (!presenter.back_is_new)
+		return false;
+
+	std::lock_guard<std::mutex> lock(presenter.mutex);
+	std::swap(presenter.back, presenter.ready);
+	presenter.ready_is_new = true;
+	presenter.back_is_new = false;
+	presenter.present_requested = true;
+	presenter.wake.notify_one();
+	return true;
+}
+
+static void presenter_start()
+{
+	if (!presenter.enabled || presenter.running)
+		return;
+
+	const uint8_t *source = nullptr;
+	int pitch = 0;
+	int height = 0;
+	void (*upload)(const uint8_t *) = nullptr;
+
+	if (sdl.desktop.type == SCREEN_TEXTURE && sdl.texture.input_surface) {
+		source = static_cast<uint8_t *>(sdl.texture.input_surface->pixels);
+		pitch = sdl.texture.input_surface->pitch;
+		height = sdl.texture.input_surface->h;
+		upload = upload_frame_texture;
+	}
+#if C_OPENGL
+	// The PBO path maps GL buffers from the emulation thread, so it keeps
+	// presenting there. It's not used when the thread is enabled.
+	if (sdl.desktop.type == SCREEN_OPENGL && sdl.opengl.framebuf) {
+		source = static_cast<uint8_t *>(sdl.opengl.framebuf);
+		pitch = sdl.opengl.pitch;
+		height = sdl.draw.height;
+		upload = upload_frame_gl;
+	}
+#endif
+	// The surface output blits into the window during its update, so it
+	// gains nothing from the thread
+	if (!source)
+		return;
+
+	const auto frame_bytes = static_cast<size_t>(pitch) * height;
+	if (source != presenter.source || frame_bytes != presenter.frames[0].size()) {
+		for (auto &frame : presenter.frames)
+			frame.assign(frame_bytes, 0);
+		presenter.back_is_new = false;
+		presenter.ready_is_new = false;
+	}
+	presenter.source = source;
+	presenter.pitch = pitch;
+	presenter.upload = upload;
+	presenter.present_requested = false;
+	presenter.should_quit = false;
+
+	presenter.direct_update = sdl.frame.update;
+	presenter.direct_present = sdl.frame.present;
+	sdl.frame.update = update_frame_handoff;
+	sdl.frame.present = present_frame_handoff;
+
+#if C_OPENGL
+	// Release the context so the presentation thread can make it current
+	if (sdl.desktop.type == SCREEN_OPENGL)
+		SDL_GL_MakeCurrent(sdl.window, nullptr);
+#endif
+	presenter.thread = std::thread(present_frames);
+	set_thread_name(presenter.thread, "dosbox:present");
+	presenter.running = true;
+}
+
+static void presenter_stop()
+{
+	if (!presenter.running)
+		return;
+	{
+		std::lock_guard<std::mutex> lock(presenter.mutex);
+		presenter.should_quit = true;
+	}
+	presenter.wake.notify_one();
+	presenter.thread.join();
+	presenter.running = false;
+
+	sdl.frame.update = presenter.direct_update;
+	sdl.frame.present = presenter.direct_present;
+#if C_OPENGL
+	if (sdl.desktop.type == SCREEN_OPENGL)
+		SDL_GL_MakeCurrent(sdl.window, sdl.opengl.context);
+#endif
+}
+
+// Stops the presentation thread for the object's lifetime, so the renderer
+// can be touched from the main thread
+class PresenterPause {
+public:
+	PresenterPause() : was_running(presenter.running)
+	{
+		presenter_stop();
+	}
+
+	~PresenterPause()
+	{
+		if (was_running)
+			presenter_start();
+	}
+
+	PresenterPause(const PresenterPause &) = delete;
+	PresenterPause &operator=(const PresenterPause &) = delete;
+
+private:
+	const bool was_running;
+};
+
 static const char *vsync_state_as_string(const VSYNC_STATE state)
 {
 	switch (state) {
@@ -546,6 +770,7 @@ void OPENGL_ERROR(const char*) {
 extern "C" void SDL_CDROMQuit(void);
 static void QuitSDL()
 {
+	presenter_stop();
 	if (sdl.initialized) {
 		SDL_CDROMQuit();
 		SDL_Quit();
@@ -1236,6 +1461,8 @@ static void schedule_synced([[maybe_unused]] const uint32_t event_id = 0)
 
 static void setup_presentation_mode(FRAME_MODE &previous_mode)
 {
+	const PresenterPause pause;
+
 	// Always get the reported refresh rate and hint the VGA side with it
 	// This ensures the VGA side always has the host's rate to prior to
 	// its next mode change.
@@ -1742,6 +1969,7 @@ Bitu GFX_SetSize(int width,
 	Bitu retFlags = 0;
 	if (sdl.updating)
 		GFX_EndUpdate(nullptr);
+	presenter_stop();
 
 	const bool double_width = flags & GFX_DBL_W;
 	const bool double_height = flags & GFX_DBL_H;
@@ -2203,8 +2431,10 @@ dosurface:
 
 	update_vsync_state();
 
-	if (retFlags)
+	if (retFlags) {
 		GFX_Start();
+		presenter_start();
+	}
 	return retFlags;
 }
 
@@ -2216,6 +2446,7 @@ void GFX_SetShader([[maybe_unused]] const char *src)
 
 	sdl.opengl.shader_src = src;
 	if (sdl.opengl.program_object) {
+		const PresenterPause pause;
 		glDeleteProgram(sdl.opengl.program_object);
 		sdl.opengl.program_object = 0;
 	}
@@ -2632,6 +2863,7 @@ void GFX_UpdateDisplayDimensions(int width, int height)
 
 static void CleanupSDLResources()
 {
+	presenter_stop();
 	if (sdl.texture.pixelFormat) {
 		SDL_FreeFormat(sdl.texture.pixelFormat);
 		sdl.texture.pixelFormat = nullptr;
@@ -3416,8 +3648,10 @@ static void set_output(Section *sec, bool should_stretch_pixels)
 			assert(gl_version_string);
 			const int gl_version_major = gl_version_string[0] - '0';
 
+			// Mapped pixel buffers belong to the context's thread, so
+			// the presentation thread uploads from client memory
 			sdl.opengl.pixel_buffer_object =
-			        have_arb_buffers &&
+			        have_arb_buffers && !presenter.enabled &&
 			        SDL_GL_ExtensionSupported("GL_ARB_pixel_buffer_object");
 
 			sdl.opengl.npot_textures_supported =
@@ -3564,6 +3798,7 @@ static void GUI_StartUp(Section *sec)
 	                                              ? VSYNC_STATE::ON
 	                                              : VSYNC_STATE::OFF;
 	sdl.vsync.skip_us = section->Get_int("vsync_skip");
+	presenter.enabled = section->Get_bool("threaded_presentation");
 
 
 	const int display = section->Get_int("display");
@@ -3763,6 +3998,8 @@ void GFX_RegenerateWindow(Section *sec) {
 
 static void HandleVideoResize(int width, int height)
 {
+	const PresenterPause pause;
+
 	/* Maybe a screen rotation has just occurred, so we simply resize.
 	There may be a different cause for a forced resized, though.    */
 	if (sdl.desktop.full.display_res && sdl.desktop.fullscreen) {
@@ -4229,6 +4466,13 @@ void Config_Add_SDL() {
 	               "the next frame. 0 disables this and will always render.");
 	pint->SetMinMax(0, 14000);
 
+	Pbool = sdl_sec->Add_bool("threaded_presentation", on_start, false);
+	Pbool->Set_help(
+	        "Upload and present frames on a separate thread, so waiting on the\n"
+	        "display or the graphics driver doesn't hold up the emulation.\n"
+	        "Applies to the texture and OpenGL outputs. Experimental: some\n"
+	        "graphics drivers don't support presenting from another thread.");
+
 	const char *presentation_modes[] = {"auto", "cfr", "vfr", 0};
 	pstring = sdl_sec->Add_string("presentation_mode", always, "auto");
 	pstring->Set_help(
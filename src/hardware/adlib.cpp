@@ -175,6 +175,10 @@ struct Handler : public Adlib::Handler {
 	void WriteReg(Bit32u reg, Bit8u val) override
 	{
 		OPL3_WriteRegBuffered(&chip, (Bit16u)reg, val);
+	}
+
+	void TrackReg(Bit32u reg, Bit8u) override
+	{
 		if (reg == 0x105)
 			newm = reg & 0x01;
 	}
@@ -194,7 +198,7 @@ struct Handler : public Adlib::Handler {
 		int16_t buf[1024 * 2];
 		while (samples > 0) {
 			uint32_t todo = samples > 1024 ? 1024 : samples;
-			OPL3_GenerateStream(&chip, buf, todo);
+			OPL3_GenerateStreamLanes(&chip, buf, todo);
 			chan->AddSamples_s16(todo, buf);
 			samples -= todo;
 		}
@@ -205,6 +209,13 @@ struct Handler : public Adlib::Handler {
 		newm = 0;
 		OPL3_Reset(&chip, rate);
 	}
+
+	bool CanRenderThreaded() const override { return true; }
+
+	void GenerateFrames(int16_t *frames, uint16_t num_frames) override
+	{
+		OPL3_GenerateStreamLanes(&chip, frames, num_frames);
+	}
 };
 
 } // namespace NukedOPL
@@ -305,7 +316,7 @@ class Capture {
 	}
 
 	void ClearBuf( void ) {
-		fwrite( buf, 1, bufUsed, handle );
+		CAPTURE_QueueWrite(handle, buf, bufUsed);
 		header.commands += bufUsed / 2;
 		bufUsed = 0;
 	}
@@ -381,9 +392,8 @@ class Capture {
 			header.versionLow   = host_to_le(header.versionLow);
 			header.commands     = host_to_le(header.commands);
 			header.milliseconds = host_to_le(header.milliseconds);
-			fseek( handle, 0, SEEK_SET );
-			fwrite( &header, 1, sizeof( header ), handle );
-			fclose( handle );
+			CAPTURE_QueueWriteAt(handle, 0, &header, sizeof(header));
+			CAPTURE_QueueClose(handle);
 			handle = 0;
 		}
 	}
@@ -445,9 +455,9 @@ skipWrite:
 			return false;
 		InitHeader();
 		//Prepare space at start of the file for the header
-		fwrite( &header, 1, sizeof(header), handle );
+		CAPTURE_QueueWrite(handle, &header, sizeof(header));
 		/* write the Raw To Reg table */
-		fwrite( &ToReg, 1, RawUsed, handle );
+		CAPTURE_QueueWrite(handle, &ToReg, RawUsed);
 		/* Write the cache of last commands */
 		WriteCache( );
 		/* Write the command that triggered this */
@@ -468,6 +478,8 @@ skipWrite:
 	virtual ~Capture()
 	{
 		CloseFile();
+		// Make sure the file is complete once capturing has stopped
+		CAPTURE_FlushWrites();
 	}
 
 	Capture(const Capture&) = delete; // prevent copy
@@ -545,6 +557,20 @@ void Module::CacheWrite(Bit32u port, Bit8u val)
 	cache[port] = val;
 }
 
+void Module::HandlerWrite(Bit32u reg, Bit8u val)
+{
+	handler->TrackReg(reg, val);
+	if (is_rendering_threaded) {
+		RenderEvent event = {};
+		event.time = PIC_FullIndex();
+		event.reg = static_cast<uint16_t>(reg);
+		event.val = val;
+		PushRenderEvent(event);
+	} else {
+		handler->WriteReg(reg, val);
+	}
+}
+
 void Module::DualWrite(Bit8u index, Bit8u port, Bit8u val)
 {
 	// Make sure you don't use opl3 features
@@ -565,7 +591,7 @@ void Module::DualWrite(Bit8u index, Bit8u port, Bit8u val)
 		val |= index ? 0xA0 : 0x50;
 	}
 	const uint32_t full_port = port + (index ? 0x100 : 0);
-	handler->WriteReg(full_port, val);
+	HandlerWrite(full_port, val);
 	CacheWrite(full_port, val);
 }
 
@@ -601,12 +627,7 @@ uint8_t Module::CtrlRead(void)
 void Module::PortWrite(io_port_t port, io_val_t value, io_width_t)
 {
 	const auto val = check_cast<uint8_t>(value);
-	// Keep track of last write time
-	lastUsed = PIC_Ticks;
-	//Maybe only enable with a keyon?
-	if (!mixerChan->is_enabled) {
-		mixerChan->Enable(true);
-	}
+	mixerChan->WakeUp();
 	if ( port&1 ) {
 		switch ( mode ) {
 		case MODE_OPL3GOLD:
@@ -620,7 +641,7 @@ void Module::PortWrite(io_port_t port, io_val_t value, io_width_t)
 		case MODE_OPL2:
 		case MODE_OPL3:
 			if ( !chip[0].Write( reg.normal, val ) ) {
-				handler->WriteReg( reg.normal, val );
+				HandlerWrite(reg.normal, val);
 				CacheWrite( reg.normal, val );
 			}
 			break;
@@ -730,27 +751,246 @@ void Module::Init( Mode m ) {
 		break;
 	case MODE_DUALOPL2:
 		//Setup opl3 mode in the hander
-		handler->WriteReg( 0x105, 1 );
+		HandlerWrite(0x105, 1);
 		//Also set it up in the cache so the capturing will start opl3
 		CacheWrite( 0x105, 1 );
 		break;
 	}
 }
 
+/*
+	Render thread
+
+	Register writes are queued with their emulated time and applied by the
+	render thread between the frames they fall between, so the output is
+	sample-accurate while the synthesis cost is kept off the emulation
+	thread. The timer and status emulation stays on the emulation thread.
+*/
+
+// The render thread runs ahead by this many milliseconds of audio
+constexpr auto render_ahead_ms = 4;
+
+size_t RenderEventQueue::FreeSlots() const
+{
+	return capacity - (tail.load(std::memory_order_relaxed) -
+	                   head.load(std::memory_order_acquire));
+}
+
+bool RenderEventQueue::Push(const RenderEvent &event)
+{
+	const auto t = tail.load(std::memory_order_relaxed);
+	if (t - head.load(std::memory_order_acquire) >= capacity)
+		return false;
+	ring[t & (capacity - 1)] = event;
+	tail.store(t + 1, std::memory_order_release);
+	return true;
+}
+
+const RenderEvent *RenderEventQueue::Peek() const
+{
+	const auto h = head.load(std::memory_order_relaxed);
+	if (h == tail.load(std::memory_order_acquire))
+		return nullptr;
+	return &ring[h & (capacity - 1)];
+}
+
+void RenderEventQueue::Pop()
+{
+	head.store(head.load(std::memory_order_relaxed) + 1,
+	           std::memory_order_release);
+}
+
+void Module::PushRenderEvent(const RenderEvent &event)
+{
+	// Keep the last slot free for a flush request, which lets the render
+	// thread drain the writes without waiting for the next mixer tick.
+	if (events.FreeSlots() <= 1 && !event.is_request) {
+		RenderEvent flush = {};
+		flush.time = PIC_FullIndex();
+		flush.is_request = true;
+		PushRenderEvent(flush);
+		while (events.FreeSlots() <= 1)
+			std::this_thread::yield();
+	}
+	while (!events.Push(event))
+		std::this_thread::yield();
+
+	if (event.is_request) {
+		std::lock_guard<std::mutex> lock(requests_mutex);
+		++pending_requests;
+		has_requests.notify_one();
+	}
+}
+
+void Module::StartRenderThread()
+{
+	assert(!is_rendering_threaded);
+	const auto frames_per_ms = mixerChan->GetSampleRate() / 1000;
+
+	// Prime the playable queue with silence covering the render-ahead
+	// period, which gives the render thread its head start.
+	play_buffer.assign(frames_per_ms * render_ahead_ms * 2, 0);
+	play_buffer_pos = 0;
+	while (backstock.Size() < backstock.MaxCapacity())
+		backstock.Enqueue(std::vector<int16_t>(frames_per_ms * 4));
+
+	pending_requests = 0;
+	keep_rendering = true;
+	is_rendering_threaded = true;
+	renderer = std::thread(std::bind(&Module::Render, this));
+	set_thread_name(renderer, "dosbox:opl"); // < 16-character cap
+}
+
+void Module::StopRenderThread()
+{
+	if (!is_rendering_threaded)
+		return;
+
+	// Wake the render thread and drain the queue it might be blocked on
+	keep_rendering = false;
+	{
+		std::lock_guard<std::mutex> lock(requests_mutex);
+		has_requests.notify_one();
+	}
+	while (playable.Size())
+		playable.Dequeue();
+
+	if (renderer.joinable())
+		renderer.join();
+
+	// Apply the writes still in flight so the chip state stays complete
+	while (const auto event = events.Peek()) {
+		if (!event->is_request)
+			handler->WriteReg(event->reg, event->val);
+		events.Pop();
+	}
+	is_rendering_threaded = false;
+}
+
+void Module::Render()
+{
+	const auto ms_per_frame = 1000.0 / mixerChan->GetSampleRate();
+	std::vector<RenderEvent> writes = {};
+	double chunk_start = 0.0;
+
+	while (keep_rendering.load()) {
+		std::unique_lock<std::mutex> lock(requests_mutex);
+		has_requests.wait(lock, [this] {
+			return pending_requests > 0 || !keep_rendering.load();
+		});
+		if (!keep_rendering.load())
+			break;
+		--pending_requests;
+		lock.unlock();
+
+		// Collect the writes leading up to the request
+		writes.clear();
+		const RenderEvent *event = nullptr;
+		while ((event = events.Peek()) && !event->is_request) {
+			writes.push_back(*event);
+			events.Pop();
+		}
+		assert(event);
+		const auto request = *event;
+		events.Pop();
+
+		// Flush requests apply the writes without rendering
+		if (!request.frames) {
+			for (const auto &w : writes)
+				handler->WriteReg(w.reg, w.val);
+			continue;
+		}
+
+		// Don't stretch the chunk over time spent with the channel
+		// disabled
+		const auto span = request.frames * ms_per_frame;
+		chunk_start = std::max(chunk_start, request.time - span);
+
+		auto buffer = backstock.IsEmpty() ? std::vector<int16_t>()
+		                                  : backstock.Dequeue();
+		buffer.resize(request.frames * 2u);
+		RenderChunk(chunk_start, request, writes, buffer);
+		chunk_start = request.time;
+
+		playable.Enqueue(std::move(buffer));
+	}
+}
+
+// Render the requested frames, applying each write at the frame matching
+// its position between the chunk start and the request time.
+void Module::RenderChunk(const double chunk_start,
+                         const RenderEvent &request,
+                         const std::vector<RenderEvent> &writes,
+                         std::vector<int16_t> &buffer)
+{
+	const auto span = request.time - chunk_start;
+	uint16_t rendered = 0;
+	for (const auto &w : writes) {
+		uint16_t pos = 0;
+		if (span > 0 && w.time > chunk_start) {
+			const auto offset = (w.time - chunk_start) / span;
+			pos = static_cast<uint16_t>(std::min(offset, 1.0) *
+			                            request.frames);
+		}
+		if (pos > rendered) {
+			handler->GenerateFrames(buffer.data() + rendered * 2,
+			                        pos - rendered);
+			rendered = pos;
+		}
+		handler->WriteReg(w.reg, w.val);
+	}
+	if (rendered < request.frames)
+		handler->GenerateFrames(buffer.data() + rendered * 2,
+		                        request.frames - rendered);
+}
+
+void Module::Generate(uint16_t frames)
+{
+	if (!is_rendering_threaded) {
+		handler->Generate(mixerChan, frames);
+		return;
+	}
+	if (!frames)
+		return;
+
+	// Ask for the frames covering the time since the last request ...
+	RenderEvent request = {};
+	request.time = PIC_FullIndex();
+	request.is_request = true;
+	request.frames = frames;
+	PushRenderEvent(request);
+
+	// ... and play the frames rendered ahead of them
+	while (frames) {
+		const auto n = std::min(GetRemainingFrames(), frames);
+		mixerChan->AddSamples_s16(n, play_buffer.data() + play_buffer_pos * 2);
+		frames -= n;
+		play_buffer_pos += n;
+	}
+}
+
+// Return the number of frames left to play in the current buffer.
+uint16_t Module::GetRemainingFrames()
+{
+	const auto buffered = check_cast<uint16_t>(play_buffer.size() / 2);
+	if (play_buffer_pos < buffered)
+		return buffered - play_buffer_pos;
+
+	// Otherwise put the spent buffer in backstock and get the next buffer.
+	if (backstock.Size() < backstock.MaxCapacity())
+		backstock.Enqueue(std::move(play_buffer));
+	play_buffer = playable.Dequeue();
+	play_buffer_pos = 0;
+	return check_cast<uint16_t>(play_buffer.size() / 2);
+}
+
 } // namespace Adlib
 
 static Adlib::Module* module = 0;
 
 static void OPL_CallBack(uint16_t len)
 {
-	module->handler->Generate(module->mixerChan, len);
-	// Disable the sound generation after 30 seconds of silence
-	if ((PIC_Ticks - module->lastUsed) > 30000) {
-		uint8_t i;
-		for (i=0xb0;i<0xb9;i++) if (module->cache[i]&0x20||module->cache[i+0x100]&0x20) break;
-		if (i==0xb9) module->mixerChan->Enable(false);
-		else module->lastUsed = PIC_Ticks;
-	}
+	module->Generate(len);
 }
 
 /*
@@ -844,7 +1084,6 @@ Module::Module(Section *configuration)
           reg{0},          // union
           ctrl{false, 0, 0xff, 0xff, false},
           mixerChan(nullptr),
-          lastUsed(0),
           handler(nullptr),
           capture(nullptr)
 {
@@ -856,6 +1095,7 @@ Module::Module(Section *configuration)
 	mixerChan = MIXER_AddChannel(OPL_CallBack, 0, "FM");
 	//Used to be 2.0, which was measured to be too high. Exact value depends on card/clone.
 	mixerChan->SetScale( 1.5f );  
+	mixerChan->ConfigureSleep(true);
 
 	handler = make_opl_handler(section->Get_string("oplemu"), oplmode);
 	handler->Init(mixerChan->GetSampleRate());
@@ -879,6 +1119,11 @@ Module::Module(Section *configuration)
 	case OPL_none:
 		break;
 	}
+
+	// Move the synthesis off the emulation thread when we have the cores
+	if (handler->CanRenderThreaded() && std::thread::hardware_concurrency() > 1)
+		StartRenderThread();
+
 	using namespace std::placeholders;
 
 	const auto read_from = std::bind(&Module::PortRead, this, _1, _2);
@@ -902,6 +1147,7 @@ Module::Module(Section *configuration)
 }
 
 Module::~Module() {
+	StopRenderThread();
 	delete capture;
 	capture = nullptr;
 	delete handler;
@@ -26,8 +26,15 @@
 #include "setup.h"
 #include "pic.h"
 #include "hardware.h"
+#include "rwqueue.h"
 
+#include <array>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace Adlib {
 
@@ -143,9 +150,46 @@ public:
 	virtual void Generate(mixer_channel_t &chan, uint16_t samples) = 0;
 	//Initialize at a specific sample rate and mode
 	virtual void Init(uint32_t rate) = 0;
+
+	// Handlers that can render stereo frames into a plain buffer can be
+	// driven from the render thread. In that case WriteReg() and
+	// GenerateFrames() are only called from the render thread, while
+	// WriteAddr() and TrackReg() stay on the emulation thread.
+	virtual bool CanRenderThreaded() const { return false; }
+	// Bookkeeping of register writes needed by WriteAddr()
+	virtual void TrackReg(Bit32u /*reg*/, Bit8u /*val*/) {}
+	virtual void GenerateFrames(int16_t * /*frames*/, uint16_t /*num_frames*/) {}
+
 	virtual ~Handler() = default;
 };
 
+// A register write or a render request, timestamped in emulated
+// milliseconds (PIC_FullIndex). Render requests cover the time between the
+// previous request and their own timestamp.
+struct RenderEvent {
+	double time = 0.0;
+	uint16_t reg = 0;
+	uint8_t val = 0;
+	bool is_request = false;
+	uint16_t frames = 0; // zero-frame requests only flush pending writes
+};
+
+// Single-producer, single-consumer ring of render events. The emulation
+// thread pushes and the render thread peeks and pops without locking.
+class RenderEventQueue {
+public:
+	size_t FreeSlots() const;
+	bool Push(const RenderEvent &event);
+	const RenderEvent *Peek() const;
+	void Pop();
+
+private:
+	static constexpr size_t capacity = 8192; // must be a power of two
+	std::array<RenderEvent, capacity> ring = {};
+	std::atomic<size_t> head = 0; // next slot to read
+	std::atomic<size_t> tail = 0; // next slot to write
+};
+
 //The cache for 2 chips or an opl3
 typedef Bit8u RegisterCache[512];
 
@@ -174,17 +218,45 @@ class Module: public Module_base {
 	void DualWrite( Bit8u index, Bit8u reg, Bit8u val );
 	void CtrlWrite( Bit8u val );
 	uint8_t CtrlRead(void);
+	void HandlerWrite(Bit32u reg, Bit8u val);
+
+	// Render thread
+	void StartRenderThread();
+	void StopRenderThread();
+	void PushRenderEvent(const RenderEvent &event);
+	void Render();
+	void RenderChunk(double chunk_start,
+	                 const RenderEvent &request,
+	                 const std::vector<RenderEvent> &writes,
+	                 std::vector<int16_t> &buffer);
+	uint16_t GetRemainingFrames();
+
+	RenderEventQueue events = {};
+	std::mutex requests_mutex = {};
+	std::condition_variable has_requests = {};
+	int pending_requests = 0; // guarded by requests_mutex
+
+	static constexpr auto num_buffers = 16;
+	RWQueue<std::vector<int16_t>> playable{num_buffers};
+	RWQueue<std::vector<int16_t>> backstock{num_buffers};
+	std::vector<int16_t> play_buffer = {};
+	std::thread renderer = {};
+	std::atomic_bool keep_rendering = false;
+	uint16_t play_buffer_pos = 0; // in frames
+	bool is_rendering_threaded = false;
 
 public:
 	static OPL_Mode oplmode;
 	mixer_channel_t mixerChan;
-	Bit32u lastUsed;				//Ticks when adlib was last used to turn of mixing after a few second
 
 	Handler* handler;				//Handler that will generate the sound
 	RegisterCache cache;
 	Capture* capture;
 	Chip	chip[2];
 
+	//Generate the frames requested by the mixer
+	void Generate(uint16_t frames);
+
 	//Handle port writes
 	void PortWrite(io_port_t port, io_val_t value, io_width_t width);
 	uint8_t PortRead(io_port_t port, io_width_t width);
@@ -45,6 +45,19 @@ static void UpdateEMSMapping(void) {
 	}
 }
 
+// Find the physical page that holds the given DMA page, which differs from
+// the DMA page inside the EMS page frame
+static uint32_t get_physical_page(const uint32_t dma_page)
+{
+	if (dma_page < EMM_PAGEFRAME4K)
+		return paging.firstmb[dma_page];
+	if (dma_page < EMM_PAGEFRAME4K + 0x10)
+		return ems_board_mapping[dma_page];
+	if (dma_page < LINK_START)
+		return paging.firstmb[dma_page];
+	return dma_page;
+}
+
 // Generic function to read or write a block of data to or from memory.
 // Don't use this directly; call two helpers: DMA_BlockRead or DMA_BlockWrite
 static void perform_dma_io(const DMA_DIRECTION direction,
@@ -57,6 +70,7 @@ static void perform_dma_io(const DMA_DIRECTION direction,
 	assert(is_dma16 == 0 || is_dma16 == 1);
 
 	const auto highpart_addr_page = spage >> 12;
+	const auto total_pages = check_cast<uint32_t>(MEM_TotalPages());
 
 	// Maybe move the mem_address into the 16-bit range
 	mem_address <<= is_dma16;
@@ -65,39 +79,49 @@ static void perform_dma_io(const DMA_DIRECTION direction,
 	auto data_pt = reinterpret_cast<uint8_t *>(data_start);
 
 	// Convert from DMA 'words' to actual bytes, no greater than 64 KiB
-	auto remaining_bytes = check_cast<uint16_t>(num_words << is_dma16);
-	do {
-		// Find the right EMS page that contains the current address
-		auto page = highpart_addr_page + (mem_address >> 12);
-		if (page < EMM_PAGEFRAME4K)
-			page = paging.firstmb[page];
-		else if (page < EMM_PAGEFRAME4K + 0x10)
-			page = ems_board_mapping[page];
-		else if (page < LINK_START)
-			page = paging.firstmb[page];
-
-		// Calculate the offset within the page
+	auto remaining_bytes = check_cast<uint32_t>(num_words << is_dma16);
+	assert(remaining_bytes <= UINT16_MAX + 1u);
+	while (remaining_bytes) {
+		// Find the physical page that contains the current address
+		const auto dma_page = highpart_addr_page + (mem_address >> 12);
+		const auto page = get_physical_page(dma_page);
 		const auto pos_in_page = mem_address & (MEM_PAGESIZE - 1);
-		const auto bytes_to_page_end = check_cast<uint16_t>(MEM_PAGESIZE - pos_in_page);
 		const auto chunk_start = check_cast<PhysPt>(page * MEM_PAGESIZE + pos_in_page);
 
-		// Determine how many bytes to transfer within this page
-		const auto chunk_bytes = std::min(remaining_bytes, bytes_to_page_end);
+		// Outside of RAM, reads see an open bus and writes go nowhere
+		if (page >= total_pages) {
+			const auto chunk_bytes = std::min(remaining_bytes,
+			                                  MEM_PAGESIZE - pos_in_page);
+			if (direction == DMA_DIRECTION::READ)
+				memset(data_pt, 0xff, chunk_bytes);
+			mem_address += chunk_bytes;
+			data_pt += chunk_bytes;
+			remaining_bytes -= chunk_bytes;
+			continue;
+		}
+
+		// Extend the span across the following pages for as long as
+		// they're also contiguous in RAM, which is always the case
+		// outside of the EMS page frame.
+		uint32_t span_bytes = MEM_PAGESIZE - pos_in_page;
+		for (uint32_t next = 1; span_bytes < remaining_bytes; ++next) {
+			const auto next_page = page + next;
+			if (next_page >= total_pages ||
+			    get_physical_page(dma_page + next) != next_page)
+				break;
+			span_bytes += MEM_PAGESIZE;
+		}
+		const auto chunk_bytes = std::min(remaining_bytes, span_bytes);
 
-		// Copy the data from the page address into the data pointer
 		if (direction == DMA_DIRECTION::READ)
-			for (auto i = 0; i < chunk_bytes; ++i)
-				data_pt[i] = phys_readb(chunk_start + i);
-
-		// Copy the data from the data pointer into the page address
+			memcpy(data_pt, MemBase + chunk_start, chunk_bytes);
 		else if (direction == DMA_DIRECTION::WRITE)
-			for (auto i = 0; i < chunk_bytes; ++i)
-				phys_writeb(chunk_start + i, data_pt[i]);
+			memcpy(MemBase + chunk_start, data_pt, chunk_bytes);
 
 		mem_address += chunk_bytes;
 		data_pt += chunk_bytes;
 		remaining_bytes -= chunk_bytes;
-	} while (remaining_bytes);
+	}
 }
 
 DmaChannel * GetDMAChannel(Bit8u chan) {
@@ -0,0 +1,460 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "flac_encoder.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdlib>
+
+#include "byteorder.h"
+#include "mem_unaligned.h"
+
+namespace {
+
+constexpr uint8_t bits_per_sample = 16;
+constexpr int max_fixed_order = 4;
+constexpr int max_partition_order = 8;
+constexpr int max_rice_param = 14; // 15 is FLAC's escape code
+
+// Channel assignments from the frame header
+enum class Stereo : uint8_t {
+	LeftRight = 0b0001,
+	LeftSide = 0b1000,
+	RightSide = 0b1001,
+	MidSide = 0b1010,
+};
+
+class BitWriter {
+public:
+	BitWriter(std::vector<uint8_t> &output) : out(output) {}
+
+	// Writes the low 'num_bits' of value, most significant bit first
+	void Write(uint32_t value, int num_bits)
+	{
+		assert(num_bits >= 0 && num_bits <= 32);
+		if (num_bits < 32)
+			value &= (1u << num_bits) - 1;
+		acc = (acc << num_bits) | value;
+		acc_bits += num_bits;
+		while (acc_bits >= 8) {
+			acc_bits -= 8;
+			out.push_back(static_cast<uint8_t>(acc >> acc_bits));
+		}
+	}
+
+	void WriteSigned(int32_t value, int num_bits)
+	{
+		Write(static_cast<uint32_t>(value), num_bits);
+	}
+
+	void WriteUnary(uint32_t zeros)
+	{
+		for (; zeros >= 32; zeros -= 32)
+			Write(0, 32);
+		Write(1, static_cast<int>(zeros) + 1);
+	}
+
+	void ZeroPadToByte()
+	{
+		if (acc_bits)
+			Write(0, 8 - acc_bits);
+	}
+
+private:
+	std::vector<uint8_t> &out;
+	uint64_t acc = 0;
+	int acc_bits = 0;
+};
+
+// CRC-8 (x^8 + x^2 + x + 1) and CRC-16 (x^16 + x^15 + x^2 + 1), as used in
+// the frame header and footer
+template <typename T, T polynomial>
+std::array<T, 256> make_crc_table()
+{
+	constexpr auto top_bit = static_cast<T>(1u << (sizeof(T) * 8 - 1));
+	std::array<T, 256> table = {};
+	for (uint32_t i = 0; i < 256; ++i) {
+		auto crc = static_cast<T>(i << (sizeof(T) * 8 - 8));
+		for (int bit = 0; bit < 8; ++bit)
+			crc = static_cast<T>((crc & top_bit) ? (crc << 1) ^ polynomial
+			                                     : crc << 1);
+		table[i] = crc;
+	}
+	return table;
+}
+
+uint8_t crc8(const uint8_t *data, size_t size)
+{
+	static const auto table = make_crc_table<uint8_t, 0x07>();
+	uint8_t crc = 0;
+	while (size--)
+		crc = table[crc ^ *data++];
+	return crc;
+}
+
+uint16_t crc16(const uint8_t *data, size_t size)
+{
+	static const auto table = make_crc_table<uint16_t, 0x8005>();
+	uint16_t crc = 0;
+	while (size--)
+		crc = static_cast<uint16_t>((crc << 8) ^ table[(crc >> 8) ^ *data++]);
+	return crc;
+}
+
+uint8_t get_sample_rate_code(const uint32_t rate)
+{
+	switch (rate) {
+	case 88200: return 0b0001;
+	case 176400: return 0b0010;
+	case 192000: return 0b0011;
+	case 8000: return 0b0100;
+	case 16000: return 0b0101;
+	case 22050: return 0b0110;
+	case 24000: return 0b0111;
+	case 32000: return 0b1000;
+	case 44100: return 0b1001;
+	case 48000: return 0b1010;
+	case 96000: return 0b1011;
+	}
+	if (rate % 1000 == 0 && rate / 1000 <= UINT8_MAX)
+		return 0b1100; // kHz in the following byte
+	if (rate <= UINT16_MAX)
+		return 0b1101; // Hz in the following two bytes
+	if (rate % 10 == 0 && rate / 10 <= UINT16_MAX)
+		return 0b1110; // tens of Hz in the following two bytes
+	return 0b0000; // taken from STREAMINFO
+}
+
+// Frame numbers are stored in the same variable-length form as UTF-8
+void write_utf8_number(std::vector<uint8_t> &out, const uint32_t value)
+{
+	if (value < 0x80) {
+		out.push_back(static_cast<uint8_t>(value));
+		return;
+	}
+	int num_extra = 1;
+	while (num_extra < 6 && value >= (1u << (5 * num_extra + 6)))
+		++num_extra;
+	const auto lead_mask = static_cast<uint8_t>(0xff00 >> (num_extra + 1));
+	out.push_back(static_cast<uint8_t>(lead_mask | (value >> (6 * num_extra))));
+	for (int i = num_extra - 1; i >= 0; --i)
+		out.push_back(static_cast<uint8_t>(0x80 | ((value >> (6 * i)) & 0x3f)));
+}
+
+// Fixed predictor residual at position i, which must be >= order
+inline int32_t fixed_residual(const int32_t *x, const int i, const int order)
+{
+	switch (order) {
+	case 0: return x[i];
+	case 1: return x[i] - x[i - 1];
+	case 2: return x[i] - 2 * x[i - 1] + x[i - 2];
+	case 3: return x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+	default:
+		return x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+	}
+}
+
+inline uint32_t zigzag(const int32_t r)
+{
+	return (static_cast<uint32_t>(r) << 1) ^ static_cast<uint32_t>(r >> 31);
+}
+
+// The cheapest encoding found for one channel of a block
+struct SubframePlan {
+	enum class Type { Constant, Verbatim, Fixed } type = Type::Verbatim;
+	int order = 0;
+	int partition_order = 0;
+	std::array<uint8_t, 1 << max_partition_order> params = {};
+	std::vector<uint32_t> residuals = {}; // zigzagged
+	uint64_t bits = 0;
+};
+
+// Picks the Rice parameter that minimizes the partition's size, estimating
+// the unary part from the sum of the zigzagged residuals
+int best_rice_param(const uint64_t sum, const uint32_t count, uint64_t &bits)
+{
+	int best_param = 0;
+	bits = UINT64_MAX;
+	for (int k = 0; k <= max_rice_param; ++k) {
+		const auto cost = static_cast<uint64_t>(count) * (k + 1) + (sum >> k);
+		if (cost < bits) {
+			bits = cost;
+			best_param = k;
+		}
+	}
+	return best_param;
+}
+
+// Finds the partition order and Rice parameters for the residuals
+void plan_residual(SubframePlan &plan, const int n)
+{
+	int max_order = 0;
+	while (max_order < max_partition_order && (n % (2 << max_order)) == 0 &&
+	       (n >> (max_order + 1)) > plan.order)
+		++max_order;
+
+	// Sums for the finest partitioning, merged pairwise for coarser ones
+	std::array<uint64_t, 1 << max_partition_order> sums = {};
+	const int finest_size = n >> max_order;
+	for (int p = 0; p < (1 << max_order); ++p) {
+		const int start = std::max(p * finest_size, plan.order);
+		const int end = (p + 1) * finest_size;
+		uint64_t sum = 0;
+		for (int i = start; i < end; ++i)
+			sum += plan.residuals[i - plan.order];
+		sums[p] = sum;
+	}
+
+	uint64_t best_bits = UINT64_MAX;
+	for (int order = max_order; order >= 0; --order) {
+		if (order < max_order)
+			for (int p = 0; p < (1 << order); ++p)
+				sums[p] = sums[2 * p] + sums[2 * p + 1];
+
+		const int partition_size = n >> order;
+		uint64_t bits = 2 + 4; // coding method and partition order
+		std::array<uint8_t, 1 << max_partition_order> params = {};
+		for (int p = 0; p < (1 << order); ++p) {
+			const auto count = static_cast<uint32_t>(
+			        partition_size - (p == 0 ? plan.order : 0));
+			uint64_t partition_bits = 0;
+			params[p] = static_cast<uint8_t>(
+			        best_rice_param(sums[p], count, partition_bits));
+			bits += 4 + partition_bits;
+		}
+		if (bits < best_bits) {
+			best_bits = bits;
+			plan.partition_order = order;
+			plan.params = params;
+		}
+	}
+	plan.bits = best_bits;
+}
+
+void plan_subframe(SubframePlan &plan, const int32_t *x, const int n, const int bps)
+{
+	plan.type = SubframePlan::Type::Verbatim;
+	plan.bits = 8 + static_cast<uint64_t>(n) * bps;
+
+	if (std::all_of(x + 1, x + n, [&](const int32_t v) { return v == x[0]; })) {
+		plan.type = SubframePlan::Type::Constant;
+		plan.bits = 8 + static_cast<uint64_t>(bps);
+		return;
+	}
+	if (n <= max_fixed_order)
+		return;
+
+	// Choose the predictor order with the smallest absolute residual sum
+	std::array<uint64_t, max_fixed_order + 1> error_sums = {};
+	for (int i = max_fixed_order; i < n; ++i)
+		for (int order = 0; order <= max_fixed_order; ++order)
+			error_sums[order] += static_cast<uint64_t>(
+			        std::abs(fixed_residual(x, i, order)));
+	const auto best = std::min_element(error_sums.begin(), error_sums.end());
+	const auto order = static_cast<int>(best - error_sums.begin());
+
+	SubframePlan fixed = {};
+	fixed.type = SubframePlan::Type::Fixed;
+	fixed.order = order;
+	fixed.residuals.resize(static_cast<size_t>(n - order));
+	for (int i = order; i < n; ++i)
+		fixed.residuals[i - order] = zigzag(fixed_residual(x, i, order));
+	plan_residual(fixed, n);
+	fixed.bits += 8 + static_cast<uint64_t>(order) * bps;
+
+	if (fixed.bits < plan.bits)
+		plan = std::move(fixed);
+}
+
+void write_subframe(BitWriter &bits,
+                    const SubframePlan &plan,
+                    const int32_t *x,
+                    const int n,
+                    const int bps)
+{
+	switch (plan.type) {
+	case SubframePlan::Type::Constant:
+		bits.Write(0b0'000000'0, 8);
+		bits.WriteSigned(x[0], bps);
+		return;
+	case SubframePlan::Type::Verbatim:
+		bits.Write(0b0'000001'0, 8);
+		for (int i = 0; i < n; ++i)
+			bits.WriteSigned(x[i], bps);
+		return;
+	case SubframePlan::Type::Fixed: break;
+	}
+
+	bits.Write(0b0'001000'0 | static_cast<uint32_t>(plan.order << 1), 8);
+	for (int i = 0; i < plan.order; ++i)
+		bits.WriteSigned(x[i], bps);
+
+	bits.Write(0b00, 2); // Rice coding with 4-bit parameters
+	bits.Write(static_cast<uint32_t>(plan.partition_order), 4);
+	const int partition_size = n >> plan.partition_order;
+	auto residual = plan.residuals.begin();
+	for (int p = 0; p < (1 << plan.partition_order); ++p) {
+		const int k = plan.params[p];
+		bits.Write(static_cast<uint32_t>(k), 4);
+		const int count = partition_size - (p == 0 ? plan.order : 0);
+		for (int i = 0; i < count; ++i, ++residual) {
+			bits.WriteUnary(*residual >> k);
+			bits.Write(*residual, k);
+		}
+	}
+}
+
+} // namespace
+
+FlacEncoder::FlacEncoder(const uint32_t sample_rate) : rate(sample_rate)
+{
+	left.reserve(block_size);
+	right.reserve(block_size);
+}
+
+std::vector<uint8_t> FlacEncoder::GetHeader() const
+{
+	std::vector<uint8_t> header = {'f', 'L', 'a', 'C'};
+
+	// Last metadata block, of type STREAMINFO, 34 bytes long
+	BitWriter bits(header);
+	bits.Write(0x80, 8);
+	bits.Write(34, 24);
+
+	bits.Write(block_size, 16); // min block size
+	bits.Write(block_size, 16); // max block size
+	bits.Write(min_frame_bytes, 24);
+	bits.Write(max_frame_bytes, 24);
+	bits.Write(rate, 20);
+	bits.Write(2 - 1, 3); // channels
+	bits.Write(bits_per_sample - 1, 5);
+	bits.Write(static_cast<uint32_t>(total_frames >> 32), 4);
+	bits.Write(static_cast<uint32_t>(total_frames), 32);
+	for (int i = 0; i < 16; ++i)
+		bits.Write(0, 8); // MD5 signature, unset
+	return header;
+}
+
+void FlacEncoder::Add(const int16_t *frames, size_t num_frames, std::vector<uint8_t> &out)
+{
+	auto bytes = reinterpret_cast<const uint8_t *>(frames);
+	while (num_frames--) {
+		left.push_back(static_cast<int16_t>(le16_to_host(read_unaligned_uint16(bytes))));
+		right.push_back(static_cast<int16_t>(le16_to_host(read_unaligned_uint16(bytes + 2))));
+		bytes += 4;
+		if (left.size() == block_size)
+			EncodeBlock(out);
+	}
+}
+
+void FlacEncoder::Finish(std::vector<uint8_t> &out)
+{
+	if (!left.empty())
+		EncodeBlock(out);
+}
+
+void FlacEncoder::EncodeBlock(std::vector<uint8_t> &out)
+{
+	const auto n = static_cast<int>(left.size());
+	assert(n > 0 && n <= block_size);
+
+	std::vector<int32_t> mid(left.size());
+	std::vector<int32_t> side(left.size());
+	for (int i = 0; i < n; ++i) {
+		mid[i] = (left[i] + right[i]) >> 1;
+		side[i] = left[i] - right[i];
+	}
+
+	SubframePlan left_plan, right_plan, mid_plan, side_plan;
+	plan_subframe(left_plan, left.data(), n, bits_per_sample);
+	plan_subframe(right_plan, right.data(), n, bits_per_sample);
+	plan_subframe(mid_plan, mid.data(), n, bits_per_sample);
+	plan_subframe(side_plan, side.data(), n, bits_per_sample + 1);
+
+	auto stereo = Stereo::LeftRight;
+	auto best_bits = left_plan.bits + right_plan.bits;
+	auto consider = [&](const Stereo candidate, const uint64_t bits) {
+		if (bits < best_bits) {
+			best_bits = bits;
+			stereo = candidate;
+		}
+	};
+	consider(Stereo::LeftSide, left_plan.bits + side_plan.bits);
+	consider(Stereo::RightSide, side_plan.bits + right_plan.bits);
+	consider(Stereo::MidSide, mid_plan.bits + side_plan.bits);
+
+	// Frame header
+	const auto frame_start = out.size();
+	const auto rate_code = get_sample_rate_code(rate);
+	out.push_back(0xff);
+	out.push_back(0xf8); // fixed block size stream
+	out.push_back(static_cast<uint8_t>(0b0111 << 4 | rate_code)); // 16-bit block size
+	out.push_back(static_cast<uint8_t>(static_cast<uint8_t>(stereo) << 4 | 0b100 << 1));
+	write_utf8_number(out, frame_number);
+	out.push_back(static_cast<uint8_t>((n - 1) >> 8));
+	out.push_back(static_cast<uint8_t>(n - 1));
+	if (rate_code == 0b1100) {
+		out.push_back(static_cast<uint8_t>(rate / 1000));
+	} else if (rate_code == 0b1101 || rate_code == 0b1110) {
+		const auto value = rate_code == 0b1101 ? rate : rate / 10;
+		out.push_back(static_cast<uint8_t>(value >> 8));
+		out.push_back(static_cast<uint8_t>(value));
+	}
+	out.push_back(crc8(out.data() + frame_start, out.size() - frame_start));
+
+	// Subframes, in channel order
+	BitWriter bits(out);
+	constexpr int side_bps = bits_per_sample + 1;
+	switch (stereo) {
+	case Stereo::LeftRight:
+		write_subframe(bits, left_plan, left.data(), n, bits_per_sample);
+		write_subframe(bits, right_plan, right.data(), n, bits_per_sample);
+		break;
+	case Stereo::LeftSide:
+		write_subframe(bits, left_plan, left.data(), n, bits_per_sample);
+		write_subframe(bits, side_plan, side.data(), n, side_bps);
+		break;
+	case Stereo::RightSide:
+		write_subframe(bits, side_plan, side.data(), n, side_bps);
+		write_subframe(bits, right_plan, right.data(), n, bits_per_sample);
+		break;
+	case Stereo::MidSide:
+		write_subframe(bits, mid_plan, mid.data(), n, bits_per_sample);
+		write_subframe(bits, side_plan, side.data(), n, side_bps);
+		break;
+	}
+	bits.ZeroPadToByte();
+
+	// Frame footer
+	const auto crc = crc16(out.data() + frame_start, out.size() - frame_start);
+	out.push_back(static_cast<uint8_t>(crc >> 8));
+	out.push_back(static_cast<uint8_t>(crc));
+
+	const auto frame_bytes = static_cast<uint32_t>(out.size() - frame_start);
+	min_frame_bytes = min_frame_bytes ? std::min(min_frame_bytes, frame_bytes)
+	                                  : frame_bytes;
+	max_frame_bytes = std::max(max_frame_bytes, frame_bytes);
+	total_frames += static_cast<uint64_t>(n);
+	++frame_number;
+	left.clear();
+	right.clear();
+}
@@ -0,0 +1,76 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_FLAC_ENCODER_H
+#define DOSBOX_FLAC_ENCODER_H
+
+#include "dosbox.h"
+
+#include <cstdint>
+#include <vector>
+
+/*
+FlacEncoder compresses 16-bit stereo audio into a FLAC stream.
+
+It uses FLAC's fixed polynomial predictors, picks the cheapest of the
+left/right, left/side, right/side, and mid/side channel pairs per frame, and
+Rice-codes the residuals in partitions. This is close to the reference
+encoder's fast presets, without needing libFLAC.
+
+Usage:
+  FlacEncoder encoder(rate);
+  write(encoder.GetHeader());
+  encoder.Add(frames, num_frames, out); // repeat, writing 'out' each time
+  encoder.Finish(out);
+  rewrite_start_of_file(encoder.GetHeader()); // now with the totals
+
+The MD5 signature in the header is left unset, which FLAC allows.
+*/
+
+class FlacEncoder {
+public:
+	static constexpr uint16_t block_size = 4096; // frames per FLAC frame
+
+	FlacEncoder(uint32_t sample_rate);
+
+	// The "fLaC" marker and STREAMINFO block, which stay the same size
+	std::vector<uint8_t> GetHeader() const;
+
+	// Takes interleaved stereo frames in little-endian byte order, as the
+	// wave capture stores them, and appends each completed FLAC frame to out
+	void Add(const int16_t *frames, size_t num_frames, std::vector<uint8_t> &out);
+
+	// Encodes the remaining partial block, if any
+	void Finish(std::vector<uint8_t> &out);
+
+private:
+	void EncodeBlock(std::vector<uint8_t> &out);
+
+	std::vector<int32_t> left = {};
+	std::vector<int32_t> right = {};
+
+	const uint32_t rate = 0;
+	uint64_t total_frames = 0;
+	uint32_t frame_number = 0;
+	uint32_t min_frame_bytes = 0;
+	uint32_t max_frame_bytes = 0;
+};
+
+#endif
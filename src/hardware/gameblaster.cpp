@@ -23,7 +23,6 @@
 #include "hardware.h"
 #include "setup.h"
 #include "support.h"
-#include "pic.h"
 #include <cstring>
 #include <math.h>
 
@@ -36,8 +35,6 @@ constexpr uint32_t GAMEBLASTER_CLOCK_HZ = 7159090;
 
 //My mixer channel
 static mixer_channel_t cms_chan;
-//Timer to disable the channel after a while
-static Bit32u lastWriteTicks;
 static io_port_t cmsBase;
 static saa1099_device* device[2];
 
@@ -45,9 +42,8 @@ static void write_cms(io_port_t port, io_val_t value, io_width_t)
 {
 	const auto val = check_cast<uint8_t>(value);
 
-	if (cms_chan && (!cms_chan->is_enabled))
-		cms_chan->Enable(true);
-	lastWriteTicks = PIC_Ticks;
+	if (cms_chan)
+		cms_chan->WakeUp();
 	switch ( port - cmsBase ) {
 	case 1:
 		device[0]->control_w(0, 0, val);
@@ -73,12 +69,6 @@ static void CMS_CallBack(Bitu len) {
 		return;
 
 	if ( cms_chan ) {
-
-		//Have there been 10 seconds of no commands, disable channel
-		if ( lastWriteTicks + 10000 < PIC_Ticks ) {
-			cms_chan->Enable( false );
-			return;
-		}
 		Bit32s result[BUFFER_SIZE][2];
 		Bit16s work[2][BUFFER_SIZE];
 		Bit16s* buffers[2] = { work[0], work[1] };
@@ -150,8 +140,7 @@ public:
 
 		/* Register the Mixer CallBack */
 		cms_chan = MIXER_AddChannel(CMS_CallBack, sampleRate, "CMS");
-
-		lastWriteTicks = PIC_Ticks;
+		cms_chan->ConfigureSleep(true);
 
 		machine_config config;
 		device[0] = new saa1099_device(config, "", 0, GAMEBLASTER_CLOCK_HZ);
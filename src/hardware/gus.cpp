@@ -23,6 +23,7 @@
 
 #include <array>
 #include <iomanip>
+#include <limits>
 #include <memory>
 #include <string>
 #include <unistd.h>
@@ -30,11 +31,13 @@
 
 #include "control.h"
 #include "dma.h"
+#include "gus.h"
 #include "hardware.h"
 #include "mixer.h"
 #include "pic.h"
 #include "setup.h"
 #include "shell.h"
+#include "simd.h"
 #include "soft_limiter.h"
 #include "string_utils.h"
 
@@ -161,9 +164,21 @@ private:
 	float GetSample(const ram_array_t &ram) noexcept;
 	int32_t PopWavePos() noexcept;
 	float PopVolScalar(const vol_scalars_array_t &vol_scalars);
+	float ReadSample(const ram_array_t &ram, int32_t pos) const noexcept;
 	float Read8BitSample(const ram_array_t &ram, int32_t addr) const noexcept;
 	float Read16BitSample(const ram_array_t &ram, int32_t addr) const noexcept;
+	void ReadSamples(const ram_array_t &ram, float *samples, uint16_t num_samples) noexcept;
+	void ReadVolScalars(const vol_scalars_array_t &vol_scalars,
+	                    float *scalars,
+	                    uint16_t num_scalars) noexcept;
+	void RenderRun(float *frames_out,
+	               const ram_array_t &ram,
+	               const vol_scalars_array_t &vol_scalars,
+	               const AudioFrame &pan_scalar,
+	               uint16_t num_frames) noexcept;
 	uint8_t ReadCtrlState(const VoiceCtrl &ctrl) const noexcept;
+	int32_t GetCtrlStep(const VoiceCtrl &ctrl) const noexcept;
+	int32_t GetStepsToBoundary(const VoiceCtrl &ctrl) const noexcept;
 	void IncrementCtrlPos(VoiceCtrl &ctrl, bool skip_loop) noexcept;
 	bool UpdateCtrlState(VoiceCtrl &ctrl, uint8_t state) noexcept;
 
@@ -187,6 +202,10 @@ private:
 static void GUS_TimerEvent(uint32_t t);
 static void GUS_DMA_Event(uint32_t val);
 
+// Voices render the frames between control boundaries in runs, unless the
+// tests switch them to a frame at a time to compare the two
+static bool render_runs = true;
+
 using voice_array_t = std::array<std::unique_ptr<Voice>, MAX_VOICES>;
 
 // The Gravis UltraSound GF1 DSP (classic)
@@ -219,6 +238,7 @@ public:
 	Timer timer_one = {TIMER_1_DEFAULT_DELAY};
 	Timer timer_two = {TIMER_2_DEFAULT_DELAY};
 	bool PerformDmaTransfer();
+	void Render(uint16_t requested_frames, int16_t *out);
 
 private:
 	Gus() = delete;
@@ -227,6 +247,7 @@ private:
 
 	void ActivateVoices(uint8_t requested_voices);
 	void AudioCallback(uint16_t requested_frames);
+	uint16_t RenderFrames(uint16_t requested_frames);
 	void BeginPlayback();
 	void CheckIrq();
 	void CheckVoiceIrq();
@@ -406,9 +427,34 @@ bool Voice::Is16Bit() const noexcept
 	return (wave_ctrl.state & CTRL::BIT16);
 }
 
-float Voice::GetSample(const ram_array_t &ram) noexcept
+// Returns the signed amount the control's position moves each step
+int32_t Voice::GetCtrlStep(const VoiceCtrl &ctrl) const noexcept
+{
+	if (ctrl.state & CTRL::DISABLED)
+		return 0;
+	return (ctrl.state & CTRL::DECREASING) ? -ctrl.inc : ctrl.inc;
+}
+
+// Returns the number of steps until the control reaches its start or end,
+// where IncrementCtrlPos loops, stops, or raises an IRQ. Positions between
+// boundaries simply move by a fixed step.
+int32_t Voice::GetStepsToBoundary(const VoiceCtrl &ctrl) const noexcept
+{
+	constexpr auto never = std::numeric_limits<int32_t>::max();
+	if (ctrl.state & CTRL::DISABLED)
+		return never;
+	const auto distance = (ctrl.state & CTRL::DECREASING)
+	                              ? ctrl.pos - ctrl.start
+	                              : ctrl.end - ctrl.pos;
+	if (distance <= 0)
+		return 1;
+	if (ctrl.inc <= 0)
+		return never;
+	return ceil_sdivide(distance, ctrl.inc);
+}
+
+float Voice::ReadSample(const ram_array_t &ram, const int32_t pos) const noexcept
 {
-	const int32_t pos = PopWavePos();
 	const auto addr = pos / WAVE_WIDTH;
 	const auto fraction = pos & (WAVE_WIDTH - 1);
 	const bool should_interpolate = wave_ctrl.inc < WAVE_WIDTH && fraction;
@@ -428,6 +474,109 @@ float Voice::GetSample(const ram_array_t &ram) noexcept
 	return sample;
 }
 
+float Voice::GetSample(const ram_array_t &ram) noexcept
+{
+	return ReadSample(ram, PopWavePos());
+}
+
+// Reads a run of samples that doesn't reach a wave boundary
+void Voice::ReadSamples(const ram_array_t &ram,
+                        float *samples,
+                        const uint16_t num_samples) noexcept
+{
+	const auto step = GetCtrlStep(wave_ctrl);
+	auto pos = wave_ctrl.pos;
+	for (uint16_t i = 0; i < num_samples; ++i) {
+		samples[i] = ReadSample(ram, pos);
+		pos += step;
+	}
+	wave_ctrl.pos = pos;
+}
+
+// Looks up a run of volume scalars that doesn't reach a volume boundary
+void Voice::ReadVolScalars(const vol_scalars_array_t &vol_scalars,
+                           float *scalars,
+                           const uint16_t num_scalars) noexcept
+{
+	const auto step = GetCtrlStep(vol_ctrl);
+	auto pos = vol_ctrl.pos;
+	for (uint16_t i = 0; i < num_scalars; ++i) {
+		const auto index = ceil_sdivide(pos, VOLUME_INC_SCALAR);
+		assert(index >= 0 && index < static_cast<int>(vol_scalars.size()));
+		scalars[i] = vol_scalars[static_cast<size_t>(index)];
+		pos += step;
+	}
+	vol_ctrl.pos = pos;
+}
+
+// Scales the samples by their volume and adds them to the interleaved
+// frames, angled in L-R space. The products are rounded and added in the
+// same order as the per-frame path, so both produce identical output.
+static void mix_voice_frames(float *frames_out,
+                             const float *samples,
+                             const float *scalars,
+                             const uint16_t num_frames,
+                             const AudioFrame &pan_scalar)
+{
+	uint16_t i = 0;
+#if defined(SIMD_SSE2)
+	const auto pan = _mm_setr_ps(pan_scalar.left, pan_scalar.right,
+	                             pan_scalar.left, pan_scalar.right);
+	for (; i + 4 <= num_frames; i += 4) {
+		const auto sample = _mm_mul_ps(_mm_loadu_ps(samples + i),
+		                               _mm_loadu_ps(scalars + i));
+		float *out = frames_out + i * 2;
+		const auto lo = _mm_mul_ps(_mm_unpacklo_ps(sample, sample), pan);
+		const auto hi = _mm_mul_ps(_mm_unpackhi_ps(sample, sample), pan);
+		_mm_storeu_ps(out, _mm_add_ps(_mm_loadu_ps(out), lo));
+		_mm_storeu_ps(out + 4, _mm_add_ps(_mm_loadu_ps(out + 4), hi));
+	}
+#elif defined(SIMD_NEON)
+	const float pan_lr[4] = {pan_scalar.left, pan_scalar.right,
+	                         pan_scalar.left, pan_scalar.right};
+	const auto pan = vld1q_f32(pan_lr);
+	for (; i + 4 <= num_frames; i += 4) {
+		const auto sample = vmulq_f32(vld1q_f32(samples + i),
+		                              vld1q_f32(scalars + i));
+		float *out = frames_out + i * 2;
+		const auto pairs = vzipq_f32(sample, sample);
+		vst1q_f32(out, vaddq_f32(vld1q_f32(out), vmulq_f32(pairs.val[0], pan)));
+		vst1q_f32(out + 4,
+		          vaddq_f32(vld1q_f32(out + 4), vmulq_f32(pairs.val[1], pan)));
+	}
+#endif
+	for (; i < num_frames; ++i) {
+		const float sample = samples[i] * scalars[i];
+		const float left = sample * pan_scalar.left;
+		const float right = sample * pan_scalar.right;
+		frames_out[i * 2] += left;
+		frames_out[i * 2 + 1] += right;
+	}
+}
+
+// Renders a run of frames in which neither the wave nor the volume control
+// reaches a boundary.
+void Voice::RenderRun(float *frames_out,
+                      const ram_array_t &ram,
+                      const vol_scalars_array_t &vol_scalars,
+                      const AudioFrame &pan_scalar,
+                      const uint16_t num_frames) noexcept
+{
+	// A voice held at zero volume is silent, so only move its wave along
+	const bool is_vol_steady = vol_ctrl.state & CTRL::DISABLED;
+	if (is_vol_steady && ceil_sdivide(vol_ctrl.pos, VOLUME_INC_SCALAR) == 0) {
+		wave_ctrl.pos += GetCtrlStep(wave_ctrl) * num_frames;
+		return;
+	}
+	std::array<float, BUFFER_FRAMES> samples;
+	std::array<float, BUFFER_FRAMES> scalars;
+	assert(num_frames <= samples.size());
+	ReadSamples(ram, samples.data(), num_frames);
+	ReadVolScalars(vol_scalars, scalars.data(), num_frames);
+	mix_voice_frames(frames_out, samples.data(), scalars.data(), num_frames,
+	                 pan_scalar);
+}
+
 void Voice::GenerateSamples(std::vector<float> &render_buffer,
                             const ram_array_t &ram,
                             const vol_scalars_array_t &vol_scalars,
@@ -437,18 +586,35 @@ void Voice::GenerateSamples(std::vector<float> &render_buffer,
 	if (vol_ctrl.state & wave_ctrl.state & CTRL::DISABLED)
 		return;
 
-	// Setup our iterators and pan percents
-	auto val = render_buffer.begin();
-	const auto last_val = val + requested_frames * 2; // L * R channels
-	assert(last_val <= render_buffer.end());
+	// Setup our output pointer and pan percents
+	assert(requested_frames * 2u <= render_buffer.size()); // L * R channels
+	auto frames_out = render_buffer.data();
 	const auto pan_scalar = pan_scalars.at(pan_position);
 
-	// Add the samples to the render_buffer, angled in L-R space
-	while (val < last_val) {
+	uint16_t frames_left = requested_frames;
+	while (frames_left) {
+		// Render the frames ahead of the next boundary in one run
+		const auto steps = std::min(GetStepsToBoundary(wave_ctrl),
+		                            GetStepsToBoundary(vol_ctrl));
+		const auto run = static_cast<uint16_t>(
+		        std::min(steps - 1, static_cast<int32_t>(frames_left)));
+		if (run && render_runs) {
+			RenderRun(frames_out, ram, vol_scalars, pan_scalar, run);
+			frames_out += run * 2;
+			frames_left -= run;
+			continue;
+		}
+		// The boundary frame lets the controls loop, stop, or raise
+		// their IRQs
 		float sample = GetSample(ram);
 		sample *= PopVolScalar(vol_scalars);
-		*val++ += sample * pan_scalar.left;
-		*val++ += sample * pan_scalar.right;
+		// Separate statements, so a compiler that contracts a * b + c
+		// into a fused multiply-add rounds the same as the runs do
+		const float left = sample * pan_scalar.left;
+		const float right = sample * pan_scalar.right;
+		*frames_out++ += left;
+		*frames_out++ += right;
+		--frames_left;
 	}
 	// Keep track of how many ms this voice has generated
 	Is16Bit() ? generated_16bit_ms++ : generated_8bit_ms++;
@@ -638,32 +804,50 @@ void Gus::AudioCallback(const uint16_t requested_frames)
 {
 	uint16_t generated_frames = 0;
 	while (generated_frames < requested_frames) {
-		const uint16_t frames = static_cast<uint16_t>(
-		        std::min(BUFFER_FRAMES, requested_frames - generated_frames));
-
-		// Zero our buffer. The audio sequence for each active voice
-		// will be accumulated one at a time by the buffer's elements.
-		assert(frames <= render_buffer.size());
-		const auto num_samples = frames * 2;
-		std::fill_n(render_buffer.begin(), num_samples, 0.0f);
-
-		if (dac_enabled) {
-			auto voice = voices.begin();
-			const auto last_voice = voice + active_voices;
-			while (voice < last_voice && *voice) {
-				voice->get()->GenerateSamples(render_buffer,
-				                              ram, vol_scalars,
-				                              pan_scalars, frames);
-				++voice;
-			}
-		}
-		soft_limiter.Process(render_buffer, frames, play_buffer);
+		const auto frames = RenderFrames(requested_frames - generated_frames);
 		audio_channel->AddSamples_s16(frames, play_buffer.data());
-		CheckVoiceIrq();
 		generated_frames += frames;
 	}
 }
 
+// Renders the frames into the output instead of the mixer channel
+void Gus::Render(const uint16_t requested_frames, int16_t *out)
+{
+	uint16_t generated_frames = 0;
+	while (generated_frames < requested_frames) {
+		const auto frames = RenderFrames(requested_frames - generated_frames);
+		out = std::copy_n(play_buffer.begin(), frames * 2, out);
+		generated_frames += frames;
+	}
+}
+
+// Renders up to a buffer's worth of the requested frames into the play
+// buffer and returns how many it rendered
+uint16_t Gus::RenderFrames(const uint16_t requested_frames)
+{
+	const uint16_t frames = static_cast<uint16_t>(
+	        std::min(BUFFER_FRAMES, static_cast<int>(requested_frames)));
+
+	// Zero our buffer. The audio sequence for each active voice
+	// will be accumulated one at a time by the buffer's elements.
+	assert(frames <= render_buffer.size());
+	const auto num_samples = frames * 2;
+	std::fill_n(render_buffer.begin(), num_samples, 0.0f);
+
+	if (dac_enabled) {
+		auto voice = voices.begin();
+		const auto last_voice = voice + active_voices;
+		while (voice < last_voice && *voice) {
+			voice->get()->GenerateSamples(render_buffer, ram, vol_scalars,
+			                              pan_scalars, frames);
+			++voice;
+		}
+	}
+	soft_limiter.Process(render_buffer, frames, play_buffer);
+	CheckVoiceIrq();
+	return frames;
+}
+
 void Gus::BeginPlayback()
 {
 	dac_enabled = ((register_data & 0x200) != 0);
@@ -1547,6 +1731,17 @@ void init_gus_dosbox_settings(Section_prop &secprop)
 	                   "with Timidity should work fine.");
 }
 
+void GUS_Render(const uint16_t frames, int16_t *out)
+{
+	assert(gus);
+	gus->Render(frames, out);
+}
+
+void GUS_SetRunRendering(const bool enabled)
+{
+	render_runs = enabled;
+}
+
 void GUS_AddConfigSection(const config_ptr_t &conf)
 {
 	assert(conf);
@@ -0,0 +1,32 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef DOSBOX_GUS_H
+#define DOSBOX_GUS_H
+
+#include <cstdint>
+
+// Renders the GUS's output straight into out, bypassing the mixer, and
+// switches its voices between rendering in runs and a frame at a time. The
+// unit tests use these to check that both ways sound the same.
+void GUS_Render(uint16_t frames, int16_t *out);
+void GUS_SetRunRendering(bool enabled);
+
+#endif
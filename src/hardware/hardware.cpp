@@ -18,22 +18,32 @@
 
 #include "hardware.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <thread>
 
 #include "cross.h"
 #include "dosbox.h"
+#include "flac_encoder.h"
 #include "fs_utils.h"
 #include "mapper.h"
 #include "mem.h"
 #include "pic.h"
 #include "render.h"
 #include "rgb24.h"
+#include "rwring.h"
 #include "setup.h"
 #include "string_utils.h"
 #include "support.h"
+#include "worker_pool.h"
 
 #if (C_SSHOT)
 #include <png.h>
@@ -41,6 +51,7 @@
 #endif
 
 static std::string capturedir;
+static bool capture_audio_as_flac = false;
 extern const char* RunningProgram;
 Bitu CaptureState;
 
@@ -48,9 +59,30 @@ Bitu CaptureState;
 #define MIDI_BUF 4*1024
 #define AVI_HEADER_SIZE	500
 
+#if (C_SSHOT)
+// Frames waiting to be encoded; more than one lets the emulation thread carry
+// on while the writer thread compresses
+constexpr size_t CAPTURE_VIDEO_FRAMES = 4;
+
+// The motion search splits each frame's blocks over up to this many threads
+constexpr int CAPTURE_VIDEO_MAX_THREADS = 4;
+
+// A captured frame in the codec's format, and the audio that arrived with it
+struct VideoFrame {
+	int codec_flags = 0;
+	ZMBV_FORMAT format = ZMBV_FORMAT::NONE;
+	bool has_palette = false;
+	uint8_t palette[256 * 4] = {};
+	std::vector<uint8_t> pixels = {}; // whole lines, top to bottom
+	uint32_t audio_frames = 0;
+	std::vector<int16_t> audio = {}; // room for a full audio buffer
+};
+#endif
+
 static struct {
 	struct {
 		FILE *handle = nullptr;
+		FlacEncoder *flac_encoder = nullptr; // handed to the writer on stop
 		uint16_t buf[WAVE_BUF][2] = {};
 		uint32_t used = 0;
 		uint32_t length = 0;
@@ -77,12 +109,19 @@ static struct {
 		uint32_t audioused = 0;
 		uint32_t audiorate = 0;
 		uint32_t audiowritten = 0;
-		VideoCodec *codec = nullptr;
 		int width = 0;
 		int height = 0;
 		int bpp = 0;
-		uint32_t written = 0;
 		float fps = 0.0f;
+		int line_bytes = 0;
+		std::unique_ptr<RWRing<VideoFrame>> queue = {};
+		std::unique_ptr<WorkerPool> encoder_threads = {};
+
+		// Used by the writer thread while capturing, so only touched
+		// by the emulation thread before the first frame is queued and
+		// after the writes are flushed
+		VideoCodec *codec = nullptr;
+		uint32_t written = 0;
 		uint32_t bufSize = 0;
 		std::vector<uint8_t> buf = {};
 		std::vector<uint8_t> index = {};
@@ -147,8 +186,267 @@ FILE * OpenCaptureFile(const char * type,const char * ext) {
 	return handle;
 }
 
+/* Capture writer thread */
+
+// Sized to hold a full wave buffer per block, so the ring pools 2 MiB
+constexpr size_t CAPTURE_WRITER_BLOCKS = 32;
+constexpr size_t CAPTURE_WRITER_BLOCK_SIZE = 4 * WAVE_BUF;
+
+class CaptureWriter {
+public:
+	~CaptureWriter() { Stop(); }
+
+	void Write(FILE *handle, const void *data, size_t size);
+	void WriteAt(FILE *handle, long offset, const void *data, size_t size);
+	void Close(FILE *handle);
+
+	// Compresses the capture's PCM frames on the writer thread; finishing
+	// completes the file, closes it, and deletes the encoder
+	void EncodeFlac(FILE *handle, FlacEncoder *encoder, const int16_t *frames,
+	                size_t num_frames);
+	void FinishFlac(FILE *handle, FlacEncoder *encoder);
+
+	// Encodes the oldest queued video frame and appends it to the capture
+	void EncodeVideo(FILE *handle);
+	void Flush();
+	void Stop();
+
+private:
+	CaptureBlock *BeginBlock(CaptureBlock::Action action, FILE *handle);
+	void EndBlock();
+	void QueueData(CaptureBlock::Action action, FILE *handle,
+	               FlacEncoder *encoder, const void *data, size_t size);
+	void Run();
+	void ReportBackPressure();
+
+	std::unique_ptr<RWRing<CaptureBlock>> ring = {};
+	std::thread thread = {};
+	std::vector<uint8_t> encoded = {}; // writer thread only
+
+	// Operations queued by the emulation thread and completed by the
+	// writer thread; Flush() waits for the two to meet
+	uint64_t queued = 0;
+	uint64_t completed = 0;
+	std::mutex completed_mutex = {};
+	std::condition_variable has_completed = {};
+
+	// Back-pressure statistics, reset after each report
+	size_t peak_depth = 0;
+	uint32_t num_stalls = 0;
+	std::chrono::steady_clock::duration stalled_for = {};
+};
+
+static CaptureWriter capture_writer;
+
+CaptureBlock *CaptureWriter::BeginBlock(CaptureBlock::Action action, FILE *handle)
+{
+	if (!thread.joinable()) {
+		if (!ring) {
+			CaptureBlock prototype = {};
+			prototype.data.resize(CAPTURE_WRITER_BLOCK_SIZE);
+			ring = std::make_unique<RWRing<CaptureBlock>>(CAPTURE_WRITER_BLOCKS,
+			                                              prototype);
+		}
+		ring->Reset();
+		thread = std::thread(&CaptureWriter::Run, this);
+		set_thread_name(thread, "dosbox:capture");
+	}
+
+	// A full ring means the writer has fallen behind, so we wait for it
+	const auto depth = ring->Size();
+	peak_depth = std::max(peak_depth, depth);
+	CaptureBlock *block = nullptr;
+	if (depth < ring->MaxCapacity()) {
+		block = ring->BeginWrite();
+	} else {
+		const auto start = std::chrono::steady_clock::now();
+		block = ring->BeginWrite();
+		stalled_for += std::chrono::steady_clock::now() - start;
+		++num_stalls;
+	}
+	assert(block);
+	block->action = action;
+	block->handle = handle;
+	block->offset = 0;
+	block->flac_encoder = nullptr;
+	block->size = 0;
+	return block;
+}
+
+void CaptureWriter::EndBlock()
+{
+	++queued;
+	ring->EndWrite();
+}
+
+void CaptureWriter::QueueData(CaptureBlock::Action action, FILE *handle,
+                              FlacEncoder *encoder, const void *data, size_t size)
+{
+	auto bytes = static_cast<const uint8_t *>(data);
+	while (size > 0) {
+		auto block = BeginBlock(action, handle);
+		block->flac_encoder = encoder;
+		block->size = std::min(size, block->data.size());
+		std::copy_n(bytes, block->size, block->data.begin());
+		EndBlock();
+		bytes += block->size;
+		size -= block->size;
+	}
+}
+
+void CaptureWriter::Write(FILE *handle, const void *data, size_t size)
+{
+	QueueData(CaptureBlock::Action::Append, handle, nullptr, data, size);
+}
+
+void CaptureWriter::WriteAt(FILE *handle, long offset, const void *data, size_t size)
+{
+	assert(size <= CAPTURE_WRITER_BLOCK_SIZE);
+	auto block = BeginBlock(CaptureBlock::Action::WriteAt, handle);
+	block->offset = offset;
+	block->size = size;
+	std::copy_n(static_cast<const uint8_t *>(data), size, block->data.begin());
+	EndBlock();
+}
+
+void CaptureWriter::Close(FILE *handle)
+{
+	BeginBlock(CaptureBlock::Action::Close, handle);
+	EndBlock();
+}
+
+void CaptureWriter::EncodeFlac(FILE *handle, FlacEncoder *encoder,
+                               const int16_t *frames, size_t num_frames)
+{
+	// Blocks hold whole frames as their size is a multiple of four bytes
+	static_assert(CAPTURE_WRITER_BLOCK_SIZE % 4 == 0, "");
+	QueueData(CaptureBlock::Action::EncodeFlac, handle, encoder, frames,
+	          num_frames * 4);
+}
+
+void CaptureWriter::FinishFlac(FILE *handle, FlacEncoder *encoder)
+{
+	auto block = BeginBlock(CaptureBlock::Action::FinishFlac, handle);
+	block->flac_encoder = encoder;
+	EndBlock();
+}
+
+void CaptureWriter::EncodeVideo(FILE *handle)
+{
+	BeginBlock(CaptureBlock::Action::EncodeVideo, handle);
+	EndBlock();
+}
+
 #if (C_SSHOT)
-static void CAPTURE_AddAviChunk(const char * tag, Bit32u size, void * data, Bit32u flags) {
+static void CAPTURE_EncodeVideoFrame();
+#endif
+
+void CaptureWriter::Run()
+{
+	while (const auto block = ring->BeginRead()) {
+		switch (block->action) {
+		case CaptureBlock::Action::Append:
+			fwrite(block->data.data(), 1, block->size, block->handle);
+			break;
+		case CaptureBlock::Action::WriteAt: {
+			const auto end = ftell(block->handle);
+			fseek(block->handle, block->offset, SEEK_SET);
+			fwrite(block->data.data(), 1, block->size, block->handle);
+			fseek(block->handle, end, SEEK_SET);
+			break;
+		}
+		case CaptureBlock::Action::Close: fclose(block->handle); break;
+		case CaptureBlock::Action::EncodeFlac:
+			encoded.clear();
+			block->flac_encoder->Add(reinterpret_cast<const int16_t *>(
+			                                 block->data.data()),
+			                         block->size / 4, encoded);
+			fwrite(encoded.data(), 1, encoded.size(), block->handle);
+			break;
+		case CaptureBlock::Action::FinishFlac: {
+			encoded.clear();
+			block->flac_encoder->Finish(encoded);
+			fwrite(encoded.data(), 1, encoded.size(), block->handle);
+			// Rewrite the header, now that it has the totals
+			const auto header = block->flac_encoder->GetHeader();
+			fseek(block->handle, 0, SEEK_SET);
+			fwrite(header.data(), 1, header.size(), block->handle);
+			fclose(block->handle);
+			delete block->flac_encoder;
+			break;
+		}
+		case CaptureBlock::Action::EncodeVideo:
+#if (C_SSHOT)
+			CAPTURE_EncodeVideoFrame();
+#endif
+			break;
+		}
+		ring->EndRead();
+		{
+			const std::lock_guard<std::mutex> lock(completed_mutex);
+			++completed;
+		}
+		has_completed.notify_one();
+	}
+}
+
+void CaptureWriter::Flush()
+{
+	if (!thread.joinable())
+		return;
+	std::unique_lock<std::mutex> lock(completed_mutex);
+	has_completed.wait(lock, [this] { return completed == queued; });
+	lock.unlock();
+	ReportBackPressure();
+}
+
+void CaptureWriter::ReportBackPressure()
+{
+	if (num_stalls) {
+		using namespace std::chrono;
+		LOG_MSG("CAPTURE: Writing fell behind %u times, stalling for %.1f ms in total; "
+		        "consider a faster capture directory",
+		        num_stalls,
+		        duration<double, std::milli>(stalled_for).count());
+	}
+	DEBUG_LOG_MSG("CAPTURE: Writer queue peaked at %zu of %zu blocks",
+	              peak_depth, CAPTURE_WRITER_BLOCKS);
+	peak_depth = 0;
+	num_stalls = 0;
+	stalled_for = {};
+}
+
+void CaptureWriter::Stop()
+{
+	if (!thread.joinable())
+		return;
+	Flush();
+	ring->Stop();
+	thread.join();
+}
+
+void CAPTURE_QueueWrite(FILE *handle, const void *data, size_t size)
+{
+	capture_writer.Write(handle, data, size);
+}
+
+void CAPTURE_QueueWriteAt(FILE *handle, long offset, const void *data, size_t size)
+{
+	capture_writer.WriteAt(handle, offset, data, size);
+}
+
+void CAPTURE_QueueClose(FILE *handle)
+{
+	capture_writer.Close(handle);
+}
+
+void CAPTURE_FlushWrites()
+{
+	capture_writer.Flush();
+}
+
+#if (C_SSHOT)
+static void CAPTURE_AddAviChunk(const char * tag, Bit32u size, const void * data, Bit32u flags) {
 	Bit8u chunk[8];Bit8u *index;Bit32u pos, writesize;
 
 	chunk[0] = tag[0];chunk[1] = tag[1];chunk[2] = tag[2];chunk[3] = tag[3];
@@ -172,6 +470,34 @@ static void CAPTURE_AddAviChunk(const char * tag, Bit32u size, void * data, Bit3
 	host_writed(index+8, pos);
 	host_writed(index+12, size);
 }
+
+// Runs on the writer thread: compresses the oldest queued frame and appends
+// it, followed by its audio, as AVI chunks
+static void CAPTURE_EncodeVideoFrame()
+{
+	const auto frame = capture.video.queue->BeginRead();
+	if (!frame)
+		return;
+	auto &codec = *capture.video.codec;
+	if (codec.PrepareCompressFrame(frame->codec_flags, frame->format,
+	                               frame->has_palette ? frame->palette : nullptr,
+	                               capture.video.buf.data(),
+	                               capture.video.bufSize)) {
+		for (auto i = 0; i < capture.video.height; ++i) {
+			const uint8_t *line = frame->pixels.data() + i * capture.video.line_bytes;
+			codec.CompressLines(1, &line);
+		}
+		const int written = codec.FinishCompressFrame();
+		if (written >= 0) {
+			CAPTURE_AddAviChunk("00dc", written, capture.video.buf.data(),
+			                    frame->codec_flags & 1 ? 0x10 : 0x0);
+			if (frame->audio_frames)
+				CAPTURE_AddAviChunk("01wb", frame->audio_frames * 4,
+				                    frame->audio.data(), 0);
+		}
+	}
+	capture.video.queue->EndRead();
+}
 #endif
 
 #if (C_SSHOT)
@@ -179,7 +505,8 @@ static void CAPTURE_VideoEvent(bool pressed) {
 	if (!pressed)
 		return;
 	if (CaptureState & CAPTURE_VIDEO) {
-		/* Close the video */
+		/* Wait for the queued frames, then close the video */
+		CAPTURE_FlushWrites();
 		if (capture.video.codec)
 			capture.video.codec->FinishVideo();
 		CaptureState &= ~CAPTURE_VIDEO;
@@ -306,6 +633,9 @@ static void CAPTURE_VideoEvent(bool pressed) {
 		fwrite(&avi_header, 1, AVI_HEADER_SIZE, capture.video.handle);
 		fclose(capture.video.handle);
 		delete capture.video.codec;
+		capture.video.codec = nullptr;
+		capture.video.queue.reset();
+		capture.video.encoder_threads.reset();
 		capture.video.handle = nullptr;
 	} else {
 		CaptureState |= CAPTURE_VIDEO;
@@ -555,6 +885,22 @@ skip_shot:
 			capture.video.index.resize(16 * 4096);
 			capture.video.indexused = 8;
 
+			capture.video.encoder_threads = std::make_unique<WorkerPool>(
+			        WorkerPool::DefaultNumThreads(CAPTURE_VIDEO_MAX_THREADS),
+			        "dosbox:zmbv");
+			capture.video.codec->SetParallelFor(
+			        [pool = capture.video.encoder_threads.get()](
+			                const int num_jobs, const WorkerPool::job_f &job) {
+				        pool->Run(num_jobs, job);
+			        });
+
+			capture.video.line_bytes = width * (bpp == 8 ? 1 : bpp <= 16 ? 2 : 4);
+			VideoFrame prototype = {};
+			prototype.pixels.resize(static_cast<size_t>(capture.video.line_bytes) * height);
+			prototype.audio.resize(WAVE_BUF * 2);
+			capture.video.queue = std::make_unique<RWRing<VideoFrame>>(
+			        CAPTURE_VIDEO_FRAMES, prototype);
+
 			capture.video.width = width;
 			capture.video.height = height;
 			capture.video.bpp = bpp;
@@ -570,10 +916,15 @@ skip_shot:
 		if (capture.video.frames % 300 == 0)
 			codecFlags = 1;
 		else codecFlags = 0;
-		if (!capture.video.codec->PrepareCompressFrame(codecFlags, format, pal,
-		                                               capture.video.buf.data(),
-		                                               capture.video.bufSize))
+		/* Copy the frame for the writer thread to encode */
+		const auto frame = capture.video.queue->BeginWrite();
+		if (!frame)
 			goto skip_video;
+		frame->codec_flags = codecFlags;
+		frame->format = format;
+		frame->has_palette = (pal != nullptr);
+		if (pal)
+			memcpy(frame->palette, pal, sizeof(frame->palette));
 
 		const bool is_double_width = flags & CAPTURE_FLAG_DBLW;
 		const auto height_divisor = (flags & CAPTURE_FLAG_DBLH) ? 1 : 0;
@@ -621,19 +972,18 @@ skip_shot:
 					rowPointer = srcLine;
 				}
 			}
-			capture.video.codec->CompressLines( 1, &rowPointer);
+			memcpy(frame->pixels.data() + i * capture.video.line_bytes,
+			       rowPointer, static_cast<size_t>(capture.video.line_bytes));
 		}
-		int written = capture.video.codec->FinishCompressFrame();
-		if (written < 0)
-			goto skip_video;
-		CAPTURE_AddAviChunk("00dc", written, capture.video.buf.data(), codecFlags & 1 ? 0x10 : 0x0);
-		capture.video.frames++;
-//		LOG_MSG("Frame %d video %d audio %d",capture.video.frames, written, capture.video.audioused *4 );
+		frame->audio_frames = capture.video.audioused;
 		if ( capture.video.audioused ) {
-			CAPTURE_AddAviChunk( "01wb", capture.video.audioused * 4, capture.video.audiobuf, 0);
+			memcpy(frame->audio.data(), capture.video.audiobuf, capture.video.audioused * 4);
 			capture.video.audiowritten = capture.video.audioused*4;
 			capture.video.audioused = 0;
 		}
+		capture.video.queue->EndWrite();
+		capture_writer.EncodeVideo(capture.video.handle);
+		capture.video.frames++;
 
 		/* Everything went okay, set flag again for next frame */
 		CaptureState |= CAPTURE_VIDEO;
@@ -662,6 +1012,17 @@ static Bit8u wavheader[]={
 	0x0,0x0,0x0,0x0,							/* Bit32u data size */
 };
 
+// Queues the buffered frames, which the writer compresses when capturing to FLAC
+static void CAPTURE_WriteWaveBuffer()
+{
+	const auto buf = reinterpret_cast<const int16_t *>(capture.wave.buf);
+	if (capture.wave.flac_encoder)
+		capture_writer.EncodeFlac(capture.wave.handle, capture.wave.flac_encoder,
+		                          buf, capture.wave.used);
+	else
+		CAPTURE_QueueWrite(capture.wave.handle, buf, capture.wave.used * 4);
+}
+
 void CAPTURE_AddWave(Bit32u freq, Bit32u len, Bit16s * data) {
 #if (C_SSHOT)
 	if (CaptureState & CAPTURE_VIDEO) {
@@ -675,7 +1036,10 @@ void CAPTURE_AddWave(Bit32u freq, Bit32u len, Bit16s * data) {
 #endif
 	if (CaptureState & CAPTURE_WAVE) {
 		if (!capture.wave.handle) {
-			capture.wave.handle=OpenCaptureFile("Wave Output",".wav");
+			if (capture_audio_as_flac)
+				capture.wave.handle = OpenCaptureFile("FLAC Output", ".flac");
+			else
+				capture.wave.handle = OpenCaptureFile("Wave Output", ".wav");
 			if (!capture.wave.handle) {
 				CaptureState &= ~CAPTURE_WAVE;
 				return;
@@ -683,13 +1047,19 @@ void CAPTURE_AddWave(Bit32u freq, Bit32u len, Bit16s * data) {
 			capture.wave.length = 0;
 			capture.wave.used = 0;
 			capture.wave.freq = freq;
-			fwrite(wavheader,1,sizeof(wavheader),capture.wave.handle);
+			if (capture_audio_as_flac) {
+				capture.wave.flac_encoder = new FlacEncoder(freq);
+				const auto header = capture.wave.flac_encoder->GetHeader();
+				CAPTURE_QueueWrite(capture.wave.handle, header.data(), header.size());
+			} else {
+				CAPTURE_QueueWrite(capture.wave.handle, wavheader, sizeof(wavheader));
+			}
 		}
 		Bit16s * read = data;
 		while (len > 0 ) {
 			Bitu left = WAVE_BUF - capture.wave.used;
 			if (!left) {
-				fwrite(capture.wave.buf,1,4*WAVE_BUF,capture.wave.handle);
+				CAPTURE_WriteWaveBuffer();
 				capture.wave.length += 4*WAVE_BUF;
 				capture.wave.used = 0;
 				left = WAVE_BUF;
@@ -710,23 +1080,39 @@ static void CAPTURE_WaveEvent(bool pressed) {
 	if (capture.wave.handle) {
 		LOG_MSG("Stopped capturing wave output.");
 		/* Write last piece of audio in buffer */
-		fwrite(capture.wave.buf,1,capture.wave.used*4,capture.wave.handle);
+		CAPTURE_WriteWaveBuffer();
 		capture.wave.length+=capture.wave.used*4;
+		if (capture.wave.flac_encoder) {
+			capture_writer.FinishFlac(capture.wave.handle, capture.wave.flac_encoder);
+			CAPTURE_FlushWrites();
+			capture.wave.flac_encoder = nullptr;
+			capture.wave.handle = 0;
+			CaptureState &= ~CAPTURE_WAVE;
+			return;
+		}
 		/* Fill in the header with useful information */
 		host_writed(&wavheader[0x04],capture.wave.length+sizeof(wavheader)-8);
 		host_writed(&wavheader[0x18],capture.wave.freq);
 		host_writed(&wavheader[0x1C],capture.wave.freq*4);
 		host_writed(&wavheader[0x28],capture.wave.length);
 		
-		fseek(capture.wave.handle,0,0);
-		fwrite(wavheader,1,sizeof(wavheader),capture.wave.handle);
-		fclose(capture.wave.handle);
+		CAPTURE_QueueWriteAt(capture.wave.handle, 0, wavheader, sizeof(wavheader));
+		CAPTURE_QueueClose(capture.wave.handle);
+		CAPTURE_FlushWrites();
 		capture.wave.handle=0;
 		CaptureState |= CAPTURE_WAVE;
 	} 
 	CaptureState ^= CAPTURE_WAVE;
 }
 
+void CAPTURE_WaveStart()
+{
+	if (CaptureState & CAPTURE_WAVE)
+		LOG_MSG("Already capturing wave output.");
+	else
+		CAPTURE_WaveEvent(true);
+}
+
 /* MIDI capturing */
 
 static Bit8u midi_header[]={
@@ -745,7 +1131,7 @@ static void RawMidiAdd(Bit8u data) {
 	capture.midi.buffer[capture.midi.used++]=data;
 	if (capture.midi.used >= MIDI_BUF ) {
 		capture.midi.done += capture.midi.used;
-		fwrite(capture.midi.buffer,1,MIDI_BUF,capture.midi.handle);
+		CAPTURE_QueueWrite(capture.midi.handle, capture.midi.buffer, MIDI_BUF);
 		capture.midi.used = 0;
 	}
 }
@@ -763,7 +1149,7 @@ void CAPTURE_AddMidi(bool sysex, Bitu len, Bit8u * data) {
 		if (!capture.midi.handle) {
 			return;
 		}
-		fwrite(midi_header,1,sizeof(midi_header),capture.midi.handle);
+		CAPTURE_QueueWrite(capture.midi.handle, midi_header, sizeof(midi_header));
 		capture.midi.last=PIC_Ticks;
 	}
 	Bit32u delta=PIC_Ticks-capture.midi.last;
@@ -790,16 +1176,16 @@ static void CAPTURE_MidiEvent(bool pressed) {
 		RawMidiAdd(0x2F);
 		RawMidiAdd(0x00);
 		/* clear out the final data in the buffer if any */
-		fwrite(capture.midi.buffer,1,capture.midi.used,capture.midi.handle);
+		CAPTURE_QueueWrite(capture.midi.handle, capture.midi.buffer, capture.midi.used);
 		capture.midi.done+=capture.midi.used;
-		fseek(capture.midi.handle,18, SEEK_SET);
 		Bit8u size[4];
 		size[0]=(Bit8u)(capture.midi.done >> 24);
 		size[1]=(Bit8u)(capture.midi.done >> 16);
 		size[2]=(Bit8u)(capture.midi.done >> 8);
 		size[3]=(Bit8u)(capture.midi.done >> 0);
-		fwrite(&size,1,4,capture.midi.handle);
-		fclose(capture.midi.handle);
+		CAPTURE_QueueWriteAt(capture.midi.handle, 18, size, 4);
+		CAPTURE_QueueClose(capture.midi.handle);
+		CAPTURE_FlushWrites();
 		capture.midi.handle=0;
 		CaptureState &= ~CAPTURE_MIDI;
 		return;
@@ -821,6 +1207,8 @@ public:
 		Section_prop * section = static_cast<Section_prop *>(configuration);
 		Prop_path* proppath= section->Get_path("captures");
 		capturedir = proppath->realpath;
+		const std::string audio_format = section->Get_string("audio_capture_format");
+		capture_audio_as_flac = (audio_format == "flac");
 		CaptureState = 0;
 		MAPPER_AddHandler(CAPTURE_WaveEvent, SDL_SCANCODE_F6,
 		                  PRIMARY_MOD, "recwave", "Rec. Audio");
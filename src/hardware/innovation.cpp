@@ -26,6 +26,11 @@
 // -------------------
 constexpr uint16_t SAMPLES_PER_BUFFER = 2048;
 
+Innovation::Innovation()
+        : buffers(num_buffers, std::vector<int16_t>(SAMPLES_PER_BUFFER)),
+          keep_rendering(false)
+{}
+
 void Innovation::Open(const std::string &model_choice,
                       const std::string &clock_choice,
                       const int filter_strength_6581,
@@ -77,6 +82,9 @@ void Innovation::Open(const std::string &model_choice,
 	const auto mixer_callback = std::bind(&Innovation::MixerCallBack, this, _1);
 	const auto mixer_channel = MIXER_AddChannel(mixer_callback, 0, "INNOVATION");
 	sid_sample_rate = mixer_channel->GetSampleRate();
+	mixer_channel->RegisterQueueDepthCallBack([this] {
+		return MixerChannel::QueueDepth{buffers.Size(), buffers.MaxCapacity()};
+	});
 
 	// Determine the passband frequency, which is capped at 90% of Nyquist.
 	const double passband = 0.9 * sid_sample_rate / 2;
@@ -100,11 +108,12 @@ void Innovation::Open(const std::string &model_choice,
 	last_used = 0;
 	play_buffer_pos = 0;
 	keep_rendering = true;
+	buffers.Reset();
 
 	// Start rendering
 	renderer = std::thread(std::bind(&Innovation::Render, this));
 	set_thread_name(renderer, "dosbox:innovatn"); // < 16-character cap
-	play_buffer = playable.Dequeue(); // populate the first play buffer
+	play_buffer = buffers.BeginRead(); // wait for the first play buffer
 
 	if (filter_strength == 0)
 		LOG_MSG("INNOVATION: Running on port %xh with a SID %s at %0.3f MHz",
@@ -128,12 +137,10 @@ void Innovation::Close()
 	if (channel)
 		channel->Enable(false);
 
-	// Stop rendering and drain the queues
+	// Stop rendering and release the renderer if it's waiting on the ring
 	keep_rendering = false;
-	if (!backstock.Size())
-		backstock.Enqueue(std::move(play_buffer));
-	while (playable.Size())
-		play_buffer = playable.Dequeue();
+	buffers.Stop();
+	play_buffer = nullptr;
 
 	// Wait for the rendering thread to finish
 	if (renderer.joinable())
@@ -176,23 +183,16 @@ void Innovation::Render()
 	const auto cycles_per_sample = static_cast<uint16_t>(chip_clock /
 	                                                     sid_sample_rate);
 
-	// Allocate one buffer and reuse it for the duration.
-	std::vector<int16_t> buffer(SAMPLES_PER_BUFFER);
-
-	// Populate the backstock queue using copies of the current buffer.
-	while (backstock.Size() < backstock.MaxCapacity() - 1)
-		backstock.Enqueue(buffer);    // copied
-	backstock.Enqueue(std::move(buffer)); // moved; buffer is hollow
-	assert(backstock.Size() == backstock.MaxCapacity());
-
 	while (keep_rendering.load()) {
-		// Variables populated during rendering.
+		// Wait for a free buffer in the ring and render into it in-place.
+		const auto buffer = buffers.BeginWrite();
+		if (!buffer)
+			break;
 		uint16_t n = 0;
-		buffer = backstock.Dequeue();
 		std::unique_lock<std::mutex> lock(service_mutex);
 
 		while (n < SAMPLES_PER_BUFFER) {
-			const auto buffer_pos = buffer.data() + n;
+			const auto buffer_pos = buffer->data() + n;
 			const auto n_remaining = SAMPLES_PER_BUFFER - n;
 			const auto cycles = static_cast<unsigned int>(cycles_per_sample * n_remaining);
 			n += service->clock(cycles, buffer_pos);
@@ -200,8 +200,8 @@ void Innovation::Render()
 		assert(n == SAMPLES_PER_BUFFER);
 		lock.unlock();
 
-		// The buffer is now populated so move it into the playable queue.
-		playable.Enqueue(std::move(buffer));
+		// The buffer is now populated so publish it to the mixer.
+		buffers.EndWrite();
 	}
 }
 
@@ -209,7 +209,11 @@ void Innovation::MixerCallBack(uint16_t requested_samples)
 {
 	while (requested_samples) {
 		const auto n = std::min(GetRemainingSamples(), requested_samples);
-		const auto buffer_pos = play_buffer.data() + play_buffer_pos;
+		if (!play_buffer) {
+			channel->AddSilence();
+			return;
+		}
+		const auto buffer_pos = play_buffer->data() + play_buffer_pos;
 		channel->AddSamples_m16(n, buffer_pos);
 		requested_samples -= n;
 		play_buffer_pos += n;
@@ -225,12 +229,13 @@ void Innovation::MixerCallBack(uint16_t requested_samples)
 uint16_t Innovation::GetRemainingSamples()
 {
 	// If the current buffer has some samples left, then return those ...
-	if (play_buffer_pos < SAMPLES_PER_BUFFER)
+	if (play_buffer && play_buffer_pos < SAMPLES_PER_BUFFER)
 		return SAMPLES_PER_BUFFER - play_buffer_pos;
 
-	// Otherwise put the spent buffer in backstock and get the next buffer.
-	backstock.Enqueue(std::move(play_buffer));
-	play_buffer = playable.Dequeue();
+	// Otherwise hand the spent buffer back and wait for the next buffer.
+	if (play_buffer)
+		buffers.EndRead();
+	play_buffer = buffers.BeginRead();
 	play_buffer_pos = 0; // reset the sample counter to the beginning.
 
 	return SAMPLES_PER_BUFFER;
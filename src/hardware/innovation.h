@@ -32,12 +32,12 @@
 
 #include "mixer.h"
 #include "inout.h"
-#include "rwqueue.h"
+#include "rwring.h"
 #include "../libs/residfp/SID.h"
 
 class Innovation {
 public:
-	Innovation() : keep_rendering(false) {}
+	Innovation();
 	void Open(const std::string &model_choice,
 	          const std::string &clock_choice,
 	          int filter_strength_6581,
@@ -60,10 +60,9 @@ private:
 	IO_ReadHandleObject read_handler = {};
 	IO_WriteHandleObject write_handler = {};
 
-	std::vector<int16_t> play_buffer = {};
 	static constexpr auto num_buffers = 4;
-	RWQueue<std::vector<int16_t>> playable{num_buffers};
-	RWQueue<std::vector<int16_t>> backstock{num_buffers};
+	RWRing<std::vector<int16_t>> buffers;
+	const std::vector<int16_t> *play_buffer = nullptr;
 	std::thread renderer = {};
 	std::mutex service_mutex = {};
 	std::unique_ptr<reSIDfp::SID> service = {};
@@ -26,9 +26,11 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <cinttypes>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
+#include <limits>
 #include <map>
 #include <mutex>
 #include <sys/types.h>
@@ -79,6 +81,10 @@
 // should the envelope monitor the initial signal? (recommended > 5s)
 #define ENVELOPE_EXPIRES_AFTER_S 10u
 
+// How long must a sleep-enabled channel be both silent and untouched by
+// its device before it stops calling its handler?
+#define SLEEP_AFTER_IDLE_MS 3000u
+
 template <class T, size_t ROWS, size_t COLS>
 using matrix = std::array<std::array<T, COLS>, ROWS>;
 using work_index_t = uint16_t;
@@ -112,10 +118,48 @@ struct mixer_t {
 
 	SDL_AudioDeviceID sdldevice = 0;
 	bool nosound = false;
+
+	// Offline rendering runs without an audio device, producing exactly
+	// the frames that the elapsed emulated time implies
+	bool offline = false;
+	uint64_t offline_ticks = 0;
+	uint64_t offline_frames = 0;
 };
 
 static struct mixer_t mixer = {};
 
+// Buffer-health counters updated by the audio device's callback thread and
+// reported by MIXER /STATS
+struct mixer_stats_t {
+	// Upper bounds of the buffered-frames buckets, as a percent of the
+	// frames requested by the callback
+	static constexpr std::array<int, 7> buffered_bounds = {25,  50,  100, 150,
+	                                                        200, 300, 400};
+	// Upper bounds of the stretch buckets, in hundredths of a percent of
+	// the frames consumed per frame played. Below 100% stretches the audio
+	// to cover an underrun and above 100% squeezes it to drain an overrun.
+	static constexpr std::array<int, 4> stretch_bounds = {9900, 10000, 10001,
+	                                                       10100};
+
+	std::atomic<uint32_t> callbacks = 0;
+	std::atomic<uint32_t> full_underruns = 0; // played silence instead
+	std::atomic<uint32_t> underruns = 0;
+	std::atomic<uint32_t> overruns = 0;
+	std::array<std::atomic<uint32_t>, buffered_bounds.size() + 1> buffered = {};
+	std::array<std::atomic<uint32_t>, stretch_bounds.size() + 1> stretch = {};
+};
+
+static mixer_stats_t mixer_stats = {};
+
+template <size_t N>
+static size_t find_bucket(const std::array<int, N> &bounds, const int64_t value)
+{
+	size_t i = 0;
+	while (i < N && value >= bounds[i])
+		++i;
+	return i;
+}
+
 Bit8u MixTemp[MIXER_BUFSIZE] = {};
 
 MixerChannel::MixerChannel(MIXER_Handler _handler, const char *_name) : envelope(_name), handler(_handler)
@@ -172,6 +216,13 @@ void MixerChannel::RegisterLevelCallBack(apply_level_callback_f cb)
 	apply_level(level);
 }
 
+void MixerChannel::RegisterQueueDepthCallBack(queue_depth_callback_f cb)
+{
+	std::lock_guard lock(mixer.channel_mutex);
+	queue_depth = cb;
+	stats = {};
+}
+
 void MixerChannel::UpdateVolume()
 {
 	// Don't scale by volmain[] if the level is being managed by the source
@@ -293,15 +344,61 @@ void MixerChannel::SetPeakAmplitude(const int peak)
 	                ENVELOPE_MAX_EXPANSION_OVER_MS, ENVELOPE_EXPIRES_AFTER_S);
 }
 
+void MixerChannel::ConfigureSleep(const bool should_sleep)
+{
+	can_sleep = should_sleep;
+	last_active_ticks = PIC_Ticks;
+}
+
+bool MixerChannel::WakeUp()
+{
+	last_active_ticks = PIC_Ticks;
+	if (is_enabled)
+		return false;
+
+	Enable(true);
+	// Fade the device back in, as it may resume mid-waveform
+	envelope.Reactivate();
+	return true;
+}
+
+// Put the channel to sleep if its output has held a steady level, silent or
+// not, and its device hasn't been woken up for a while.
+void MixerChannel::MaybeSleep()
+{
+	if (had_signal) {
+		had_signal = false;
+		last_active_ticks = PIC_Ticks;
+		return;
+	}
+	if (PIC_Ticks - last_active_ticks > SLEEP_AFTER_IDLE_MS)
+		Enable(false);
+}
+
 void MixerChannel::Mix(const int _needed)
 {
 	needed = _needed;
+	if (is_enabled) {
+		const auto lag = needed - done;
+		++stats.mixes;
+		stats.total_lag += lag;
+		stats.peak_lag = std::max(stats.peak_lag, lag);
+		if (queue_depth) {
+			const auto depth = queue_depth();
+			stats.total_queued += check_cast<int64_t>(depth.queued);
+			stats.min_queued = std::min(stats.min_queued, depth.queued);
+			stats.peak_queued = std::max(stats.peak_queued, depth.queued);
+			stats.queue_capacity = depth.capacity;
+		}
+	}
 	while (is_enabled && needed > done) {
 		auto left = needed - done;
 		left *= freq_add;
 		left  = (left >> FREQ_SHIFT) + ((left & FREQ_MASK)!=0);
 		handler(check_cast<uint16_t>(left));
 	}
+	if (can_sleep && is_enabled)
+		MaybeSleep();
 }
 
 void MixerChannel::AddSilence()
@@ -504,6 +601,11 @@ void MixerChannel::AddSamples(uint16_t len, const Type *data)
 			}
 			//This sample has been handled now, increase position
 			pos++;
+			// A level that holds steady, such as a DC offset, is
+			// as inaudible as silence
+			if (can_sleep)
+				had_signal |= next_sample[0] != prev_sample[0] ||
+				              (stereo && next_sample[1] != prev_sample[1]);
 #if MIXER_UPRAMP_STEPS > 0
 			if (last_samples_were_silence && pos == 1) {
 				offset[0] = next_sample[0] - prev_sample[0];
@@ -778,16 +880,22 @@ static void MIXER_ReduceChannelsDoneCounts(const int at_most)
 		it.second->done -= std::min(it.second->done.load(), at_most);
 }
 
-static void MIXER_Mix_NoSound()
+// Mixes the given frames and discards them, as there's no device to play them
+static void MIXER_MixAndDiscard(const int frames)
 {
-	MIXER_MixData(mixer.needed);
+	MIXER_MixData(frames);
 	/* Clear piece we've just generated */
-	for (auto i = 0; i < mixer.needed; ++i) {
+	for (auto i = 0; i < frames; ++i) {
 		mixer.work[mixer.pos][0]=0;
 		mixer.work[mixer.pos][1]=0;
 		mixer.pos=(mixer.pos+1)&MIXER_BUFMASK;
 	}
-	MIXER_ReduceChannelsDoneCounts(mixer.needed);
+	MIXER_ReduceChannelsDoneCounts(frames);
+}
+
+static void MIXER_Mix_NoSound()
+{
+	MIXER_MixAndDiscard(mixer.needed);
 
 	/* Set values for next tick */
 	mixer.tick_counter += mixer.tick_add;
@@ -796,6 +904,53 @@ static void MIXER_Mix_NoSound()
 	mixer.done=0;
 }
 
+// The running total of frames due after the given number of offline ticks.
+// It's derived from the tick count rather than accumulated from a fixed-point
+// step, so N ms of emulated time always yield N * rate / 1000 frames,
+// regardless of how fast the host runs the emulation.
+static uint64_t offline_frames_due(const uint64_t ticks)
+{
+	return ticks * static_cast<uint64_t>(mixer.freq) / 1000;
+}
+
+// Renders the frames due by the end of the current millisecond tick
+static void MIXER_Mix_Offline()
+{
+	++mixer.offline_ticks;
+	const auto due = offline_frames_due(mixer.offline_ticks);
+	const auto frames = check_cast<int>(due - mixer.offline_frames);
+
+	MIXER_MixAndDiscard(frames);
+	mixer.done = 0;
+	mixer.offline_frames = due;
+
+	// Channels filled up mid-tick render that fraction of the frames
+	// needed, so it has to hold the next tick's count, as in NoSound mode
+	mixer.needed = check_cast<int>(
+	        offline_frames_due(mixer.offline_ticks + 1) - due);
+}
+
+void MIXER_StartOffline()
+{
+	// Take over from whichever handler has been driving the mixer
+	TIMER_DelTickHandler(MIXER_Mix);
+	TIMER_DelTickHandler(MIXER_Mix_NoSound);
+	if (mixer.sdldevice)
+		SDL_PauseAudioDevice(mixer.sdldevice, 1);
+
+	mixer.offline = true;
+	mixer.nosound = true;
+	mixer.offline_ticks = 0;
+	mixer.offline_frames = 0;
+	mixer.done = 0;
+	mixer.needed = check_cast<int>(offline_frames_due(1));
+	MIXER_ReduceChannelsDoneCounts(std::numeric_limits<int>::max());
+	TIMER_AddTickHandler(MIXER_Mix_Offline);
+
+	// Emulated time no longer follows the host's clock
+	ticksLocked = true;
+}
+
 #define INDEX_SHIFT_LOCAL 14
 
 static void SDLCALL MIXER_CallBack([[maybe_unused]] void *userdata, Uint8 *stream, int len)
@@ -811,11 +966,18 @@ static void SDLCALL MIXER_CallBack([[maybe_unused]] void *userdata, Uint8 *strea
 	auto index = (index_add % need) ? need : 0;
 
 	auto sample = 0;
+	++mixer_stats.callbacks;
+	const auto buffered_pct = static_cast<int64_t>(mixer.done) * 100 / need;
+	++mixer_stats.buffered[find_bucket(mixer_stats.buffered_bounds, buffered_pct)];
+
 	/* Enough room in the buffer ? */
 	if (mixer.done < need) {
 		//LOG_WARNING("Full underrun need %d, have %d, min %d", need, mixer.done, mixer.min_needed);
-		if ((need - mixer.done) > (need >> 7)) // Max 1 percent stretch.
+		if ((need - mixer.done) > (need >> 7)) { // Max 1 percent stretch.
+			++mixer_stats.full_underruns;
 			return;
+		}
+		++mixer_stats.underruns;
 		reduce = mixer.done;
 		index_add = (reduce << INDEX_SHIFT_LOCAL) / need;
 		mixer.tick_add = calc_tickadd(mixer.freq + mixer.min_needed);
@@ -835,6 +997,7 @@ static void SDLCALL MIXER_CallBack([[maybe_unused]] void *userdata, Uint8 *strea
 				left = 1 + (2 * left) / mixer.min_needed; // left=1,2,3
 			}
 			//LOG_WARNING("needed underrun need %d, have %d, min %d, left %d", need, mixer.done, mixer.min_needed, left);
+			++mixer_stats.underruns;
 			reduce = need - left;
 			index_add = (reduce << INDEX_SHIFT_LOCAL) / need;
 		} else {
@@ -866,6 +1029,7 @@ static void SDLCALL MIXER_CallBack([[maybe_unused]] void *userdata, Uint8 *strea
 	} else {
 		/* There is way too much data in the buffer */
 		LOG_WARNING("overflow run need %u, have %u, min %u", need, mixer.done.load(), mixer.min_needed.load());
+		++mixer_stats.overruns;
 		if (mixer.done > MIXER_BUFSIZE)
 			index_add = MIXER_BUFSIZE - 2 * mixer.min_needed;
 		else
@@ -876,6 +1040,9 @@ static void SDLCALL MIXER_CallBack([[maybe_unused]] void *userdata, Uint8 *strea
 	}
 	MIXER_ReduceChannelsDoneCounts(reduce);
 
+	const auto stretch = (static_cast<int64_t>(index_add) * 10000) >> INDEX_SHIFT_LOCAL;
+	++mixer_stats.stretch[find_bucket(mixer_stats.stretch_bounds, stretch)];
+
 	// Reset mixer.tick_add when irqs are important
 	if( Mixer_irq_important() )
 		mixer.tick_add = calc_tickadd(mixer.freq);
@@ -917,7 +1084,16 @@ static void SDLCALL MIXER_CallBack([[maybe_unused]] void *userdata, Uint8 *strea
 #undef INDEX_SHIFT_LOCAL
 
 static void MIXER_Stop([[maybe_unused]] Section *sec)
-{}
+{
+	if (!mixer.offline)
+		return;
+	TIMER_DelTickHandler(MIXER_Mix_Offline);
+	LOG_MSG("MIXER: Rendered %" PRIu64 " frames offline for %" PRIu64
+	        " ms of emulated time at %d Hz",
+	        mixer.offline_frames, mixer.offline_ticks, mixer.freq);
+	mixer.offline = false;
+	ticksLocked = false;
+}
 
 class MIXER final : public Program {
 public:
@@ -958,6 +1134,10 @@ public:
 			ListMidi();
 			return;
 		}
+		if (cmd->FindExist("/STATS")) {
+			ShowStats();
+			return;
+		}
 		if (cmd->FindString("MASTER",temp_line,false)) {
 			MakeVolume((char *)temp_line.c_str(),mixer.mastervol[0],mixer.mastervol[1]);
 		}
@@ -1007,6 +1187,64 @@ private:
 	}
 
 	void ListMidi() { MIDI_ListAll(this); }
+
+	template <size_t N, size_t M>
+	void ShowHistogram(const std::array<std::atomic<uint32_t>, N> &counts,
+	                   const std::array<const char *, M> &labels)
+	{
+		static_assert(N == M, "Each bucket needs a label");
+		uint32_t total = 0;
+		for (const auto &count : counts)
+			total += count;
+		for (size_t i = 0; i < N; ++i)
+			WriteOut("  %-10s %8u  %5.1f%%\n", labels[i], counts[i].load(),
+			         total ? 100.0 * counts[i] / total : 0.0);
+	}
+
+	void ShowStats()
+	{
+		if (mixer.nosound) {
+			WriteOut("The mixer isn't playing to an audio device.\n");
+		} else {
+			const auto &st = mixer_stats;
+			WriteOut("Audio device callbacks: %u, each of %u frames\n",
+			         st.callbacks.load(), mixer.blocksize);
+			WriteOut("Underruns: %u stretched, %u played as silence\n",
+			         st.underruns.load(), st.full_underruns.load());
+			WriteOut("Overruns:  %u\n\n", st.overruns.load());
+
+			WriteOut("Frames buffered at each callback, as a share of the block:\n");
+			ShowHistogram(st.buffered,
+			              std::array<const char *, 8>{"<25%", "25-50%",
+			                                          "50-100%", "100-150%",
+			                                          "150-200%", "200-300%",
+			                                          "300-400%", ">=400%"});
+			WriteOut("\nStretch ratio, as frames consumed per frame played:\n");
+			ShowHistogram(st.stretch,
+			              std::array<const char *, 5>{"<99%", "99-100%",
+			                                          "100%", "100-101%",
+			                                          ">=101%"});
+			WriteOut("\n");
+		}
+
+		WriteOut("Channel     Mean lag  Peak lag  Render queue (min/mean/peak of size)\n");
+		std::lock_guard lock(mixer.channel_mutex);
+		for (const auto &[name, channel] : mixer.channels) {
+			const auto &cs = channel->stats;
+			if (!cs.mixes) {
+				WriteOut("%-10s  idle\n", name.c_str());
+				continue;
+			}
+			WriteOut("%-10s  %8.1f  %8d", name.c_str(),
+			         static_cast<double>(cs.total_lag) / cs.mixes, cs.peak_lag);
+			if (cs.queue_capacity)
+				WriteOut("  %zu/%.1f/%zu of %zu\n", cs.min_queued,
+				         static_cast<double>(cs.total_queued) / cs.mixes,
+				         cs.peak_queued, cs.queue_capacity);
+			else
+				WriteOut("\n");
+		}
+	}
 };
 
 void MIXER_ProgramStart(Program * * make) {
@@ -1020,6 +1258,7 @@ void MIXER_Init(Section* sec) {
 	/* Read out config section */
 
 	mixer.nosound=section->Get_bool("nosound");
+	mixer.offline = section->Get_bool("offline");
 	mixer.freq = section->Get_int("rate");
 	mixer.blocksize = static_cast<uint16_t>(section->Get_int("blocksize"));
 	const auto negotiate = section->Get_bool("negotiate");
@@ -1045,7 +1284,12 @@ void MIXER_Init(Section* sec) {
 	}
 
 	mixer.tick_counter=0;
-	if (mixer.nosound) {
+	if (mixer.offline) {
+		LOG_MSG("MIXER: Offline rendering at %d Hz, running as fast as possible",
+		        mixer.freq);
+		MIXER_StartOffline();
+		CAPTURE_WaveStart();
+	} else if (mixer.nosound) {
 		LOG_MSG("MIXER: No Sound Mode Selected.");
 		mixer.tick_add=calc_tickadd(mixer.freq);
 		TIMER_AddTickHandler(MIXER_Mix_NoSound);
@@ -1087,14 +1331,28 @@ void MIXER_Init(Section* sec) {
 	mixer.min_needed = static_cast<uint16_t>(clamp(requested_prebuffer, 0, 100));
 	mixer.min_needed = (mixer.freq * mixer.min_needed) / 1000;
 	mixer.max_needed = mixer.blocksize * 2 + 2 * mixer.min_needed;
-	mixer.needed = mixer.min_needed + 1;
+	if (!mixer.offline)
+		mixer.needed = mixer.min_needed + 1;
 
 	// Initialize the 8-bit to 16-bit lookup table
 	fill_8to16_lut();
 }
 
+static void MIXER_LogStats()
+{
+	const auto &st = mixer_stats;
+	if (!st.callbacks)
+		return;
+	LOG_MSG("MIXER: %u audio device callbacks had %u stretched underruns, "
+	        "%u silent underruns, and %u overruns",
+	        st.callbacks.load(), st.underruns.load(),
+	        st.full_underruns.load(), st.overruns.load());
+}
+
 void MIXER_CloseAudioDevice()
 {
+	MIXER_LogStats();
+
 	std::lock_guard lock(mixer.channel_mutex);
 	for (auto &it : mixer.channels)
 		it.second->Enable(false);
@@ -23,8 +23,10 @@
 
 #include <algorithm>
 #include <array>
+#include <cassert>
 #include <cmath>
 #include <limits>
+#include <vector>
 
 #include "dc_silencer.h"
 #include "pic.h"
@@ -65,6 +67,49 @@ constexpr int IDLE_GRACE_TIME_MS = 100;
 
 enum SPKR_MODES { SPKR_OFF, SPKR_ON, SPKR_PIT_OFF, SPKR_PIT_ON };
 
+/*
+The band-limited renderer turns each speaker transition into a windowed-sinc
+impulse placed at its exact sub-sample position, accumulates these, and
+integrates the result back into steps. The cost grows with the number of
+transitions instead of with samples times transitions, and because the steps
+carry no energy above the cutoff they don't alias the way the integrated
+rectangles do on dense PWM (RealSound) playback.
+*/
+constexpr int BLEP_TAPS = 16;         // samples each impulse spreads over
+constexpr int BLEP_PHASES = 64;       // sub-sample positions per sample
+constexpr double BLEP_CUTOFF = 0.45;  // of the sample rate, below Nyquist
+constexpr int BLEP_LATENCY = BLEP_TAPS / 2 - 1;
+
+using blep_impulse_t = std::array<float, BLEP_TAPS>;
+using blep_table_t = std::array<blep_impulse_t, BLEP_PHASES + 1>;
+
+static blep_table_t make_blep_table()
+{
+	constexpr double pi = 3.14159265358979323846;
+	constexpr double half_width = BLEP_TAPS / 2.0;
+	blep_table_t table = {};
+	for (int p = 0; p <= BLEP_PHASES; ++p) {
+		const double frac = static_cast<double>(p) / BLEP_PHASES;
+		std::array<double, BLEP_TAPS> impulse = {};
+		double sum = 0.0;
+		for (int k = 0; k < BLEP_TAPS; ++k) {
+			const double x = k - BLEP_LATENCY - frac;
+			const double arg = 2.0 * BLEP_CUTOFF * x;
+			const double sinc = (x == 0.0) ? 1.0 : sin(pi * arg) / (pi * arg);
+			const double w = 0.42 + 0.5 * cos(pi * x / half_width) +
+			                 0.08 * cos(2.0 * pi * x / half_width);
+			impulse[k] = sinc * std::max(w, 0.0);
+			sum += impulse[k];
+		}
+		// Each impulse must integrate to a whole step
+		for (int k = 0; k < BLEP_TAPS; ++k)
+			table[p][k] = static_cast<float>(impulse[k] / sum);
+	}
+	return table;
+}
+
+enum class SPKR_RENDERER { BAND_LIMITED, INTEGRATED };
+
 struct DelayEntry {
 	double index = 0.0;
 	double vol = 0.0;
@@ -94,6 +139,12 @@ static struct {
 	uint16_t prev_pos = 0u;
 	int idle_countdown = IDLE_GRACE_TIME_MS;
 	bool neutralize_dc_offset = true;
+
+	SPKR_RENDERER renderer = SPKR_RENDERER::BAND_LIMITED;
+	blep_table_t blep_table = {};
+	std::vector<double> blep_accum = {}; // impulses not yet integrated
+	double blep_level = 0.0;             // the last requested volume
+	double blep_output = 0.0;            // the integrator
 } spkr;
 
 static bool SpeakerExists()
@@ -392,14 +443,10 @@ static void PlayOrFadeout(const uint16_t speaker_movements,
 	spkr.chan->AddSamples_m16(check_cast<uint16_t>(requested_samples), buffer);
 }
 
-static void PCSPEAKER_CallBack(uint16_t len)
+// Integrates the slewed speaker volume over each sample's period. Returns the
+// number of speaker entries consumed.
+static uint16_t RenderIntegrated(const uint16_t len, int16_t *stream)
 {
-	if (!SpeakerExists())
-		return;
-
-	Bit16s * stream=(Bit16s*)MixTemp;
-	ForwardPIT(1);
-	spkr.last_index=0;
 	auto count = len;
 	uint16_t pos = 0;
 	auto sample_base = 0.0;
@@ -458,13 +505,85 @@ static void PCSPEAKER_CallBack(uint16_t len)
 		spkr.prev_pos = pos;
 		*stream++=(Bit16s)(value/sample_add);
 	}
+	return pos;
+}
+
+// Places a band-limited impulse for each speaker entry and integrates them
+// into the output. Returns the number of speaker entries consumed.
+static uint16_t RenderBandLimited(const uint16_t len, int16_t *stream)
+{
+	auto &accum = spkr.blep_accum;
+	const auto accum_size = static_cast<size_t>(len) + BLEP_TAPS + 1;
+	if (accum.size() < accum_size)
+		accum.resize(accum_size, 0.0);
+
+	const auto num_entries = check_cast<uint16_t>(spkr.used);
+	for (int i = 0; i < spkr.used; ++i) {
+		const auto &entry = spkr.entries[i];
+		const auto delta = entry.vol - spkr.blep_level;
+		spkr.blep_level = entry.vol;
+		if (delta == 0.0)
+			continue;
+
+		// Entries span the tick from 0 to 1
+		const auto pos = std::clamp(entry.index, 0.0, 1.0) * len;
+		const auto whole = static_cast<int>(pos);
+		const auto phase = static_cast<int>(lround((pos - whole) * BLEP_PHASES));
+		const auto &impulse = spkr.blep_table[phase];
+		auto out = accum.data() + whole;
+		for (int k = 0; k < BLEP_TAPS; ++k)
+			out[k] += delta * impulse[k];
+	}
+	spkr.used = 0;
+	spkr.volcur = spkr.blep_level;
+	spkr.volwant = spkr.blep_level;
+
+	constexpr auto min_sample = std::numeric_limits<int16_t>::min();
+	constexpr auto max_sample = std::numeric_limits<int16_t>::max();
+	for (uint16_t i = 0; i < len; ++i) {
+		spkr.blep_output += accum[i];
+		stream[i] = static_cast<int16_t>(
+		        std::clamp(spkr.blep_output, static_cast<double>(min_sample),
+		                   static_cast<double>(max_sample)));
+	}
+
+	// Carry the impulses' tails into the next tick
+	std::copy(accum.begin() + len, accum.begin() + len + BLEP_TAPS + 1,
+	          accum.begin());
+	std::fill(accum.begin() + BLEP_TAPS + 1, accum.end(), 0.0);
+	return num_entries;
+}
+
+// Renders the rest of the tick with the configured renderer. Returns the
+// number of speaker entries consumed.
+static uint16_t RenderTick(const uint16_t len, int16_t *stream)
+{
+	ForwardPIT(1);
+	spkr.last_index=0;
+
+	return (spkr.renderer == SPKR_RENDERER::BAND_LIMITED)
+	               ? RenderBandLimited(len, stream)
+	               : RenderIntegrated(len, stream);
+}
+
+static void PCSPEAKER_CallBack(uint16_t len)
+{
+	if (!SpeakerExists())
+		return;
 
 	int16_t *buffer = reinterpret_cast<int16_t *>(MixTemp);
+	const auto pos = RenderTick(len, buffer);
 	if (spkr.neutralize_dc_offset)
 		PlayOrFadeout(pos, len, buffer);
 	else
 		spkr.chan->AddSamples_m16(len, buffer);
 }
+void PCSPEAKER_Render(const uint16_t frames, int16_t *out)
+{
+	assert(SpeakerExists());
+	RenderTick(frames, out);
+}
+
 class PCSPEAKER final : public Module_base {
 public:
 	PCSPEAKER(Section *configuration) : Module_base(configuration)
@@ -484,6 +603,18 @@ public:
 		else
 			spkr.neutralize_dc_offset = (dc_offset_pref == "true");
 
+		const std::string renderer_pref = section->Get_string("pcrender");
+		if (renderer_pref == "integrated") {
+			spkr.renderer = SPKR_RENDERER::INTEGRATED;
+		} else {
+			spkr.renderer = SPKR_RENDERER::BAND_LIMITED;
+			spkr.blep_table = make_blep_table();
+		}
+		spkr.blep_accum.clear();
+		spkr.blep_level = 0.0;
+		spkr.blep_output = 0.0;
+		spkr.used = 0;
+
 		spkr.dc_silencer.Configure(static_cast<uint32_t>(spkr.rate),
 		                           DC_SILENCER_WAVES, DC_SILENCER_WAVE_HZ);
 
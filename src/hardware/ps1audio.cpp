@@ -87,7 +87,6 @@ private:
 	uint8_t fifo[fifo_size] = {};
 
 	// Counters
-	size_t last_write = 0;
 	uint32_t adder = 0;
 	uint32_t bytes_pending = 0;
 	uint32_t read_index_high = 0;
@@ -102,24 +101,11 @@ private:
 	bool can_trigger_irq = false;
 };
 
-static void keep_alive_channel(size_t &last_used_on, mixer_channel_t &channel)
-{
-	last_used_on = PIC_Ticks;
-	if (!channel->is_enabled)
-		channel->Enable(true);
-}
-
-static void maybe_suspend_channel(const size_t last_used_on, mixer_channel_t &channel)
-{
-	const bool last_used_five_seconds_ago = PIC_Ticks > last_used_on + 5000;
-	if (last_used_five_seconds_ago)
-		channel->Enable(false);
-}
-
 Ps1Dac::Ps1Dac()
 {
 	const auto callback = std::bind(&Ps1Dac::Update, this, _1);
 	channel = MIXER_AddChannel(callback, 0, "PS1DAC");
+	channel->ConfigureSleep(true);
 
 	// Register DAC per-port read handlers
 	read_handlers[0].Install(0x02F, std::bind(&Ps1Dac::ReadPresencePort02F, this, _1, _2), io_width_t::byte);
@@ -138,7 +124,6 @@ Ps1Dac::Ps1Dac()
 
 	// Operate at native sampling rates
 	sample_rate = channel->GetSampleRate();
-	last_write = 0;
 	Reset(true);
 }
 
@@ -180,7 +165,7 @@ void Ps1Dac::Reset(bool should_clear_adder)
 void Ps1Dac::WriteDataPort200(io_port_t, io_val_t value, io_width_t)
 {
 	const auto data = check_cast<uint8_t>(value);
-	keep_alive_channel(last_write, channel);
+	channel->WakeUp();
 	if (is_new_transfer) {
 		is_new_transfer = false;
 		if (data) {
@@ -203,7 +188,7 @@ void Ps1Dac::WriteDataPort200(io_port_t, io_val_t value, io_width_t)
 void Ps1Dac::WriteControlPort202(io_port_t, io_val_t value, io_width_t)
 {
 	const auto data = check_cast<uint8_t>(value);
-	keep_alive_channel(last_write, channel);
+	channel->WakeUp();
 	regs.command = data;
 	if (data & 3)
 		can_trigger_irq = true;
@@ -212,7 +197,7 @@ void Ps1Dac::WriteControlPort202(io_port_t, io_val_t value, io_width_t)
 void Ps1Dac::WriteTimingPort203(io_port_t, io_val_t value, io_width_t)
 {
 	auto data = check_cast<uint8_t>(value);
-	keep_alive_channel(last_write, channel);
+	channel->WakeUp();
 	// Clock divisor (maybe trigger first IRQ here).
 	regs.divisor = data;
 
@@ -233,7 +218,7 @@ void Ps1Dac::WriteTimingPort203(io_port_t, io_val_t value, io_width_t)
 void Ps1Dac::WriteFifoLevelPort204(io_port_t, io_val_t value, io_width_t)
 {
 	const auto data = check_cast<uint8_t>(value);
-	keep_alive_channel(last_write, channel);
+	channel->WakeUp();
 	regs.fifo_level = data;
 	if (!data)
 		Reset(true);
@@ -244,20 +229,20 @@ void Ps1Dac::WriteFifoLevelPort204(io_port_t, io_val_t value, io_width_t)
 
 uint8_t Ps1Dac::ReadPresencePort02F(io_port_t, io_width_t)
 {
-	keep_alive_channel(last_write, channel);
+	channel->WakeUp();
 	return 0xff;
 }
 
 uint8_t Ps1Dac::ReadCmdResultPort200(io_port_t, io_width_t)
 {
-	keep_alive_channel(last_write, channel);
+	channel->WakeUp();
 	regs.status &= ~fifo_status_ready_flag;
 	return regs.command;
 }
 
 uint8_t Ps1Dac::ReadStatusPort202(io_port_t, io_width_t)
 {
-	keep_alive_channel(last_write, channel);
+	channel->WakeUp();
 	regs.status = CalcStatus();
 	return regs.status;
 }
@@ -265,14 +250,14 @@ uint8_t Ps1Dac::ReadStatusPort202(io_port_t, io_width_t)
 // Used by Stunt Island and Roger Rabbit 2 during setup.
 uint8_t Ps1Dac::ReadTimingPort203(io_port_t, io_width_t)
 {
-	keep_alive_channel(last_write, channel);
+	channel->WakeUp();
 	return regs.divisor;
 }
 
 // Used by Bush Buck as an alternate detection method.
 uint8_t Ps1Dac::ReadJoystickPorts204To207(io_port_t, io_width_t)
 {
-	keep_alive_channel(last_write, channel);
+	channel->WakeUp();
 	return 0;
 }
 
@@ -322,7 +307,6 @@ void Ps1Dac::Update(uint16_t samples)
 	bytes_pending = static_cast<uint32_t>(pending);
 
 	channel->AddSamples_m8(samples, MixTemp);
-	maybe_suspend_channel(last_write, channel);
 }
 
 Ps1Dac::~Ps1Dac()
@@ -355,13 +339,13 @@ private:
 	sn76496_device device;
 	static constexpr auto max_samples_expected = 64;
 	int16_t buffer[1][max_samples_expected];
-	size_t last_write = 0;
 };
 
 Ps1Synth::Ps1Synth() : device(machine_config(), 0, 0, clock_rate_hz)
 {
 	const auto callback = std::bind(&Ps1Synth::Update, this, _1);
 	channel = MIXER_AddChannel(callback, 0, "PS1");
+	channel->ConfigureSleep(true);
 
 	const auto generate_sound = std::bind(&Ps1Synth::WriteSoundGeneratorPort205, this, _1, _2, _3);
 	write_handler.Install(0x205, generate_sound, io_width_t::byte);
@@ -369,13 +353,12 @@ Ps1Synth::Ps1Synth() : device(machine_config(), 0, 0, clock_rate_hz)
 
 	auto sample_rate = static_cast<int32_t>(channel->GetSampleRate());
 	device.convert_samplerate(sample_rate);
-	last_write = 0;
 }
 
 void Ps1Synth::WriteSoundGeneratorPort205(io_port_t, io_val_t value, io_width_t)
 {
 	const auto data = check_cast<uint8_t>(value);
-	keep_alive_channel(last_write, channel);
+	channel->WakeUp();
 	device.write(data);
 }
 
@@ -393,7 +376,6 @@ void Ps1Synth::Update(uint16_t samples)
 	static_cast<device_sound_interface &>(device).sound_stream_update(
 	        ss, nullptr, buffer_head, samples);
 	channel->AddSamples_m16(samples, buffer[0]);
-	maybe_suspend_channel(last_write, channel);
 }
 
 Ps1Synth::~Ps1Synth()
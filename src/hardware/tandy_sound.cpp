@@ -94,8 +94,6 @@ constexpr uint16_t TDAC_DMA_BUFSIZE = 1024;
 
 static struct {
 	mixer_channel_t chan = nullptr;
-	bool enabled = false;
-	Bitu last_write = 0u;
 	struct {
 		mixer_channel_t chan = nullptr;
 		bool enabled = false;
@@ -127,11 +125,8 @@ static sn76496_base_device* activeDevice = &device_ncr8496;
 static void SN76496Write(io_port_t, io_val_t value, io_width_t)
 {
 	const auto data = check_cast<uint8_t>(value);
-	tandy.last_write = PIC_Ticks;
-	if (!tandy.enabled && tandy.chan) {
-		tandy.chan->Enable(true);
-		tandy.enabled=true;
-	}
+	if (tandy.chan)
+		tandy.chan->WakeUp();
 	device.write(data);
 
 	//	LOG_MSG("3voice write %#" PRIxPTR " at time
@@ -143,12 +138,6 @@ static void SN76496Update(uint16_t length)
 	if (!tandy.chan)
 		return;
 
-	// Disable the channel if it's been quiet for a while
-	if ((tandy.last_write + 5000) < PIC_Ticks) {
-		tandy.enabled=false;
-		tandy.chan->Enable(false);
-		return;
-	}
 	const Bitu MAX_SAMPLES = 2048;
 	if (length > MAX_SAMPLES)
 		return;
@@ -375,6 +364,7 @@ public:
 
 		const auto sample_rate = static_cast<uint32_t>(section->Get_int("tandyrate"));
 		tandy.chan = MIXER_AddChannel(&SN76496Update, sample_rate, "TANDY");
+		tandy.chan->ConfigureSleep(true);
 
 		WriteHandler[0].Install(0xc0, SN76496Write, io_width_t::byte, 2);
 
@@ -402,7 +392,6 @@ public:
 		tandy.dac.frequency=0;
 		tandy.dac.amplitude = 0;
 
-		tandy.enabled=false;
 		real_writeb(0x40,0xd4,0xff);	/* BIOS Tandy DAC initialization value */
 
 		((device_t&)device).device_start();
@@ -105,6 +105,8 @@ void write_p3c0(io_port_t, io_val_t value, io_width_t)
 	if (!vga.internal.attrindex) {
 		attr(index)=val & 0x1F;
 		vga.internal.attrindex=true;
+		if (((val & 0x20) != 0) == ((attr(disabled) & 1) != 0))
+			VGA_NoteRegisterWrite();
 		if (val & 0x20) attr(disabled) &= ~1;
 		else attr(disabled) |= 1;
 		/* 
@@ -115,6 +117,8 @@ void write_p3c0(io_port_t, io_val_t value, io_width_t)
 		return;
 	} else {
 		vga.internal.attrindex=false;
+		VGA_NoteRegisterWrite();
+		++vga.draw.text_generation;
 		switch (attr(index)) {
 			/* Palette */
 		case 0x00:		case 0x01:		case 0x02:		case 0x03:
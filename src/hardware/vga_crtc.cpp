@@ -49,6 +49,10 @@ void vga_write_p3d5(io_port_t, io_val_t value, io_width_t)
 {
 	const auto val = check_cast<uint8_t>(value);
 	//	if (crtc(index) > 0x18) LOG_MSG("VGA CRCT write %" sBitfs(X) " to reg %X",val,crtc(index));
+	// The start address and cursor location are latched once per frame and
+	// the SVGA registers mostly select banks for the CPU
+	if (crtc(index) <= 0x18 && (crtc(index) < 0x0c || crtc(index) > 0x0f))
+		VGA_NoteRegisterWrite();
 	switch (crtc(index)) {
 	case 0x00: /* Horizontal Total Register */
 		if (crtc(read_only))
@@ -277,6 +281,7 @@ void vga_write_p3d5(io_port_t, io_val_t value, io_width_t)
 		break;
 	case 0x14:	/* Underline Location Register */
 		crtc(underline_location)=val;
+		++vga.draw.text_generation;
 		if (IS_VGA_ARCH) {
 			//Byte,word,dword mode
 			if ( crtc(underline_location) & 0x20 )
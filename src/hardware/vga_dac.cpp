@@ -66,6 +66,7 @@ static void VGA_DAC_SendColor(uint8_t index, uint8_t src)
 
 	// Set it in the (little endian) 16bit output lookup table
 	var_write(&vga.dac.xlat16[index], check_cast<uint16_t>(rgb565));
+	++vga.draw.text_generation;
 
 	// Scale the DAC's 6-bit colors to 8-bit to set the VGA palette
 	auto scale_6_to_8 = [](const uint8_t color_6) -> uint8_t {
@@ -90,6 +91,7 @@ static void write_p3c6(io_port_t, io_val_t value, io_width_t)
 {
 	const auto val = check_cast<uint8_t>(value);
 	if (vga.dac.pel_mask != val) {
+		VGA_NoteRegisterWrite();
 		LOG(LOG_VGAMISC, LOG_NORMAL)("VGA:DCA:Pel Mask set to %X", val);
 		vga.dac.pel_mask = val;
 		for (uint16_t i = 0; i < 256; i++)
@@ -137,6 +139,7 @@ static void write_p3c9(io_port_t, io_val_t value, io_width_t)
 {
 	auto val = check_cast<uint8_t>(value);
 	val &= 0x3f;
+	VGA_NoteRegisterWrite();
 	switch (vga.dac.pel_index) {
 	case 0:
 		vga.dac.rgb[vga.dac.write_index].red=val;
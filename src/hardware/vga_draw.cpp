@@ -18,8 +18,11 @@
 
 #include "dosbox.h"
 
+#include <algorithm>
+#include <array>
 #include <cstring>
 #include <cmath>
+#include <vector>
 
 #include "../ints/int10.h"
 #include "mem_unaligned.h"
@@ -548,10 +551,75 @@ static bool SkipCursor(Bitu vidstart, Bitu line)
 }
 
 static Bit32u FontMask[2]={0xffffffff,0x0};
+
+// What each text mode line was last drawn from and the pixels it produced,
+// so lines that didn't change since the previous frame are copied instead
+// of drawn again. The font, the palette and the attribute controller are
+// covered by vga.draw.text_generation.
+struct TextLine {
+	Bitu vidstart = 0;
+	Bitu line = 0;
+	Bitu cursor = 0;
+	uint32_t generation = 0;
+	uint16_t panning = 0;
+	uint8_t blink = 0;
+	std::vector<uint8_t> text = {};
+	std::vector<uint8_t> pixels = {};
+};
+static std::vector<TextLine> text_lines = {};
+
+static uint8_t TextBlinkState()
+{
+	return (FontMask[1] ? 1 : 0) | (vga.draw.blink ? 2 : 0) |
+	       (vga.draw.blinking ? 4 : 0);
+}
+
+// Returns the cached line for the current scanline if it was drawn from the
+// same text and state, else records the new state and returns nullptr; the
+// caller then draws the line and stores its pixels in the returned entry
+static TextLine *VGA_TEXT_FindLine(const uint8_t *vidmem, const Bitu cells,
+                                   const Bitu vidstart, const Bitu line,
+                                   bool &unchanged)
+{
+	const auto y = vga.draw.lines_done;
+	if (y >= text_lines.size())
+		text_lines.resize(y + 1);
+	auto &cached = text_lines[y];
+
+	const Bitu cursor = SkipCursor(vidstart, line) ? ~static_cast<Bitu>(0)
+	                                               : vga.draw.cursor.address;
+	const auto blink = TextBlinkState();
+	const auto text_len = cells * 2;
+	unchanged = cached.vidstart == vidstart && cached.line == line &&
+	            cached.cursor == cursor && cached.blink == blink &&
+	            cached.panning == vga.draw.panning &&
+	            cached.generation == vga.draw.text_generation &&
+	            cached.text.size() == text_len &&
+	            memcmp(cached.text.data(), vidmem, text_len) == 0;
+	if (!unchanged) {
+		cached.vidstart = vidstart;
+		cached.line = line;
+		cached.cursor = cursor;
+		cached.blink = blink;
+		cached.panning = vga.draw.panning;
+		cached.generation = vga.draw.text_generation;
+		cached.text.assign(vidmem, vidmem + text_len);
+	}
+	return &cached;
+}
+
 static uint8_t *VGA_TEXT_Draw_Line(Bitu vidstart, Bitu line)
 {
-	uint16_t i = 0;
 	const Bit8u* vidmem = VGA_Text_Memwrap(vidstart);
+	bool unchanged = false;
+	auto cached = VGA_TEXT_FindLine(vidmem, vga.draw.blocks, vidstart,
+	                                line, unchanged);
+	if (unchanged) {
+		memcpy(TempLine, cached->pixels.data(), cached->pixels.size());
+		return TempLine;
+	}
+
+	uint16_t i = 0;
 	for (Bitu cx = 0; cx < vga.draw.blocks; ++cx) {
 		Bitu chr=vidmem[cx*2];
 		Bitu col=vidmem[cx*2+1];
@@ -563,15 +631,16 @@ static uint8_t *VGA_TEXT_Draw_Line(Bitu vidstart, Bitu line)
 		write_unaligned_uint32_at(TempLine, i++, (fg & mask1) | (bg & ~mask1));
 		write_unaligned_uint32_at(TempLine, i++, (fg & mask2) | (bg & ~mask2));
 	}
-	if (SkipCursor(vidstart, line))
-		return TempLine;
-	const Bitu font_addr = (vga.draw.cursor.address - vidstart) >> 1;
-	if (font_addr < vga.draw.blocks) {
-		Bit32u *draw = (Bit32u *)&TempLine[font_addr * 8];
-		Bit32u att=TXT_FG_Table[vga.tandy.draw_base[vga.draw.cursor.address+1]&0xf];
-		*draw++ = att;
-		*draw++ = att;
+	if (!SkipCursor(vidstart, line)) {
+		const Bitu font_addr = (vga.draw.cursor.address - vidstart) >> 1;
+		if (font_addr < vga.draw.blocks) {
+			Bit32u *draw = (Bit32u *)&TempLine[font_addr * 8];
+			Bit32u att=TXT_FG_Table[vga.tandy.draw_base[vga.draw.cursor.address+1]&0xf];
+			*draw++ = att;
+			*draw++ = att;
+		}
 	}
+	cached->pixels.assign(TempLine, TempLine + vga.draw.blocks * 8);
 	return TempLine;
 }
 
@@ -630,6 +699,45 @@ static uint8_t *VGA_TEXT_Herc_Draw_Line(Bitu vidstart, Bitu line)
 	}
 	return TempLine;
 }
+// The foreground and background colours of each attribute for the current
+// blink phase, and the pixel masks of each 8-dot font pattern, so the 16bpp
+// text cells are drawn from pre-expanded spans rather than pixel by pixel
+struct TextColours {
+	uint16_t fg = 0;
+	uint16_t bg = 0;
+};
+static TextColours text_colours[256] = {};
+static uint32_t text_colours_generation = 0;
+static uint8_t text_colours_blink = 0xff;
+
+static const auto text_glyph_masks = [] {
+	std::array<std::array<uint16_t, 8>, 256> masks = {};
+	for (size_t font = 0; font < masks.size(); ++font)
+		for (size_t n = 0; n < 8; ++n)
+			masks[font][n] = (font & (0x80 >> n)) ? 0xffff : 0;
+	return masks;
+}();
+
+static void VGA_TEXT_UpdateColours()
+{
+	const auto blink = TextBlinkState();
+	if (text_colours_generation == vga.draw.text_generation &&
+	    text_colours_blink == blink)
+		return;
+	text_colours_generation = vga.draw.text_generation;
+	text_colours_blink = blink;
+	for (uint16_t attr = 0; attr < 256; ++attr) {
+		Bitu background = attr >> 4;
+		// if blinking is enabled bit7 is not mapped to attributes
+		if (vga.draw.blinking) background &= ~0x8;
+		// choose foreground color if blinking not set for this cell or blink on
+		Bitu foreground = (vga.draw.blink || (!(attr&0x80)))?
+			(attr&0xf):background;
+		text_colours[attr].fg = vga.dac.xlat16[foreground];
+		text_colours[attr].bg = vga.dac.xlat16[background];
+	}
+}
+
 // combined 8/9-dot wide text mode 16bpp line drawing function
 static uint8_t *VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line)
 {
@@ -640,40 +748,41 @@ static uint8_t *VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line)
 	if (vga.draw.panning)
 		++blocks; // if the text is panned part of an
 		          // additional character becomes visible
+
+	const Bitu cell_width = vga.draw.char9dot ? 9 : 8;
+	bool unchanged = false;
+	auto cached = VGA_TEXT_FindLine(vidmem, blocks, vidstart, line, unchanged);
+	if (unchanged) {
+		memcpy(TempLine + 32, cached->pixels.data(), cached->pixels.size());
+		return TempLine + 32;
+	}
+
+	VGA_TEXT_UpdateColours();
+	const bool underline_line = (vga.crtc.underline_location & 0x1f) == line;
+	const bool line_graphics = vga.attr.mode_control & 0x04;
 	while (blocks--) { // for each character in the line
 		Bitu chr = *vidmem++;
 		Bitu attr = *vidmem++;
 		// the font pattern
 		Bitu font = vga.draw.font_tables[(attr >> 3)&1][(chr<<5)+line];
-		
-		Bitu background = attr >> 4;
-		// if blinking is enabled bit7 is not mapped to attributes
-		if (vga.draw.blinking) background &= ~0x8;
-		// choose foreground color if blinking not set for this cell or blink on
-		Bitu foreground = (vga.draw.blink || (!(attr&0x80)))?
-			(attr&0xf):background;
+
+		const uint16_t fg = text_colours[attr].fg;
+		uint16_t bg = text_colours[attr].bg;
 		// underline: all foreground [freevga: 0x77, previous 0x7]
-		if (GCC_UNLIKELY(((attr&0x77) == 0x01) &&
-			(vga.crtc.underline_location&0x1f)==line))
-				background = foreground;
+		if (GCC_UNLIKELY(((attr&0x77) == 0x01) && underline_line))
+			bg = fg;
+
+		const auto &mask = text_glyph_masks[font];
+		uint16_t pixels[8];
+		for (size_t n = 0; n < 8; ++n)
+			pixels[n] = (fg & mask[n]) | (bg & ~mask[n]);
+		memcpy(&TempLine[idx * sizeof(uint16_t)], pixels, sizeof(pixels));
+		idx += 8;
 		if (vga.draw.char9dot) {
-			font <<=1; // 9 pixels
 			// extend to the 9th pixel if needed
-			if ((font&0x2) && (vga.attr.mode_control&0x04) &&
-				(chr>=0xc0) && (chr<=0xdf)) font |= 1;
-			for (int n = 0; n < 9; ++n) {
-				write_unaligned_uint16_at(
-				        TempLine, idx++,
-				        vga.dac.xlat16[(font & 0x100) ? foreground : background]);
-				font <<= 1;
-			}
-		} else {
-			for (int n = 0; n < 8; ++n) {
-				write_unaligned_uint16_at(
-				        TempLine, idx++,
-				        vga.dac.xlat16[(font & 0x80) ? foreground : background]);
-				font <<= 1;
-			}
+			const bool extend = (font & 0x1) && line_graphics &&
+			                    (chr >= 0xc0) && (chr <= 0xdf);
+			write_unaligned_uint16_at(TempLine, idx++, extend ? fg : bg);
 		}
 	}
 	// draw the text mode cursor if needed
@@ -691,6 +800,8 @@ static uint8_t *VGA_TEXT_Xlat16_Draw_Line(Bitu vidstart, Bitu line)
 			}
 		}
 	}
+	cached->pixels.assign(TempLine + 32,
+	                      TempLine + 32 + vga.draw.blocks * cell_width * 2);
 	return TempLine + 32;
 }
 
@@ -729,7 +840,7 @@ static void VGA_ProcessSplit() {
 }
 
 static Bit8u bg_color_index = 0; // screen-off black index
-static void VGA_DrawSingleLine(uint32_t /*blah*/)
+static void VGA_DrawNextLine()
 {
 	if (GCC_UNLIKELY(vga.attr.disabled)) {
 		switch(machine) {
@@ -801,12 +912,20 @@ static void VGA_DrawSingleLine(uint32_t /*blah*/)
 	}
 	++vga.draw.lines_done;
 	if (vga.draw.split_line==vga.draw.lines_done) VGA_ProcessSplit();
+}
+
+// Draws the given number of lines, more than one when the frame is batched,
+// and schedules the next line
+static void VGA_DrawSingleLine(uint32_t lines)
+{
+	while (lines-- && vga.draw.lines_done < vga.draw.lines_total)
+		VGA_DrawNextLine();
 	if (vga.draw.lines_done < vga.draw.lines_total) {
-		PIC_AddEvent(VGA_DrawSingleLine, vga.draw.delay.htotal);
+		PIC_AddEvent(VGA_DrawSingleLine, vga.draw.delay.htotal, 1);
 	} else RENDER_EndUpdate(false);
 }
 
-static void VGA_DrawEGASingleLine(uint32_t /*blah*/)
+static void VGA_DrawNextEGALine()
 {
 	if (GCC_UNLIKELY(vga.attr.disabled)) {
 		memset(TempLine, 0, sizeof(TempLine));
@@ -825,12 +944,18 @@ static void VGA_DrawEGASingleLine(uint32_t /*blah*/)
 	}
 	++vga.draw.lines_done;
 	if (vga.draw.split_line==vga.draw.lines_done) VGA_ProcessSplit();
+}
+
+static void VGA_DrawEGASingleLine(uint32_t lines)
+{
+	while (lines-- && vga.draw.lines_done < vga.draw.lines_total)
+		VGA_DrawNextEGALine();
 	if (vga.draw.lines_done < vga.draw.lines_total) {
-		PIC_AddEvent(VGA_DrawEGASingleLine, vga.draw.delay.htotal);
+		PIC_AddEvent(VGA_DrawEGASingleLine, vga.draw.delay.htotal, 1);
 	} else RENDER_EndUpdate(false);
 }
 
-static void VGA_DrawPart(uint32_t lines)
+static void VGA_DrawPartLines(uint32_t lines)
 {
 	while (lines--) {
 		Bit8u * data=VGA_DrawLine( vga.draw.address, vga.draw.address_line );
@@ -851,6 +976,11 @@ static void VGA_DrawPart(uint32_t lines)
 #endif
 		}
 	}
+}
+
+static void VGA_DrawPart(uint32_t lines)
+{
+	VGA_DrawPartLines(lines);
 	if (--vga.draw.parts_left) {
 		PIC_AddEvent(VGA_DrawPart, vga.draw.delay.parts,
 		             (vga.draw.parts_left != 1)
@@ -864,6 +994,75 @@ static void VGA_DrawPart(uint32_t lines)
 	}
 }
 
+// Frames are drawn in one go at display end, rather than as they're scanned,
+// once this many frames in a row went by without a mid-frame write to a
+// register that changes the picture
+constexpr uint32_t quiet_frames_before_batching = 10;
+
+static bool frame_batching = true;
+
+// Draws the lines the beam has already passed and goes back to drawing the
+// rest of the frame as it's scanned
+static void VGA_StopBatching()
+{
+	vga.draw.batch.active = false;
+
+	const double elapsed = PIC_FullIndex() - vga.draw.delay.framestart -
+	                       vga.draw.batch.draw_skip;
+	const auto beam_line = static_cast<uint32_t>(
+	        std::clamp(elapsed / vga.draw.delay.htotal, 0.0,
+	                   static_cast<double>(vga.draw.lines_total)));
+	const uint32_t lines = beam_line > vga.draw.lines_done
+	                               ? beam_line - vga.draw.lines_done
+	                               : 0;
+	switch (vga.draw.mode) {
+	case PART: {
+		if (!vga.draw.parts_left)
+			return;
+		PIC_RemoveEvents(VGA_DrawPart);
+		VGA_DrawPartLines(lines);
+		const auto lines_left = vga.draw.lines_total - vga.draw.lines_done;
+		const auto parts_lines = std::max(vga.draw.parts_lines, 1u);
+		vga.draw.parts_left = std::max((lines_left + parts_lines - 1) / parts_lines,
+		                               1u);
+		PIC_AddEvent(VGA_DrawPart, vga.draw.delay.parts,
+		             (vga.draw.parts_left != 1) ? vga.draw.parts_lines
+		                                        : lines_left);
+		break;
+	}
+	case DRAWLINE:
+		if (vga.draw.lines_done >= vga.draw.lines_total)
+			return;
+		PIC_RemoveEvents(VGA_DrawSingleLine);
+		VGA_DrawSingleLine(lines);
+		break;
+	case EGALINE:
+		if (vga.draw.lines_done >= vga.draw.lines_total)
+			return;
+		PIC_RemoveEvents(VGA_DrawEGASingleLine);
+		VGA_DrawEGASingleLine(lines);
+		break;
+	}
+}
+
+void VGA_NoteRegisterWrite()
+{
+	// Writes during vertical blanking only change the frames that follow
+	if (PIC_FullIndex() - vga.draw.delay.framestart >= vga.draw.delay.vdend)
+		return;
+	vga.draw.batch.quiet_frames = 0;
+	if (vga.draw.batch.active)
+		VGA_StopBatching();
+}
+
+void VGA_SetFrameBatching(const bool enabled)
+{
+	frame_batching = enabled;
+	vga.draw.batch.quiet_frames = 0;
+	if (!enabled && vga.draw.batch.active)
+		VGA_StopBatching();
+}
+
 void VGA_SetBlinking(const uint8_t enabled)
 {
 	LOG(LOG_VGA, LOG_NORMAL)("Blinking %u", enabled);
@@ -880,6 +1079,7 @@ void VGA_SetBlinking(const uint8_t enabled)
 	for (uint8_t i = 0; i < 8; ++i)
 		TXT_BG_Table[i + 8] = (b + i) | ((b + i) << 8) |
 		                      ((b + i) << 16) | ((b + i) << 24);
+	++vga.draw.text_generation;
 }
 
 #ifdef VGA_KEEP_CHANGES
@@ -937,6 +1137,10 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 	vga.draw.delay.framestart = PIC_FullIndex();
 	PIC_AddEvent(VGA_VerticalTimer, vga.draw.delay.vtotal);
 
+	vga.draw.batch.active = false;
+	if (vga.draw.batch.quiet_frames < quiet_frames_before_batching)
+		++vga.draw.batch.quiet_frames;
+
 	switch(machine) {
 	case MCH_PCJR:
 	case MCH_TANDY:
@@ -1076,7 +1280,12 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 		vga.draw.address += vga.draw.address_add * vga.draw.vblank_skip / vga.draw.address_line_total;
 	}
 
-	// add the draw event
+	// add the draw event, a single one at display end if no raster effects
+	// were seen lately and the register writes can be watched
+	const bool batch = frame_batching && IS_EGAVGA_ARCH &&
+	                   vga.draw.batch.quiet_frames >= quiet_frames_before_batching;
+	vga.draw.batch.active = batch;
+	vga.draw.batch.draw_skip = draw_skip;
 	switch (vga.draw.mode) {
 	case PART:
 		if (GCC_UNLIKELY(vga.draw.parts_left)) {
@@ -1085,8 +1294,16 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 			RENDER_EndUpdate(true);
 		}
 		vga.draw.lines_done = 0;
-		vga.draw.parts_left = vga.draw.parts_total;
-		PIC_AddEvent(VGA_DrawPart, vga.draw.delay.parts + draw_skip, vga.draw.parts_lines);
+		if (batch) {
+			vga.draw.parts_left = 1;
+			PIC_AddEvent(VGA_DrawPart,
+			             vga.draw.delay.parts * vga.draw.parts_total + draw_skip,
+			             vga.draw.lines_total);
+		} else {
+			vga.draw.parts_left = vga.draw.parts_total;
+			PIC_AddEvent(VGA_DrawPart, vga.draw.delay.parts + draw_skip,
+			             vga.draw.parts_lines);
+		}
 		break;
 	case DRAWLINE:
 	case EGALINE:
@@ -1100,12 +1317,16 @@ static void VGA_VerticalTimer(uint32_t /*val*/)
 			RENDER_EndUpdate(true);
 		}
 		vga.draw.lines_done = 0;
-		if (vga.draw.mode==EGALINE)
-			PIC_AddEvent(VGA_DrawEGASingleLine,
-			             vga.draw.delay.htotal / 4.0 + draw_skip);
-		else
-			PIC_AddEvent(VGA_DrawSingleLine,
-			             vga.draw.delay.htotal / 4.0 + draw_skip);
+		{
+			// A batch is drawn when the last line would have been
+			const uint32_t lines = batch ? vga.draw.lines_total : 1;
+			const double delay = vga.draw.delay.htotal / 4.0 + draw_skip +
+			                     vga.draw.delay.htotal * (lines - 1);
+			if (vga.draw.mode == EGALINE)
+				PIC_AddEvent(VGA_DrawEGASingleLine, delay, lines);
+			else
+				PIC_AddEvent(VGA_DrawSingleLine, delay, lines);
+		}
 		break;
 	}
 }
@@ -1206,6 +1427,7 @@ void VGA_SetupDrawing(uint32_t /*val*/)
 		PIC_RemoveEvents(VGA_DisplayStartLatch);
 		return;
 	}
+	++vga.draw.text_generation;
 	// set the drawing mode
 	switch (machine) {
 	case MCH_CGA:
@@ -1866,5 +2088,6 @@ void VGA_KillDrawing(void) {
 	PIC_RemoveEvents(VGA_DrawEGASingleLine);
 	vga.draw.parts_left = 0;
 	vga.draw.lines_done = ~0;
+	vga.draw.batch.active = false;
 	RENDER_EndUpdate(true);
 }
@@ -19,6 +19,7 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
 #include "dosbox.h"
 #include "mem.h"
 #include "mem_host.h"
@@ -27,7 +28,7 @@
 #include "pic.h"
 #include "inout.h"
 #include "setup.h"
-
+#include "simd.h"
 
 #ifndef C_VGARAM_CHECKED
 #define C_VGARAM_CHECKED 1
@@ -103,6 +104,133 @@ inline static Bit32u ModeOperation(Bit8u val) {
 	return full;
 }
 
+void VGA_PlanarWrite(PhysPt start, uint8_t val)
+{
+	Bit32u data=ModeOperation(val);
+	VGA_Latch pixels;
+	pixels.d=((Bit32u*)vga.mem.linear)[start];
+	pixels.d&=vga.config.full_not_map_mask;
+	pixels.d|=(data & vga.config.full_map_mask);
+	((Bit32u*)vga.mem.linear)[start]=pixels.d;
+}
+
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+// Rotates each of the four bytes right by the data rotate count
+static inline uint32_t RotateBytes(uint32_t val)
+{
+	const auto rotate = vga.config.data_rotate & 7;
+	if (!rotate)
+		return val;
+	const uint32_t low = 0x01010101u * (0xffu >> rotate);
+	return ((val >> rotate) & low) | ((val << (8 - rotate)) & ~low);
+}
+#endif
+
+#if defined(SIMD_SSE2)
+using vga_planes_t = __m128i;
+
+// Repeats each of the four bytes across the four planes of its address
+static inline vga_planes_t ExpandPlanes(uint32_t val)
+{
+	const auto bytes = _mm_cvtsi32_si128(static_cast<int>(val));
+	const auto pairs = _mm_unpacklo_epi8(bytes, bytes);
+	return _mm_unpacklo_epi16(pairs, pairs);
+}
+static inline vga_planes_t SplatPlanes(uint32_t val)
+{
+	return _mm_set1_epi32(static_cast<int>(val));
+}
+static inline vga_planes_t And(vga_planes_t a, vga_planes_t b) { return _mm_and_si128(a, b); }
+static inline vga_planes_t Or(vga_planes_t a, vga_planes_t b) { return _mm_or_si128(a, b); }
+static inline vga_planes_t Xor(vga_planes_t a, vga_planes_t b) { return _mm_xor_si128(a, b); }
+// a & ~b
+static inline vga_planes_t AndNot(vga_planes_t a, vga_planes_t b) { return _mm_andnot_si128(b, a); }
+static inline vga_planes_t BytesEqual(vga_planes_t a, vga_planes_t b) { return _mm_cmpeq_epi8(a, b); }
+static inline vga_planes_t LoadPlanes(const Bit32u *p)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+static inline void StorePlanes(Bit32u *p, vga_planes_t v)
+{
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+#elif defined(SIMD_NEON)
+using vga_planes_t = uint32x4_t;
+
+static inline vga_planes_t ExpandPlanes(uint32_t val)
+{
+	const auto bytes = vreinterpret_u8_u32(vdup_n_u32(val));
+	const auto pairs = vreinterpret_u16_u8(vzip_u8(bytes, bytes).val[0]);
+	const auto quads = vzip_u16(pairs, pairs);
+	return vreinterpretq_u32_u16(vcombine_u16(quads.val[0], quads.val[1]));
+}
+static inline vga_planes_t SplatPlanes(uint32_t val) { return vdupq_n_u32(val); }
+static inline vga_planes_t And(vga_planes_t a, vga_planes_t b) { return vandq_u32(a, b); }
+static inline vga_planes_t Or(vga_planes_t a, vga_planes_t b) { return vorrq_u32(a, b); }
+static inline vga_planes_t Xor(vga_planes_t a, vga_planes_t b) { return veorq_u32(a, b); }
+static inline vga_planes_t AndNot(vga_planes_t a, vga_planes_t b) { return vbicq_u32(a, b); }
+static inline vga_planes_t BytesEqual(vga_planes_t a, vga_planes_t b)
+{
+	return vreinterpretq_u32_u8(vceqq_u8(vreinterpretq_u8_u32(a), vreinterpretq_u8_u32(b)));
+}
+static inline vga_planes_t LoadPlanes(const Bit32u *p) { return vld1q_u32(p); }
+static inline void StorePlanes(Bit32u *p, vga_planes_t v) { vst1q_u32(p, v); }
+#endif
+
+void VGA_PlanarWriteSpan(PhysPt start, const uint8_t *data, size_t count)
+{
+	Bit32u *planes = reinterpret_cast<Bit32u *>(vga.mem.linear) + start;
+	size_t i = 0;
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+	// The registers and the latch stay the same over the span, so the same
+	// steps as ModeOperation and RasterOp are done for four addresses at once
+	const auto write_mode = vga.config.write_mode;
+	const auto raster_op = vga.config.raster_op;
+	const auto latch = SplatPlanes(vga.latch.d);
+	const auto bit_mask = SplatPlanes(vga.config.full_bit_mask);
+	const auto map_mask = SplatPlanes(vga.config.full_map_mask);
+	const auto not_map_mask = SplatPlanes(vga.config.full_not_map_mask);
+	const auto not_enable_set_reset = SplatPlanes(vga.config.full_not_enable_set_reset);
+	const auto enable_and_set_reset = SplatPlanes(vga.config.full_enable_and_set_reset);
+	const auto set_reset = SplatPlanes(vga.config.full_set_reset);
+	const auto plane_bits = SplatPlanes(0x08040201);
+	const auto all_planes = SplatPlanes(0xffffffff);
+	for (; i + 4 <= count; i += 4) {
+		uint32_t four;
+		memcpy(&four, data + i, sizeof(four));
+		vga_planes_t input, mask = bit_mask, full;
+		switch (write_mode) {
+		case 0x00:
+			input = ExpandPlanes(RotateBytes(four));
+			input = Or(And(input, not_enable_set_reset), enable_and_set_reset);
+			break;
+		case 0x02:
+			input = BytesEqual(And(ExpandPlanes(four), plane_bits), plane_bits);
+			break;
+		case 0x03:
+			input = set_reset;
+			mask = And(ExpandPlanes(RotateBytes(four)), bit_mask);
+			break;
+		default: input = latch; break;
+		}
+		if (write_mode == 0x01) {
+			full = latch;
+		} else {
+			switch (raster_op) {
+			case 0x00: full = Or(And(input, mask), AndNot(latch, mask)); break;
+			case 0x01: full = And(Or(input, Xor(mask, all_planes)), latch); break;
+			case 0x02: full = Or(And(input, mask), latch); break;
+			default: full = Xor(And(input, mask), latch); break;
+			}
+		}
+		const auto pixels = LoadPlanes(planes + i);
+		StorePlanes(planes + i, Or(And(pixels, not_map_mask), And(full, map_mask)));
+	}
+#endif
+	for (; i < count; ++i)
+		VGA_PlanarWrite(start + static_cast<PhysPt>(i), data[i]);
+}
+
 /* Gonna assume that whoever maps vga memory, maps it on 32/64kb boundary */
 
 #define VGA_PAGES		(128/4)
@@ -257,13 +385,22 @@ public:
 class VGA_UnchainedEGA_Handler : public VGA_UnchainedRead_Handler {
 public:
 	void writeHandler(PhysPt start, Bit8u val) {
-		Bit32u data=ModeOperation(val);
 		/* Update video memory and the pixel buffer */
+		VGA_PlanarWrite(start, val);
+		UpdatePixels(start);
+	}
+
+	void writeSpan(PhysPt start, const uint8_t *data, size_t count)
+	{
+		VGA_PlanarWriteSpan(start, data, count);
+		for (size_t i = 0; i < count; ++i)
+			UpdatePixels(start + static_cast<PhysPt>(i));
+	}
+
+	static void UpdatePixels(PhysPt start)
+	{
 		VGA_Latch pixels;
 		pixels.d=((Bit32u*)vga.mem.linear)[start];
-		pixels.d&=vga.config.full_not_map_mask;
-		pixels.d|=(data & vga.config.full_map_mask);
-		((Bit32u*)vga.mem.linear)[start]=pixels.d;
 		Bit8u * write_pixels=&vga.fastmem[start<<3];
 
 		Bit32u colors0_3, colors4_7;
@@ -284,7 +421,7 @@ public:
 	}
 public:	
 	VGA_UnchainedEGA_Handler()  {
-		flags=PFLAG_NOCODE;
+		flags=PFLAG_NOCODE|PFLAG_SPANWRITE;
 	}
 
 	void writeb(PhysPt addr, uint8_t val)
@@ -302,8 +439,8 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
 		MEM_CHANGED( addr << 3);
-		writeHandler(addr+0,(Bit8u)(val >> 0));
-		writeHandler(addr+1,(Bit8u)(val >> 8));
+		const uint8_t data[2] = {(Bit8u)(val >> 0), (Bit8u)(val >> 8)};
+		writeSpan(addr, data, sizeof(data));
 	}
 
 	void writed(PhysPt addr, uint32_t val)
@@ -312,10 +449,24 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
 		MEM_CHANGED( addr << 3);
-		writeHandler(addr+0,(Bit8u)(val >> 0));
-		writeHandler(addr+1,(Bit8u)(val >> 8));
-		writeHandler(addr+2,(Bit8u)(val >> 16));
-		writeHandler(addr+3,(Bit8u)(val >> 24));
+		const uint8_t data[4] = {(Bit8u)(val >> 0), (Bit8u)(val >> 8),
+		                         (Bit8u)(val >> 16), (Bit8u)(val >> 24)};
+		writeSpan(addr, data, sizeof(data));
+	}
+
+	void write_span(PhysPt addr, const uint8_t *data, size_t count)
+	{
+		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
+		addr += vga.svga.bank_write_full;
+		while (count) {
+			const PhysPt start = CHECKED2(addr);
+			const size_t n = std::min<size_t>(count, (vga.vmemwrap >> 2) - CHECKED4(start));
+			MEM_CHANGED( start << 3);
+			writeSpan(start, data, n);
+			addr += static_cast<PhysPt>(n);
+			data += n;
+			count -= n;
+		}
 	}
 };
 
@@ -472,18 +623,13 @@ public:
 class VGA_UnchainedVGA_Handler final : public VGA_UnchainedRead_Handler {
 public:
 	void writeHandler( PhysPt addr, Bit8u val ) {
-		Bit32u data=ModeOperation(val);
-		VGA_Latch pixels;
-		pixels.d=((Bit32u*)vga.mem.linear)[addr];
-		pixels.d&=vga.config.full_not_map_mask;
-		pixels.d|=(data & vga.config.full_map_mask);
-		((Bit32u*)vga.mem.linear)[addr]=pixels.d;
+		VGA_PlanarWrite(addr, val);
 //		if(vga.config.compatible_chain4)
 //			((Bit32u*)vga.mem.linear)[CHECKED2(addr+64*1024)]=pixels.d; 
 	}
 public:
 	VGA_UnchainedVGA_Handler()  {
-		flags=PFLAG_NOCODE;
+		flags=PFLAG_NOCODE|PFLAG_SPANWRITE;
 	}
 
 	void writeb(PhysPt addr, uint8_t val)
@@ -501,8 +647,8 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
 		MEM_CHANGED( addr << 2);
-		writeHandler(addr+0,(Bit8u)(val >> 0));
-		writeHandler(addr+1,(Bit8u)(val >> 8));
+		const uint8_t data[2] = {(Bit8u)(val >> 0), (Bit8u)(val >> 8)};
+		VGA_PlanarWriteSpan(addr, data, sizeof(data));
 	}
 
 	void writed(PhysPt addr, uint32_t val)
@@ -511,10 +657,24 @@ public:
 		addr += vga.svga.bank_write_full;
 		addr = CHECKED2(addr);
 		MEM_CHANGED( addr << 2);
-		writeHandler(addr+0,(Bit8u)(val >> 0));
-		writeHandler(addr+1,(Bit8u)(val >> 8));
-		writeHandler(addr+2,(Bit8u)(val >> 16));
-		writeHandler(addr+3,(Bit8u)(val >> 24));
+		const uint8_t data[4] = {(Bit8u)(val >> 0), (Bit8u)(val >> 8),
+		                         (Bit8u)(val >> 16), (Bit8u)(val >> 24)};
+		VGA_PlanarWriteSpan(addr, data, sizeof(data));
+	}
+
+	void write_span(PhysPt addr, const uint8_t *data, size_t count)
+	{
+		addr = PAGING_GetPhysicalAddress(addr) & vgapages.mask;
+		addr += vga.svga.bank_write_full;
+		while (count) {
+			const PhysPt start = CHECKED2(addr);
+			const size_t n = std::min<size_t>(count, (vga.vmemwrap >> 2) - CHECKED4(start));
+			MEM_CHANGED( start << 2);
+			VGA_PlanarWriteSpan(start, data, n);
+			addr += static_cast<PhysPt>(n);
+			data += n;
+			count -= n;
+		}
 	}
 };
 
@@ -545,9 +705,12 @@ public:
 		
 		if (GCC_LIKELY(vga.seq.map_mask == 0x4)) {
 			vga.draw.font[addr] = val;
+			++vga.draw.text_generation;
 		} else {
-			if (vga.seq.map_mask & 0x4) // font map
+			if (vga.seq.map_mask & 0x4) { // font map
 				vga.draw.font[addr] = val;
+				++vga.draw.text_generation;
+			}
 			if (vga.seq.map_mask & 0x2) // character attribute
 				vga.mem.linear[CHECKED3(vga.svga.bank_read_full +
 				                        addr + 1)] = val;
@@ -632,7 +795,7 @@ public:
 class VGA_LIN4_Handler final : public VGA_UnchainedEGA_Handler {
 public:
 	VGA_LIN4_Handler() {
-		flags=PFLAG_NOCODE;
+		flags=PFLAG_NOCODE|PFLAG_SPANWRITE;
 	}
 	void writeb(PhysPt addr, uint8_t val)
 	{
@@ -647,8 +810,8 @@ public:
 		addr = vga.svga.bank_write_full + (PAGING_GetPhysicalAddress(addr) & 0xffff);
 		addr = CHECKED4(addr);
 		MEM_CHANGED( addr << 3 );
-		writeHandler(addr+0,(Bit8u)(val >> 0));
-		writeHandler(addr+1,(Bit8u)(val >> 8));
+		const uint8_t data[2] = {(Bit8u)(val >> 0), (Bit8u)(val >> 8)};
+		writeSpan(addr, data, sizeof(data));
 	}
 
 	void writed(PhysPt addr, uint32_t val)
@@ -656,10 +819,23 @@ public:
 		addr = vga.svga.bank_write_full + (PAGING_GetPhysicalAddress(addr) & 0xffff);
 		addr = CHECKED4(addr);
 		MEM_CHANGED( addr << 3 );
-		writeHandler(addr+0,(Bit8u)(val >> 0));
-		writeHandler(addr+1,(Bit8u)(val >> 8));
-		writeHandler(addr+2,(Bit8u)(val >> 16));
-		writeHandler(addr+3,(Bit8u)(val >> 24));
+		const uint8_t data[4] = {(Bit8u)(val >> 0), (Bit8u)(val >> 8),
+		                         (Bit8u)(val >> 16), (Bit8u)(val >> 24)};
+		writeSpan(addr, data, sizeof(data));
+	}
+
+	void write_span(PhysPt addr, const uint8_t *data, size_t count)
+	{
+		addr = vga.svga.bank_write_full + (PAGING_GetPhysicalAddress(addr) & 0xffff);
+		while (count) {
+			const PhysPt start = CHECKED4(addr);
+			const size_t n = std::min<size_t>(count, (vga.vmemwrap >> 2) - start);
+			MEM_CHANGED( start << 3 );
+			writeSpan(start, data, n);
+			addr += static_cast<PhysPt>(n);
+			data += n;
+			count -= n;
+		}
 	}
 
 	uint8_t readb(PhysPt addr)
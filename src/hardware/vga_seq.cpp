@@ -38,6 +38,9 @@ void write_p3c5(io_port_t, io_val_t value, io_width_t)
 {
 	const auto val = check_cast<uint8_t>(value);
 	//	LOG_MSG("SEQ WRITE reg %X val %X",seq(index),val);
+	// The map mask and memory mode only change how the CPU sees memory
+	if (seq(index) == 1 || seq(index) == 3)
+		VGA_NoteRegisterWrite();
 	switch (seq(index)) {
 	case 0: /* Reset */ seq(reset) = val; break;
 	case 1: /* Clocking Mode */
@@ -79,6 +82,7 @@ void write_p3c5(io_port_t, io_val_t value, io_width_t)
 	case 3:		/* Character Map Select */
 		{
 			seq(character_map_select)=val;
+			++vga.draw.text_generation;
 		        auto font1 = static_cast<uint8_t>((val & 0x3) << 1);
 		        if (IS_VGA_ARCH)
 			        font1 |= (val & 0x10) >> 4;
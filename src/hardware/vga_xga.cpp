@@ -18,6 +18,7 @@
 
 #include "dosbox.h"
 
+#include <algorithm>
 #include <cassert>
 #include <math.h>
 #include <stdio.h>
@@ -254,6 +255,254 @@ static Bitu GetMixResult(uint32_t mixmode, Bitu srcval, Bitu dstdata)
 	return destval;
 }
 
+/* Row at a time paths for the rectangle, blit, and pattern commands. They
+ * cover commands whose pixels all lie on screen in video memory and whose
+ * mix is the same for every pixel, and draw exactly what the per-pixel paths
+ * through XGA_GetPoint, GetMixResult, and XGA_DrawPoint would. */
+static bool xga_bulk_draw = true;
+
+void XGA_SetBulkDraw(const bool enabled)
+{
+	xga_bulk_draw = enabled;
+}
+
+static Bitu XGA_BytesPerPixel()
+{
+	switch (XGA_COLOR_MODE) {
+	case M_LIN8: return 1;
+	case M_LIN15:
+	case M_LIN16: return 2;
+	case M_LIN32: return 4;
+	default: return 0;
+	}
+}
+
+// Returns the first column or row of a run of count pixels from pos
+// heading in the dir direction
+static Bits XGA_RunStart(const Bits pos, const Bits count, const Bits dir)
+{
+	return dir > 0 ? pos : pos - (count - 1);
+}
+
+// Checks that a rectangle is within the screen's width and video memory, so
+// its rows can be addressed directly
+static bool XGA_RectInMemory(const Bits left, const Bits top,
+                             const Bits width, const Bits height)
+{
+	const Bits right = left + width - 1;
+	const Bits bottom = top + height - 1;
+	if (left < 0 || top < 0 || right >= XGA_SCREEN_WIDTH)
+		return false;
+	const auto end = (static_cast<Bitu>(bottom) * XGA_SCREEN_WIDTH + right + 1) *
+	                 XGA_BytesPerPixel();
+	return end <= vga.vmemsize;
+}
+
+// Checks the parts of a command the bulk paths have in common: drawing is
+// enabled, the bit depth is known, and the mix's source is a colour or, if
+// allowed, the bitmap
+static bool XGA_CanDrawBulk(const uint32_t mixmode, const bool bitmap_source)
+{
+	if (!xga_bulk_draw)
+		return false;
+	if ((xga.curcommand & 0x11) != 0x11)
+		return false;
+	if (!XGA_BytesPerPixel())
+		return false;
+	const auto source = (mixmode >> 5) & 0x03;
+	return source < 0x02 || (source == 0x03 && bitmap_source);
+}
+
+static Bitu XGA_MixColour(const uint32_t mixmode)
+{
+	return ((mixmode >> 5) & 0x03) ? xga.forecolor : xga.backcolor;
+}
+
+// Mixes count source pixels into a row, stepping through the source by
+// src_step, which is zero for a single colour
+template <typename pixel_t>
+static void XGA_MixRow(pixel_t *dst, const pixel_t *src, const size_t src_step,
+                       const size_t count, const uint32_t mixmode)
+{
+	// XGA_DrawPoint keeps the top bit of 15-bit pixels clear
+	const auto mask = static_cast<pixel_t>(XGA_COLOR_MODE == M_LIN15 ? 0x7fff : ~0u);
+	const bool all_bits = mask == static_cast<pixel_t>(~0u);
+	switch (mixmode & 0xf) {
+	case 0x07: /* SRC */
+		if (all_bits && src_step)
+			memcpy(dst, src, count * sizeof(pixel_t));
+		else if (all_bits)
+			std::fill(dst, dst + count, *src);
+		else
+			for (size_t i = 0; i < count; ++i)
+				dst[i] = src[i * src_step] & mask;
+		break;
+	case 0x05: /* SRC xor DST */
+		for (size_t i = 0; i < count; ++i)
+			dst[i] = (src[i * src_step] ^ dst[i]) & mask;
+		break;
+	default:
+		for (size_t i = 0; i < count; ++i)
+			dst[i] = static_cast<pixel_t>(
+			        GetMixResult(mixmode, src[i * src_step], dst[i]) & mask);
+		break;
+	}
+}
+
+// Mixes a source into each row of a rectangle within the scissors, visiting
+// the rows in the same order as the per-pixel paths. get_source(k, x, count,
+// step) points to the source for count pixels from column x of the k-th row
+// visited and sets step to zero if it's a single colour.
+template <typename pixel_t, typename Source>
+static void XGA_MixRect(const Bits tarx, const Bits tary, const Bits width,
+                        const Bits height, const Bits dx, const Bits dy,
+                        const uint32_t mixmode, Source get_source)
+{
+	const Bits left = XGA_RunStart(tarx, width, dx);
+	const Bits x1 = std::max<Bits>(left, xga.scissors.x1);
+	const Bits x2 = std::min<Bits>(left + width - 1, xga.scissors.x2);
+	if (x1 > x2)
+		return;
+	const auto count = static_cast<size_t>(x2 - x1 + 1);
+	auto *mem = reinterpret_cast<pixel_t *>(vga.mem.linear);
+	for (Bits k = 0; k < height; ++k) {
+		const Bits y = tary + dy * k;
+		if (y < xga.scissors.y1 || y > xga.scissors.y2)
+			continue;
+		size_t step = 1;
+		const pixel_t *src = get_source(k, x1, count, step);
+		XGA_MixRow(mem + y * XGA_SCREEN_WIDTH + x1, src, step, count, mixmode);
+	}
+}
+
+template <typename pixel_t>
+static void XGA_FillRect(const Bits width, const Bits height, const Bits dx,
+                         const Bits dy, const uint32_t mixmode)
+{
+	const auto colour = static_cast<pixel_t>(XGA_MixColour(mixmode));
+	XGA_MixRect<pixel_t>(xga.curx, xga.cury, width, height, dx, dy, mixmode,
+	                     [&](Bits, Bits, size_t, size_t &step) {
+		                     step = 0;
+		                     return &colour;
+	                     });
+}
+
+template <typename pixel_t>
+static void XGA_BlitRows(const Bits width, const Bits height, const Bits dx,
+                         const Bits dy, const uint32_t mixmode)
+{
+	const auto colour = static_cast<pixel_t>(XGA_MixColour(mixmode));
+	const bool bitmap = ((mixmode >> 5) & 0x03) == 0x03;
+	const Bits offset = XGA_RunStart(xga.curx, width, dx) -
+	                    XGA_RunStart(xga.destx, width, dx);
+	const auto *mem = reinterpret_cast<const pixel_t *>(vga.mem.linear);
+	pixel_t row[0x1000];
+	XGA_MixRect<pixel_t>(xga.destx, xga.desty, width, height, dx, dy, mixmode,
+	                     [&](Bits k, Bits x, size_t count, size_t &step) {
+		                     if (!bitmap) {
+			                     step = 0;
+			                     return &colour;
+		                     }
+		                     const Bits y = xga.cury + dy * k;
+		                     const pixel_t *src = mem + y * XGA_SCREEN_WIDTH + x + offset;
+		                     // Rows copied within themselves are read before they're written
+		                     if (y != xga.desty + dy * k)
+			                     return src;
+		                     memcpy(row, src, count * sizeof(pixel_t));
+		                     return static_cast<const pixel_t *>(row);
+	                     });
+}
+
+template <typename pixel_t>
+static void XGA_PatternRows(const Bits width, const Bits height, const Bits dx,
+                            const Bits dy, const uint32_t mixmode)
+{
+	const auto colour = static_cast<pixel_t>(XGA_MixColour(mixmode));
+	const bool bitmap = ((mixmode >> 5) & 0x03) == 0x03;
+	const auto *mem = reinterpret_cast<const pixel_t *>(vga.mem.linear);
+	pixel_t row[0x1000];
+	XGA_MixRect<pixel_t>(xga.destx, xga.desty, width, height, dx, dy, mixmode,
+	                     [&](Bits k, Bits x, size_t count, size_t &step) {
+		                     if (!bitmap) {
+			                     step = 0;
+			                     return &colour;
+		                     }
+		                     // The 8x8 pattern repeats every eight rows and columns
+		                     const Bits y = xga.cury + ((xga.desty + dy * k) & 0x7);
+		                     const pixel_t *pattern = mem + y * XGA_SCREEN_WIDTH + xga.curx;
+		                     for (size_t i = 0; i < count; ++i)
+			                     row[i] = pattern[(x + i) & 0x7];
+		                     return static_cast<const pixel_t *>(row);
+	                     });
+}
+
+static bool XGA_DrawRectangleBulk(const Bits xrun, const Bits dx, const Bits dy)
+{
+	if ((xga.pix_cntl >> 6) & 0x3)
+		return false;
+	const uint32_t mixmode = xga.foremix;
+	if (!XGA_CanDrawBulk(mixmode, false))
+		return false;
+	const Bits width = xrun + 1;
+	const Bits height = xga.MIPcount + 1;
+	if (!XGA_RectInMemory(XGA_RunStart(xga.curx, width, dx),
+	                      XGA_RunStart(xga.cury, height, dy), width, height))
+		return false;
+	switch (XGA_BytesPerPixel()) {
+	case 1: XGA_FillRect<uint8_t>(width, height, dx, dy, mixmode); break;
+	case 2: XGA_FillRect<uint16_t>(width, height, dx, dy, mixmode); break;
+	default: XGA_FillRect<uint32_t>(width, height, dx, dy, mixmode); break;
+	}
+	return true;
+}
+
+static bool XGA_BlitRectBulk(const Bits dx, const Bits dy, const uint32_t mixmode)
+{
+	if (!XGA_CanDrawBulk(mixmode, true))
+		return false;
+	const Bits width = xga.MAPcount + 1;
+	const Bits height = xga.MIPcount + 1;
+	if (!XGA_RectInMemory(XGA_RunStart(xga.curx, width, dx),
+	                      XGA_RunStart(xga.cury, height, dy), width, height) ||
+	    !XGA_RectInMemory(XGA_RunStart(xga.destx, width, dx),
+	                      XGA_RunStart(xga.desty, height, dy), width, height))
+		return false;
+	// Copying along a row onto pixels it has yet to read smears the first
+	// ones across the row, which only the per-pixel path reproduces
+	if (xga.cury == xga.desty) {
+		const Bits ahead = (xga.destx - xga.curx) * dx;
+		if (ahead > 0 && ahead < width)
+			return false;
+	}
+	switch (XGA_BytesPerPixel()) {
+	case 1: XGA_BlitRows<uint8_t>(width, height, dx, dy, mixmode); break;
+	case 2: XGA_BlitRows<uint16_t>(width, height, dx, dy, mixmode); break;
+	default: XGA_BlitRows<uint32_t>(width, height, dx, dy, mixmode); break;
+	}
+	return true;
+}
+
+static bool XGA_DrawPatternBulk(const Bits dx, const Bits dy, const uint32_t mixmode)
+{
+	if (!XGA_CanDrawBulk(mixmode, true))
+		return false;
+	const Bits width = xga.MAPcount + 1;
+	const Bits height = xga.MIPcount + 1;
+	const Bits top = XGA_RunStart(xga.desty, height, dy);
+	if (!XGA_RectInMemory(xga.curx, xga.cury, 8, 8) ||
+	    !XGA_RectInMemory(XGA_RunStart(xga.destx, width, dx), top, width, height))
+		return false;
+	// Leave patterns drawn over themselves to the per-pixel path
+	if (xga.cury <= top + height - 1 && top <= xga.cury + 7)
+		return false;
+	switch (XGA_BytesPerPixel()) {
+	case 1: XGA_PatternRows<uint8_t>(width, height, dx, dy, mixmode); break;
+	case 2: XGA_PatternRows<uint16_t>(width, height, dx, dy, mixmode); break;
+	default: XGA_PatternRows<uint32_t>(width, height, dx, dy, mixmode); break;
+	}
+	return true;
+}
+
 static void XGA_DrawLineVector(const uint32_t val, const bool skip_last_pixel)
 {
 	// No work to do with a zero-length line
@@ -515,6 +764,12 @@ static void XGA_DrawRectangle(const uint32_t val, const bool skip_last_pixel)
 	// one pixel too wide (but don't underflow below zero).
 	const auto xrun = xga.MAPcount - (xga.MAPcount && skip_last_pixel);
 
+	if (XGA_DrawRectangleBulk(xrun, dx, dy)) {
+		xga.curx = static_cast<Bit16u>(xga.curx + dx * (xrun + 1));
+		xga.cury = static_cast<Bit16u>(xga.cury + dy * (xga.MIPcount + 1));
+		return;
+	}
+
 	for (auto yat = 0; yat <= xga.MIPcount; ++yat) {
 		srcx = xga.curx;
 		for (auto xat = 0; xat <= xrun; ++xat) {
@@ -820,6 +1075,9 @@ void XGA_BlitRect(Bitu val) {
 			break;
 	}
 
+	if (mixselect != 0x3 && XGA_BlitRectBulk(dx, dy, mixmode))
+		return;
+
 	/* Copy source to video ram */
 	srcy = xga.cury;
 	tary = xga.desty;
@@ -911,6 +1169,9 @@ void XGA_DrawPattern(Bitu val) {
 			break;
 	}
 
+	if (mixselect != 0x3 && XGA_DrawPatternBulk(dx, dy, mixmode))
+		return;
+
 	for(yat=0;yat<=xga.MIPcount;yat++) {
 		tarx = xga.destx;
 		for(xat=0;xat<=xga.MAPcount;xat++) {
@@ -527,6 +527,19 @@ SNDDECLSPEC Sint32 SDLCALL Sound_GetDuration(Sound_Sample *sample);
  */
 SNDDECLSPEC Uint32 SDLCALL Sound_Decode_Direct(Sound_Sample *sample, void* buffer, Uint32 desired_frames);
 
+/**
+ * \fn void Sound_SetSeekTableCacheDir(const char *dir)
+ * \brief Set the directory where MP3 seek tables are cached.
+ *
+ * Each MP3's seek table is stored in its own file, named after a hash of
+ *  the stream. Tables missing from the directory are built in the background
+ *  after the sample is opened and written there for subsequent runs. The
+ *  directory is created when the first table is written.
+ *
+ *    \param dir directory to read and write seek tables in.
+ */
+SNDDECLSPEC void SDLCALL Sound_SetSeekTableCacheDir(const char *dir);
+
 /**
  * \fn int Sound_Rewind(Sound_Sample *sample)
  * \brief Rewind a sample to the start.
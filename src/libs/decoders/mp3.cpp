@@ -30,6 +30,8 @@
 
 #include "config.h"
 
+#include <string>
+
 #include "support.h"
 
 #include "mp3_seek_table.h"
@@ -40,16 +42,25 @@
 #define __SDL_SOUND_INTERNAL__
 #include "SDL_sound_internal.h"
 
-static constexpr char fast_seek_filename[] = "fastseek.lut";
+// Where per-stream seek tables are cached; the working directory by default
+static std::string seek_table_cache_dir = ".";
+
+void SDLCALL Sound_SetSeekTableCacheDir(const char *dir)
+{
+    seek_table_cache_dir = dir;
+} /* Sound_SetSeekTableCacheDir */
 
 static size_t mp3_read(void* const pUserData, void* const pBufferOut, const size_t bytesToRead)
 {
     Uint8* ptr = static_cast<Uint8*>(pBufferOut);
     Sound_Sample* const sample = static_cast<Sound_Sample*>(pUserData);
     const Sound_SampleInternal* const internal = static_cast<const Sound_SampleInternal*>(sample->opaque);
+    mp3_t* p_mp3 = static_cast<mp3_t*>(internal->decoder_private);
     SDL_RWops* rwops = internal->rw;
     size_t bytes_read = 0;
 
+    std::lock_guard<std::mutex> lock(p_mp3->rw_mutex);
+
     while (bytes_read < bytesToRead)
     {
         const size_t rc = SDL_RWread(rwops, ptr, 1, bytesToRead - bytes_read);
@@ -69,6 +80,8 @@ static drmp3_bool32 mp3_seek(void* const pUserData, const Sint32 offset, const d
     const Sint32 whence = (origin == drmp3_seek_origin_start) ? RW_SEEK_SET : RW_SEEK_CUR;
     Sound_Sample* const sample = static_cast<Sound_Sample*>(pUserData);
     Sound_SampleInternal* const internal = static_cast<Sound_SampleInternal*>(sample->opaque);
+    mp3_t* p_mp3 = static_cast<mp3_t*>(internal->decoder_private);
+    std::lock_guard<std::mutex> lock(p_mp3->rw_mutex);
     return (SDL_RWseek(internal->rw, offset, whence) != -1) ? DRMP3_TRUE : DRMP3_FALSE;
 } /* mp3_seek */
 
@@ -90,6 +103,7 @@ static void MP3_close(Sound_Sample* const sample)
     mp3_t* p_mp3 = static_cast<mp3_t*>(internal->decoder_private);
     if (p_mp3) {
         assert(p_mp3->p_dr);
+        stop_seek_table_builder(p_mp3);
         drmp3_uninit(p_mp3->p_dr);
         delete p_mp3->p_dr;
         p_mp3->p_dr = nullptr;
@@ -118,20 +132,22 @@ static int32_t MP3_open(Sound_Sample* const sample, const char* const ext)
     mp3_t* p_mp3 = new mp3_t;
     p_mp3->p_dr = new drmp3;
 
+    // Assign our internal decoder to the mp3 object, whose stream lock
+    // the read and seek callbacks use
+    internal->decoder_private = p_mp3;
+
     // Open the MP3
     if (drmp3_init(p_mp3->p_dr, mp3_read, mp3_seek, sample, nullptr) != DRMP3_TRUE) {
         SNDDBG(("MP3: Failed to open the data stream.\n"));
+        internal->decoder_private = nullptr;
         delete p_mp3->p_dr;
         delete p_mp3;
         return 0; // failure
     }
 
-    // Assign our internal decoder to the mp3 object we've just opened
-    internal->decoder_private = p_mp3;
-
     bool result;
-    // Count the MP3's frames
-    const uint64_t num_frames = populate_seek_points(internal->rw, p_mp3, fast_seek_filename, result);
+    // Count (or estimate) the MP3's frames
+    const uint64_t num_frames = populate_seek_points(internal->rw, p_mp3, seek_table_cache_dir.c_str(), result);
     if (!result) {
         SNDDBG(("MP3: Unable to count the number of PCM frames.\n"));
         MP3_close(sample);
@@ -161,6 +177,11 @@ static Sint32 MP3_seek(Sound_Sample* const sample, const Uint32 ms)
     Sound_SampleInternal* const internal = static_cast<Sound_SampleInternal*>(sample->opaque);
     mp3_t* p_mp3 = static_cast<mp3_t*>(internal->decoder_private);
     const uint64_t sample_rate = sample->actual.rate;
+    // Replace the estimated length once the exact one is known
+    const uint64_t exact_frames = bind_new_seek_points(p_mp3);
+    if (exact_frames) {
+        internal->total_time = static_cast<int32_t>(ceil_udivide(exact_frames * 1000u, sample_rate));
+    }
     const drmp3_uint64 pcm_frame = ceil_udivide(sample_rate * ms, 1000u);
     const drmp3_bool32 result = drmp3_seek_to_pcm_frame(p_mp3->p_dr, pcm_frame);
     return (result == DRMP3_TRUE);
@@ -37,8 +37,16 @@
  *          reuse every subsequent time we need to seek within the MP3 file.  This allows
  *          seeks to be performed extremely fast while being PCM-exact.
  *
- *          This "fast-seek" file can hold data for multiple MP3s to avoid
- *          creating an excessive number of files in the local working directory.
+ *          Each MP3's table is kept in its own file inside the seek-table cache
+ *          directory, named after the stream's hash, so a new table only costs
+ *          writing that one small file.
+ *
+ *          Stepping through the whole stream takes a while for a full
+ *          soundtrack, so a missing table is built on a background thread.
+ *          The PCM frame count is needed up-front for the track's length, so
+ *          opening the file estimates it from the first frame's Xing tag or
+ *          bitrate; the builder refines it. Until the table arrives, dr_mp3
+ *          seeks by stepping through the stream itself.
  *
  * Challenges:
  *       1. What happens if an MP3 file is changed but the MP3's filename remains the same?
@@ -76,13 +84,16 @@
 
 // System headers
 #include <algorithm>
+#include <cinttypes>
 #include <climits>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
-#include <map>
 #include <string>
 #include <sys/stat.h>
 
 // Local headers
+#include "std_filesystem.h"
 #include "support.h"
 
 #define XXH_INLINE_ALL 1
@@ -94,23 +105,18 @@
 #include "xxhash.h"
 
 // C++ scope modifiers
-using std::map;
 using std::vector;
 using std::string;
 using std::ios_base;
 using std::ifstream;
 using std::ofstream;
 
-// container types
-using seek_points_table_t = typename std::map<uint64_t, std::vector<drmp3_seek_point_serial> >;
-using frame_count_table_t = typename std::map<uint64_t, uint64_t>;
-
 // Identifies a valid versioned seek-table
-#define SEEK_TABLE_IDENTIFIER "st-v6"
+#define SEEK_TABLE_IDENTIFIER "st-v7"
 
 // How many compressed MP3 frames should we skip between each recorded
 // time point.  The trade-off is as follows:
-//   - a large number means slower in-game seeking but a smaller fast-seek file.
+//   - a large number means slower in-game seeking but a smaller seek-table file.
 //   - a smaller numbers (below 10) results in fast seeks on slow hardware.
 constexpr uint32_t FRAMES_PER_SEEK_POINT = 7;
 
@@ -192,15 +198,20 @@ uint64_t calculate_stream_hash(struct SDL_RWops* const context) {
     return hash;
 }
 
-// This function generates a new seek-table for a given mp3 stream and writes
-// the data to the fast-seek file.
+// Returns the path of the seek-table file for the given stream within the
+// cache directory, which is named after the stream's hash.
+//
+string get_seek_table_path(const char* cache_dir, const uint64_t stream_hash) {
+    char filename[32];
+    snprintf(filename, sizeof(filename), "%016" PRIx64 ".lut", stream_hash);
+    return (std_fs::path(cache_dir) / filename).string();
+}
+
+// This function steps through the mp3 stream and calculates its seek points
+// and PCM frame count. It returns the number of PCM frames, or 0 on failure.
 //
-uint64_t generate_new_seek_points(const char* filename,
-                                const uint64_t& stream_hash,
-                                drmp3* const p_dr,
-                                seek_points_table_t& seek_points_table,
-                                frame_count_table_t& pcm_frame_count_table,
-                                vector<drmp3_seek_point_serial>& seek_points_vector) {
+uint64_t calculate_seek_points(drmp3* const p_dr,
+                               vector<drmp3_seek_point_serial>& seek_points_vector) {
 
     // Initialize our frame counters with zeros.
     drmp3_uint64 mp3_frame_count(0);
@@ -243,46 +254,164 @@ uint64_t generate_new_seek_points(const char* filename,
         seek_points_vector.resize(num_seek_points);
     }
 
-    // Update our lookup table file with the new seek points and pcm_frame_count.
-    // Note: the serializer elegantly handles C++ STL objects and is endian-safe.
-    seek_points_table[stream_hash] = seek_points_vector;
-    pcm_frame_count_table[stream_hash] = pcm_frame_count;
-    ofstream outfile(filename, ios_base::trunc | ios_base::binary);
+    // Finally, we return the number of decoded PCM frames for this given file, which
+    // doubles as a success-code.
+    return pcm_frame_count;
+}
+
+// Returns the bitrate of the MP3 frame with the given header in kbps, or 0 for a
+// free-format stream. This matches dr_mp3's private drmp3_hdr_bitrate_kbps.
+//
+static uint32_t get_bitrate_kbps(const drmp3_uint8* const header) {
+    static constexpr uint8_t halfrate[2][3][15] = {
+        { { 0,4,8,12,16,20,24,28,32,40,48,56,64,72,80 }, { 0,4,8,12,16,20,24,28,32,40,48,56,64,72,80 }, { 0,16,24,28,32,40,48,56,64,72,80,88,96,112,128 } },
+        { { 0,16,20,24,28,32,40,48,56,64,80,96,112,128,160 }, { 0,16,24,28,32,40,48,56,64,80,96,112,128,160,192 }, { 0,16,32,48,64,80,96,112,128,144,160,176,192,208,224 } },
+    };
+    const auto is_mpeg1 = (header[1] & 0x8) != 0;
+    const auto layer = (header[1] >> 1) & 3;
+    const auto bitrate_index = header[2] >> 4;
+    if (layer == 0 || bitrate_index == 15) {
+        return 0;
+    }
+    return 2u * halfrate[is_mpeg1][layer - 1][bitrate_index];
+}
+
+static uint32_t read_be32(const uint8_t* const bytes) {
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+}
+
+// This function estimates the number of PCM frames in the mp3 stream without
+// stepping through it, returning 0 if it can't.
+//
+// dr_mp3 decodes the first MP3 frame while opening the stream, so that frame's
+// header tells us its layout. Most encoders, and every VBR encoder, put a Xing
+// or Info tag in the first frame, which holds the stream's exact frame count.
+// Otherwise the count is extrapolated from the stream's size and the first
+// frame's bitrate, which is exact for constant-bitrate streams, give or take
+// a trailing tag. The background builder refines the count either way.
+//
+uint64_t estimate_pcm_frame_count(struct SDL_RWops* const context,
+                                  const drmp3* const p_dr) {
+    const drmp3_uint8* const header = p_dr->decoder.header;
+    const uint64_t frame_samples = p_dr->pcmFramesRemainingInMP3Frame;
+    const uint64_t sample_rate = p_dr->mp3FrameSampleRate;
+    const auto kbps = get_bitrate_kbps(header);
+    if (frame_samples == 0 || sample_rate == 0 || kbps == 0) {
+        // LOG_MSG("MP3: cannot estimate the length of a free-format stream");
+        return 0;
+    }
+
+    // The first frame ends where dr_mp3 stopped consuming data. Its size follows
+    // from the header, with layer I frames being made of 4-byte slots.
+    const auto is_layer_1 = ((header[1] >> 1) & 3) == 3;
+    const auto is_layer_3 = ((header[1] >> 1) & 3) == 1;
+    auto frame_bytes = static_cast<Sint64>(frame_samples * kbps * 125 / sample_rate);
+    if (is_layer_1) {
+        frame_bytes &= ~3;
+    }
+    if (header[2] & 0x2) {
+        frame_bytes += is_layer_1 ? 4 : 1;
+    }
+    const auto frame_end = static_cast<Sint64>(p_dr->streamCursor - p_dr->dataSize);
+    const auto frame_start = frame_end - frame_bytes;
+
+    // Save the current stream position, so we can restore it at the end of the function.
+    const auto original_pos = SDL_RWtell(context);
+    const auto end_pos = SDL_RWseek(context, 0, RW_SEEK_END);
+
+    // A layer III Xing or Info tag follows the header, its optional CRC, and
+    // the side information, whose size depends on the MPEG version and mode.
+    uint64_t xing_frame_count = 0;
+    if (is_layer_3 && frame_start >= 0) {
+        const auto is_mpeg1 = (header[1] & 0x8) != 0;
+        const auto is_mono = (header[3] & 0xC0) == 0xC0;
+        const auto has_crc = (header[1] & 0x1) == 0;
+        const auto side_info_bytes = is_mpeg1 ? (is_mono ? 17 : 32) : (is_mono ? 9 : 17);
+        const auto tag_offset = 4 + (has_crc ? 2 : 0) + side_info_bytes;
+
+        uint8_t tag[12] = {};
+        SDL_RWseek(context, frame_start + tag_offset, RW_SEEK_SET);
+        if (SDL_RWread(context, tag, 1, sizeof(tag)) == sizeof(tag)
+            && (memcmp(tag, "Xing", 4) == 0 || memcmp(tag, "Info", 4) == 0)
+            && (read_be32(tag + 4) & 0x1)) {
+            xing_frame_count = read_be32(tag + 8);
+        }
+    }
+
+    // restore the stream position
+    SDL_RWseek(context, original_pos, RW_SEEK_SET);
+    assert(SDL_RWtell(context) == original_pos);
+
+    // The tag's count leaves out the tag's own frame, which dr_mp3 decodes as
+    // silence.
+    if (xing_frame_count != 0) {
+        return (xing_frame_count + 1) * frame_samples;
+    }
+    if (end_pos <= frame_end) {
+        return frame_samples;
+    }
+    const auto remaining_bytes = static_cast<uint64_t>(end_pos - frame_end);
+    return frame_samples + remaining_bytes * sample_rate / (kbps * 125);
+}
+
+// This function writes the seek-table for a given mp3 stream into its own file
+// within the cache directory.
+//
+void save_seek_points(const char* cache_dir,
+                      const uint64_t stream_hash,
+                      const uint64_t pcm_frame_count,
+                      const vector<drmp3_seek_point_serial>& seek_points) {
 
     // Caching our seek table to file is optional.  If the user is blocked due to
     // security or write-access issues, then this write-phase is skipped. In this
-    // scenario the seek table will be generated on-the-fly on every start of DOSBox.
-    if (outfile.is_open()) {
-        Archive<ofstream> serialize(outfile);
-        serialize << SEEK_TABLE_IDENTIFIER << seek_points_table << pcm_frame_count_table;
-        outfile.close();
+    // scenario the seek table will be generated in the background on every start
+    // of DOSBox.
+    std::error_code ec;
+    std_fs::create_directories(cache_dir, ec);
+    if (ec) {
+        return;
     }
 
-    // Finally, we return the number of decoded PCM frames for this given file, which
-    // doubles as a success-code.
-    return pcm_frame_count;
+    // Write to a temporary file first so a concurrent reader (or a crash) never
+    // sees a partially written table.
+    const auto filename = get_seek_table_path(cache_dir, stream_hash);
+    const auto temp_filename = filename + ".tmp";
+    ofstream outfile(temp_filename, ios_base::trunc | ios_base::binary);
+    if (!outfile.is_open()) {
+        return;
+    }
+
+    // Note: the serializer elegantly handles C++ STL objects and is endian-safe.
+    Archive<ofstream> serialize(outfile);
+    serialize << SEEK_TABLE_IDENTIFIER << pcm_frame_count << seek_points;
+    outfile.close();
+
+    std_fs::rename(temp_filename, filename, ec);
+    if (ec) {
+        std_fs::remove(temp_filename, ec);
+    }
 }
 
-// This function attempts to fetch a seek-table for a given mp3 stream from the fast-seek file.
-// If anything is amiss then this function fails.
+// This function attempts to fetch a seek-table for a given mp3 stream from the
+// cache directory. If anything is amiss then this function fails.
 //
-uint64_t load_existing_seek_points(const char* filename,
-                                 const uint64_t& stream_hash,
-                                 seek_points_table_t& seek_points_table,
-                                 frame_count_table_t& pcm_frame_count_table,
-                                 vector<drmp3_seek_point_serial>& seek_points) {
+uint64_t load_existing_seek_points(const char* cache_dir,
+                                   const uint64_t stream_hash,
+                                   vector<drmp3_seek_point_serial>& seek_points) {
 
     // The below sentinals sanity check and read the incoming
     // file one-by-one until all the data can be trusted.
+    const auto filename = get_seek_table_path(cache_dir, stream_hash);
 
     // Sentinal 1: bail if we got a zero-byte file.
     struct stat buffer;
-    if (stat(filename, &buffer) != 0) {
+    if (stat(filename.c_str(), &buffer) != 0) {
         return 0;
     }
 
     // Sentinal 2: Bail if the file isn't big enough to hold our identifier.
-    if (get_file_size(filename) < static_cast<int64_t>(sizeof(SEEK_TABLE_IDENTIFIER))) {
+    if (get_file_size(filename.c_str()) < static_cast<int64_t>(sizeof(SEEK_TABLE_IDENTIFIER))) {
         return 0;
     }
 
@@ -296,35 +425,113 @@ uint64_t load_existing_seek_points(const char* filename,
         return 0;
     }
 
-    // De-serialize the seek point and pcm_count tables.
-    deserialize >> seek_points_table >> pcm_frame_count_table;
+    // De-serialize the pcm_count and seek points.
+    uint64_t pcm_frame_count = 0;
+    vector<drmp3_seek_point_serial> fetched_seek_points;
+    deserialize >> pcm_frame_count >> fetched_seek_points;
+    const bool read_ok = !infile.fail();
     infile.close();
 
-    // Sentinal 4: does the seek_points table have our stream's hash?
-    const auto p_seek_points = seek_points_table.find(stream_hash);
-    if (p_seek_points == seek_points_table.end()) {
+    // Sentinal 4: did we get the full table?
+    if (!read_ok || pcm_frame_count == 0 || fetched_seek_points.empty()) {
         return 0;
     }
 
-    // Sentinal 5: does the pcm_frame_count table have our stream's hash?
-    const auto p_pcm_frame_count = pcm_frame_count_table.find(stream_hash);
-    if (p_pcm_frame_count == pcm_frame_count_table.end()) {
+    // If we made it here, the file was valid and has lookup-data for our
+    // our desired stream
+    seek_points = std::move(fetched_seek_points);
+    return pcm_frame_count;
+}
+
+// The background builder steps through the stream with its own dr_mp3
+// instance. It shares the stream's SDL_RWops with the decoder, so each read
+// briefly takes the stream lock and restores the decoder's position after.
+//
+struct builder_stream_t {
+    SDL_RWops* context = nullptr;
+    mp3_t* p_mp3 = nullptr;
+    Sint64 position = 0;
+};
+
+static size_t builder_read(void* const pUserData, void* const pBufferOut, const size_t bytesToRead)
+{
+    auto stream = static_cast<builder_stream_t*>(pUserData);
+    if (stream->p_mp3->stop_builder) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(stream->p_mp3->rw_mutex);
+    const auto decoder_position = SDL_RWtell(stream->context);
+    if (SDL_RWseek(stream->context, stream->position, RW_SEEK_SET) == -1) {
         return 0;
     }
+    const size_t bytes_read = SDL_RWread(stream->context, pBufferOut, 1, bytesToRead);
+    stream->position += static_cast<Sint64>(bytes_read);
+    SDL_RWseek(stream->context, decoder_position, RW_SEEK_SET);
+    return bytes_read;
+}
 
-    // If we made it here, the file was valid and has lookup-data for our
-    // our desired stream
-    seek_points = p_seek_points->second;
-    return p_pcm_frame_count->second;
+static drmp3_bool32 builder_seek(void* const pUserData, const int offset, const drmp3_seek_origin origin)
+{
+    auto stream = static_cast<builder_stream_t*>(pUserData);
+    const auto position = (origin == drmp3_seek_origin_start) ? offset : stream->position + offset;
+    if (position < 0) {
+        return DRMP3_FALSE;
+    }
+    stream->position = position;
+    return DRMP3_TRUE;
+}
+
+static void build_seek_points(SDL_RWops* const context,
+                              mp3_t* p_mp3,
+                              const string cache_dir,
+                              const uint64_t stream_hash) {
+    builder_stream_t stream = {context, p_mp3, 0};
+    drmp3 dr;
+    if (drmp3_init(&dr, builder_read, builder_seek, &stream, nullptr) != DRMP3_TRUE) {
+        return;
+    }
+    vector<drmp3_seek_point_serial> seek_points;
+    const auto pcm_frame_count = calculate_seek_points(&dr, seek_points);
+    drmp3_uninit(&dr);
+
+    // A stop request cuts the stream short, so the table can't be trusted
+    if (pcm_frame_count == 0 || p_mp3->stop_builder) {
+        return;
+    }
+    save_seek_points(cache_dir.c_str(), stream_hash, pcm_frame_count, seek_points);
+
+    p_mp3->new_seek_points = std::move(seek_points);
+    p_mp3->new_pcm_frame_count = pcm_frame_count;
+    p_mp3->new_seek_points_ready.store(true, std::memory_order_release);
+}
+
+uint64_t bind_new_seek_points(mp3_t* p_mp3) {
+    if (!p_mp3->new_seek_points_ready.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    p_mp3->new_seek_points_ready = false;
+    p_mp3->seek_points_vector = std::move(p_mp3->new_seek_points);
+    drmp3_bind_seek_table(p_mp3->p_dr,
+                          static_cast<uint32_t>(p_mp3->seek_points_vector.size()),
+                          reinterpret_cast<drmp3_seek_point*>(p_mp3->seek_points_vector.data()));
+    return p_mp3->new_pcm_frame_count;
+}
+
+void stop_seek_table_builder(mp3_t* p_mp3) {
+    if (p_mp3->builder.joinable()) {
+        p_mp3->stop_builder = true;
+        p_mp3->builder.join();
+    }
 }
 
 // This function attempts to populate our seek table for the given mp3 stream, first
-// attempting to read it from the fast-seek file and (if it can't be read for any reason), it
-// calculates new data.  It makes use of the above two functions.
+// attempting to read it from the cache directory. If it can't be read for any reason,
+// it estimates the stream's PCM frame count and builds the seek table, along with
+// the exact count, on a background thread.
 //
 uint64_t populate_seek_points(struct SDL_RWops* const context,
                               mp3_t* p_mp3,
-                              const char* seektable_filename,
+                              const char* cache_dir,
                               bool &result) {
 
     // assume failure until proven otherwise
@@ -338,37 +545,34 @@ uint64_t populate_seek_points(struct SDL_RWops* const context,
     }
 
     // Attempt to fetch the seek points and pcm count from an existing look up table file.
-    seek_points_table_t seek_points_table;
-    frame_count_table_t pcm_frame_count_table;
-    auto pcm_frame_count = load_existing_seek_points(seektable_filename,
-                                                     stream_hash,
-                                                     seek_points_table,
-                                                     pcm_frame_count_table,
-                                                     p_mp3->seek_points_vector);
-
-    // Otherwise calculate new seek points and save them to the fast-seek file.
-    if (pcm_frame_count == 0) {
-        pcm_frame_count = generate_new_seek_points(seektable_filename,
-                                                   stream_hash,
-                                                   p_mp3->p_dr,
-                                                   seek_points_table,
-                                                   pcm_frame_count_table,
-                                                   p_mp3->seek_points_vector);
-        if (pcm_frame_count == 0) {
-            // LOG_MSG("MP3: could not load existing or generate new seek points for the stream");
+    const auto pcm_frame_count = load_existing_seek_points(cache_dir,
+                                                           stream_hash,
+                                                           p_mp3->seek_points_vector);
+
+    // We have our seek points! We bind them to the dr_mp3 object which will be
+    // used for fast seeking.
+    if (pcm_frame_count != 0) {
+        if (drmp3_bind_seek_table(p_mp3->p_dr,
+                                  static_cast<uint32_t>(p_mp3->seek_points_vector.size()),
+                                  reinterpret_cast<drmp3_seek_point*>(p_mp3->seek_points_vector.data()))
+                                  != DRMP3_TRUE) {
             return 0;
         }
+        result = true;
+        return pcm_frame_count;
     }
 
-    // Finally, regardless of which scenario succeeded above, we now have our seek points!
-    // We bind our seek points to the dr_mp3 object which will be used for fast seeking.
-    if(drmp3_bind_seek_table(p_mp3->p_dr,
-                             static_cast<uint32_t>(p_mp3->seek_points_vector.size()),
-                             reinterpret_cast<drmp3_seek_point*>(p_mp3->seek_points_vector.data()))
-                             != DRMP3_TRUE) {
+    // Otherwise the track's length is needed now, but counting its frames means
+    // reading the whole stream, so we estimate it instead and leave the exact
+    // count to the builder.
+    const auto estimated_pcm_frame_count = estimate_pcm_frame_count(context, p_mp3->p_dr);
+    if (estimated_pcm_frame_count < FRAMES_PER_SEEK_POINT) {
+        // LOG_MSG("MP3: could not estimate the PCM frames in the stream");
         return 0;
     }
 
+    p_mp3->builder = std::thread(build_seek_points, context, p_mp3,
+                                 string(cache_dir), stream_hash);
     result = true;
-    return pcm_frame_count;
+    return estimated_pcm_frame_count;
 }
@@ -35,8 +35,11 @@
 
 #include "config.h"
 
-#include <vector>    // provides: vector
-#include <SDL.h>     // provides: SDL_RWops
+#include <atomic>   // provides: atomic
+#include <mutex>    // provides: mutex
+#include <thread>   // provides: thread
+#include <vector>   // provides: vector
+#include <SDL.h>    // provides: SDL_RWops
 #include "archive.h" // provides: archive
 
 // Ensure we only get the API
@@ -62,14 +65,32 @@ struct drmp3_seek_point_serial {
 // Our private-decoder structure where we hold:
 //   - a pointer to the working dr_mp3 instance
 //   - a template vector of seek_points (the serializeable form)
+//   - the state of the background thread that builds a missing seek table
 struct mp3_t {
     drmp3* p_dr = nullptr;    // the actual drmp3 instance we open, read, and seek within
     std::vector<drmp3_seek_point_serial> seek_points_vector = {};
+
+    // Guards the stream's SDL_RWops, which the builder shares with p_dr
+    std::mutex rw_mutex = {};
+
+    std::thread builder = {};
+    std::atomic<bool> stop_builder = {false};
+    std::atomic<bool> new_seek_points_ready = {false};
+    std::vector<drmp3_seek_point_serial> new_seek_points = {};
+    uint64_t new_pcm_frame_count = 0;
 };
 
 uint64_t populate_seek_points(struct SDL_RWops* const context,
                               mp3_t* p_mp3,
-                              const char* seektable_filename,
+                              const char* cache_dir,
                               bool &result);
 
+// Binds the seek table once the background builder has produced it, returning
+// the stream's exact PCM frame count if it did (or 0 otherwise).
+// Must be called from the thread that reads and seeks within p_dr.
+uint64_t bind_new_seek_points(mp3_t* p_mp3);
+
+// Stops and joins the background builder, if one is running
+void stop_seek_table_builder(mp3_t* p_mp3);
+
 #endif
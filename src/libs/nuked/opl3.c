@@ -1096,15 +1096,16 @@ static void OPL3_ProcessSlot(opl3_slot *slot)
     OPL3_SlotGenerate(slot);
 }
 
+static void OPL3_ClockTimers(opl3_chip *chip);
+static uint32_t OPL3_ProcessWriteBuf(opl3_chip *chip);
+
 void OPL3_Generate(opl3_chip *chip, int16_t *buf)
 {
     opl3_channel *channel;
-    opl3_writebuf *writebuf;
     int16_t **out;
     int32_t mix;
     uint8_t ii;
     int16_t accm;
-    uint8_t shift = 0;
 
     buf[1] = OPL3_ClipSample(chip->mixbuff[1]);
 
@@ -1168,6 +1169,14 @@ void OPL3_Generate(opl3_chip *chip, int16_t *buf)
     }
 #endif
 
+    OPL3_ClockTimers(chip);
+    OPL3_ProcessWriteBuf(chip);
+}
+
+static void OPL3_ClockTimers(opl3_chip *chip)
+{
+    uint8_t shift = 0;
+
     if ((chip->timer & 0x3f) == 0x3f)
     {
         chip->tremolopos = (chip->tremolopos + 1) % 210;
@@ -1220,6 +1229,13 @@ void OPL3_Generate(opl3_chip *chip, int16_t *buf)
     }
 
     chip->eg_state ^= 1;
+}
+
+/* Returns the number of register writes that were applied */
+static uint32_t OPL3_ProcessWriteBuf(opl3_chip *chip)
+{
+    opl3_writebuf *writebuf;
+    uint32_t writes = 0;
 
     while ((writebuf = &chip->writebuf[chip->writebuf_cur]), writebuf->time <= chip->writebuf_samplecnt)
     {
@@ -1230,17 +1246,21 @@ void OPL3_Generate(opl3_chip *chip, int16_t *buf)
         writebuf->reg &= 0x1ff;
         OPL3_WriteReg(chip, writebuf->reg, writebuf->data);
         chip->writebuf_cur = (chip->writebuf_cur + 1) % OPL_WRITEBUF_SIZE;
+        writes++;
     }
     chip->writebuf_samplecnt++;
+    return writes;
 }
 
-void OPL3_GenerateResampled(opl3_chip *chip, int16_t *buf)
+typedef void(*generate_func)(opl3_chip *chip, int16_t *buf);
+
+static void OPL3_Resample(opl3_chip *chip, int16_t *buf, generate_func generate)
 {
     while (chip->samplecnt >= chip->rateratio)
     {
         chip->oldsamples[0] = chip->samples[0];
         chip->oldsamples[1] = chip->samples[1];
-        OPL3_Generate(chip, chip->samples);
+        generate(chip, chip->samples);
         chip->samplecnt -= chip->rateratio;
     }
     buf[0] = (int16_t)((chip->oldsamples[0] * (chip->rateratio - chip->samplecnt)
@@ -1250,6 +1270,11 @@ void OPL3_GenerateResampled(opl3_chip *chip, int16_t *buf)
     chip->samplecnt += 1 << RSM_FRAC;
 }
 
+void OPL3_GenerateResampled(opl3_chip *chip, int16_t *buf)
+{
+    OPL3_Resample(chip, buf, OPL3_Generate);
+}
+
 void OPL3_Reset(opl3_chip *chip, uint32_t samplerate)
 {
     opl3_slot *slot;
@@ -1471,3 +1496,529 @@ void OPL3_GenerateStream(opl3_chip *chip, int16_t *sndptr, uint32_t numsamples)
         sndptr += 2;
     }
 }
+
+/*
+    Slot-parallel generator
+
+    Produces the same output as OPL3_Generate, with the per-slot work
+    regrouped so the envelope and phase generators of all slots run
+    together in SIMD lanes:
+
+    1. feedback of all slots, which only reads each slot's own output
+    2. envelope generator of all slots (lanes)
+    3. phase generator of all slots (lanes), then the rhythm-mode phases
+    4. waveform output in slot order, as carriers read the output of
+       modulators computed earlier in the same sample
+
+    The waveform lookup stays scalar: SSE2 lacks gathers and the slots
+    depend on each other in slot order. While a stream is generated, the
+    dynamic slot state lives in chip->lanes; it's written back to the slots
+    when the stream is complete.
+*/
+
+#ifndef OPL_LANES_SSE2
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OPL_LANES_SSE2 1
+#else
+#define OPL_LANES_SSE2 0
+#endif
+#endif
+
+#if OPL_LANES_SSE2
+#include <emmintrin.h>
+#endif
+
+#define OPL_LANE_FBMOD  OPL_LANES
+#define OPL_LANE_ZERO   (OPL_LANES * 2)
+
+/*
+    Lane operations: SSE2, or portable loops over fixed-width arrays that
+    compilers can auto-vectorize for other targets (such as NEON).
+*/
+
+#if OPL_LANES_SSE2
+
+typedef __m128i lanes16; /* 8 x int16_t */
+typedef __m128i lanes32; /* 4 x int32_t */
+
+#define L16_LOAD(p)         _mm_loadu_si128((const __m128i *)(p))
+#define L16_STORE(p, a)     _mm_storeu_si128((__m128i *)(p), (a))
+#define L16_SET(x)          _mm_set1_epi16((int16_t)(x))
+#define L16_ADD(a, b)       _mm_add_epi16((a), (b))
+#define L16_AND(a, b)       _mm_and_si128((a), (b))
+#define L16_OR(a, b)        _mm_or_si128((a), (b))
+#define L16_ANDNOT(a, b)    _mm_andnot_si128((a), (b))
+#define L16_XOR(a, b)       _mm_xor_si128((a), (b))
+#define L16_EQ(a, b)        _mm_cmpeq_epi16((a), (b))
+#define L16_GT(a, b)        _mm_cmpgt_epi16((a), (b))
+#define L16_SLL(a, n)       _mm_slli_epi16((a), (n))
+#define L16_SRL(a, n)       _mm_srli_epi16((a), (n))
+#define L16_SRA(a, n)       _mm_srai_epi16((a), (n))
+
+#define L32_LOAD(p)         _mm_loadu_si128((const __m128i *)(p))
+#define L32_STORE(p, a)     _mm_storeu_si128((__m128i *)(p), (a))
+#define L32_SET(x)          _mm_set1_epi32((int32_t)(x))
+#define L32_ADD(a, b)       _mm_add_epi32((a), (b))
+#define L32_SUB(a, b)       _mm_sub_epi32((a), (b))
+#define L32_AND(a, b)       _mm_and_si128((a), (b))
+#define L32_ANDNOT(a, b)    _mm_andnot_si128((a), (b))
+#define L32_SRL(a, n)       _mm_srli_epi32((a), (n))
+#define L32_SRLV(a, n)      _mm_srl_epi32((a), _mm_cvtsi32_si128(n))
+
+/* Widens four int16 lane masks to int32 lane masks */
+#define L32_LOAD_MASK16(p)  _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(p)), \
+                                               _mm_loadl_epi64((const __m128i *)(p)))
+
+static lanes32 L32_MUL(lanes32 a, lanes32 b)
+{
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+#else
+
+typedef struct { int16_t l[8]; } lanes16;
+typedef struct { int32_t l[4]; } lanes32;
+
+#define L16_OP(expr) \
+    lanes16 r; uint8_t i; for (i = 0; i < 8; i++) { r.l[i] = (int16_t)(expr); } return r
+#define L32_OP(expr) \
+    lanes32 r; uint8_t i; for (i = 0; i < 4; i++) { r.l[i] = (int32_t)(expr); } return r
+
+static lanes16 L16_LOAD(const int16_t *p) { L16_OP(p[i]); }
+static void L16_STORE(int16_t *p, lanes16 a) { memcpy(p, a.l, sizeof(a.l)); }
+static lanes16 L16_SET(int16_t x) { L16_OP(x); }
+static lanes16 L16_ADD(lanes16 a, lanes16 b) { L16_OP(a.l[i] + b.l[i]); }
+static lanes16 L16_AND(lanes16 a, lanes16 b) { L16_OP(a.l[i] & b.l[i]); }
+static lanes16 L16_OR(lanes16 a, lanes16 b) { L16_OP(a.l[i] | b.l[i]); }
+static lanes16 L16_ANDNOT(lanes16 a, lanes16 b) { L16_OP(~a.l[i] & b.l[i]); }
+static lanes16 L16_XOR(lanes16 a, lanes16 b) { L16_OP(a.l[i] ^ b.l[i]); }
+static lanes16 L16_EQ(lanes16 a, lanes16 b) { L16_OP(a.l[i] == b.l[i] ? -1 : 0); }
+static lanes16 L16_GT(lanes16 a, lanes16 b) { L16_OP(a.l[i] > b.l[i] ? -1 : 0); }
+static lanes16 L16_SLL(lanes16 a, int n) { L16_OP((uint16_t)a.l[i] << n); }
+static lanes16 L16_SRL(lanes16 a, int n) { L16_OP((uint16_t)a.l[i] >> n); }
+static lanes16 L16_SRA(lanes16 a, int n) { L16_OP(a.l[i] >> n); }
+
+static lanes32 L32_LOAD(const void *p) { lanes32 r; memcpy(r.l, p, sizeof(r.l)); return r; }
+static void L32_STORE(void *p, lanes32 a) { memcpy(p, a.l, sizeof(a.l)); }
+static lanes32 L32_SET(int32_t x) { L32_OP(x); }
+static lanes32 L32_ADD(lanes32 a, lanes32 b) { L32_OP((uint32_t)a.l[i] + (uint32_t)b.l[i]); }
+static lanes32 L32_SUB(lanes32 a, lanes32 b) { L32_OP((uint32_t)a.l[i] - (uint32_t)b.l[i]); }
+static lanes32 L32_AND(lanes32 a, lanes32 b) { L32_OP(a.l[i] & b.l[i]); }
+static lanes32 L32_ANDNOT(lanes32 a, lanes32 b) { L32_OP(~a.l[i] & b.l[i]); }
+static lanes32 L32_SRL(lanes32 a, int n) { L32_OP((uint32_t)a.l[i] >> n); }
+static lanes32 L32_SRLV(lanes32 a, int n) { L32_OP((uint32_t)a.l[i] >> n); }
+static lanes32 L32_MUL(lanes32 a, lanes32 b) { L32_OP((uint32_t)a.l[i] * (uint32_t)b.l[i]); }
+static lanes32 L32_LOAD_MASK16(const int16_t *p) { L32_OP(p[i]); }
+
+#endif
+
+/* Lane-wise mask ? a : b */
+#define L16_SELECT(mask, a, b) L16_OR(L16_AND((mask), (a)), L16_ANDNOT((mask), (b)))
+
+static uint8_t OPL3_LanesValIndex(const opl3_chip *chip, const int16_t *ptr)
+{
+    const uintptr_t base = (uintptr_t)chip->slot;
+    const uintptr_t addr = (uintptr_t)ptr;
+    uint8_t slotnum;
+
+    if (addr >= base && addr < base + sizeof(chip->slot))
+    {
+        slotnum = (uint8_t)((addr - base) / sizeof(opl3_slot));
+        if (ptr == &chip->slot[slotnum].out)
+        {
+            return slotnum;
+        }
+        if (ptr == &chip->slot[slotnum].fbmod)
+        {
+            return OPL_LANE_FBMOD + slotnum;
+        }
+    }
+    return OPL_LANE_ZERO;
+}
+
+static void OPL3_LanesGatherRegs(opl3_chip *chip)
+{
+    opl3_lanes *lanes = &chip->lanes;
+    opl3_slot *slot;
+    uint8_t ii, jj;
+
+    for (ii = 0; ii < 36; ii++)
+    {
+        slot = &chip->slot[ii];
+        lanes->eg_ar[ii] = slot->reg_ar;
+        lanes->eg_dr[ii] = slot->reg_dr;
+        lanes->eg_sr[ii] = slot->reg_type ? 0 : slot->reg_rr;
+        lanes->eg_rr[ii] = slot->reg_rr;
+        lanes->eg_sl[ii] = slot->reg_sl;
+        lanes->eg_ks[ii] = slot->channel->ksv >> ((slot->reg_ksr ^ 1) << 1);
+        lanes->eg_base[ii] = (slot->reg_tl << 2)
+                           + (slot->eg_ksl >> kslshift[slot->reg_ksl]);
+        lanes->eg_trem[ii] = (slot->trem == &chip->tremolo) ? -1 : 0;
+        lanes->eg_key[ii] = slot->key ? -1 : 0;
+        lanes->pg_fnum[ii] = slot->channel->f_num;
+        lanes->pg_blockmul[ii] = 1 << slot->channel->block;
+        lanes->pg_vib[ii] = slot->reg_vib ? -1 : 0;
+        lanes->pg_mult[ii] = mt[slot->reg_mult];
+        lanes->fb[ii] = slot->channel->fb;
+        lanes->wf[ii] = slot->reg_wf;
+        lanes->mod[ii] = OPL3_LanesValIndex(chip, slot->mod);
+    }
+    for (ii = 0; ii < 18; ii++)
+    {
+        for (jj = 0; jj < 4; jj++)
+        {
+            lanes->ch_out[ii][jj] = OPL3_LanesValIndex(chip, chip->channel[ii].out[jj]);
+        }
+    }
+}
+
+static void OPL3_LanesGather(opl3_chip *chip)
+{
+    opl3_lanes *lanes = &chip->lanes;
+    opl3_slot *slot;
+    uint8_t ii;
+
+    for (ii = 0; ii < 36; ii++)
+    {
+        slot = &chip->slot[ii];
+        lanes->eg_rout[ii] = slot->eg_rout;
+        lanes->eg_gen[ii] = slot->eg_gen;
+        lanes->eg_out[ii] = slot->eg_out;
+        lanes->pg_reset[ii] = slot->pg_reset ? -1 : 0;
+        lanes->pg_phase[ii] = slot->pg_phase;
+        lanes->pg_phase_out[ii] = slot->pg_phase_out;
+        lanes->prout[ii] = slot->prout;
+        lanes->val[ii] = slot->out;
+        lanes->val[OPL_LANE_FBMOD + ii] = slot->fbmod;
+    }
+    lanes->val[OPL_LANE_ZERO] = chip->zeromod;
+    OPL3_LanesGatherRegs(chip);
+}
+
+static void OPL3_LanesScatter(opl3_chip *chip)
+{
+    const opl3_lanes *lanes = &chip->lanes;
+    opl3_slot *slot;
+    uint8_t ii;
+
+    for (ii = 0; ii < 36; ii++)
+    {
+        slot = &chip->slot[ii];
+        slot->eg_rout = (uint16_t)lanes->eg_rout[ii];
+        slot->eg_gen = (uint8_t)lanes->eg_gen[ii];
+        slot->eg_out = (uint16_t)lanes->eg_out[ii];
+        slot->pg_reset = lanes->pg_reset[ii] ? 1 : 0;
+        slot->pg_phase = lanes->pg_phase[ii];
+        slot->pg_phase_out = (uint16_t)lanes->pg_phase_out[ii];
+        slot->prout = lanes->prout[ii];
+        slot->out = lanes->val[ii];
+        slot->fbmod = lanes->val[OPL_LANE_FBMOD + ii];
+    }
+}
+
+static void OPL3_LanesCalcFB(opl3_chip *chip)
+{
+    opl3_lanes *lanes = &chip->lanes;
+    uint8_t ii;
+    int16_t out;
+
+    for (ii = 0; ii < 36; ii++)
+    {
+        out = lanes->val[ii];
+        if (lanes->fb[ii] != 0x00)
+        {
+            lanes->val[OPL_LANE_FBMOD + ii] =
+                (int16_t)((lanes->prout[ii] + out) >> (0x09 - lanes->fb[ii]));
+        }
+        else
+        {
+            lanes->val[OPL_LANE_FBMOD + ii] = 0;
+        }
+        lanes->prout[ii] = out;
+    }
+}
+
+/* Branch-free equivalent of OPL3_EnvelopeCalc over eight slots at a time */
+static void OPL3_LanesEnvelopeCalc(opl3_chip *chip)
+{
+    opl3_lanes *lanes = &chip->lanes;
+    const uint8_t timer = chip->timer & 0x03;
+    const lanes16 zero = L16_SET(0);
+    const lanes16 one = L16_SET(1);
+    const lanes16 three = L16_SET(3);
+    const lanes16 fifteen = L16_SET(15);
+    const lanes16 tremolo = L16_SET(chip->tremolo);
+    const lanes16 eg_add = L16_SET(chip->eg_add);
+    const lanes16 eg_state = L16_SET(chip->eg_state);
+    const lanes16 incstep0 = L16_SET(eg_incstep[0][timer]);
+    const lanes16 incstep1 = L16_SET(eg_incstep[1][timer]);
+    const lanes16 incstep2 = L16_SET(eg_incstep[2][timer]);
+    const lanes16 incstep3 = L16_SET(eg_incstep[3][timer]);
+    lanes16 rout, gen, key, is_att, is_dec, is_rel, reset, reg_rate, rate;
+    lanes16 rate_hi, rate_lo, rate15, eg_shift, shift_lo, shift_hi, shift;
+    lanes16 shift_pos, eg_off, sl_hit, new_rout, not_rout, att_inc;
+    lanes16 att_cond, dsr_cond, inc;
+    uint8_t ii;
+
+    for (ii = 0; ii < OPL_LANES; ii += 8)
+    {
+        rout = L16_LOAD(&lanes->eg_rout[ii]);
+        gen = L16_LOAD(&lanes->eg_gen[ii]);
+        key = L16_LOAD(&lanes->eg_key[ii]);
+
+        L16_STORE(&lanes->eg_out[ii],
+                  L16_ADD(L16_ADD(rout, L16_LOAD(&lanes->eg_base[ii])),
+                          L16_AND(L16_LOAD(&lanes->eg_trem[ii]), tremolo)));
+
+        is_att = L16_EQ(gen, L16_SET(envelope_gen_num_attack));
+        is_dec = L16_EQ(gen, L16_SET(envelope_gen_num_decay));
+        is_rel = L16_EQ(gen, L16_SET(envelope_gen_num_release));
+        reset = L16_AND(key, is_rel);
+        L16_STORE(&lanes->pg_reset[ii], reset);
+
+        reg_rate = L16_OR(L16_OR(L16_AND(is_att, L16_LOAD(&lanes->eg_ar[ii])),
+                                 L16_AND(is_dec, L16_LOAD(&lanes->eg_dr[ii]))),
+                          L16_OR(L16_AND(L16_EQ(gen, L16_SET(envelope_gen_num_sustain)),
+                                         L16_LOAD(&lanes->eg_sr[ii])),
+                                 L16_AND(is_rel, L16_LOAD(&lanes->eg_rr[ii]))));
+        reg_rate = L16_SELECT(reset, L16_LOAD(&lanes->eg_ar[ii]), reg_rate);
+
+        rate = L16_ADD(L16_LOAD(&lanes->eg_ks[ii]), L16_SLL(reg_rate, 2));
+        rate_hi = L16_SRL(rate, 2);
+        rate_lo = L16_AND(rate, three);
+        rate_hi = L16_SELECT(L16_GT(rate_hi, fifteen), fifteen, rate_hi);
+        rate15 = L16_EQ(rate_hi, fifteen);
+        eg_shift = L16_ADD(rate_hi, eg_add);
+
+        /* Rates below 12 step on alternating samples */
+        shift_lo = L16_OR(L16_AND(L16_EQ(eg_shift, L16_SET(12)), one),
+                          L16_OR(L16_AND(L16_EQ(eg_shift, L16_SET(13)),
+                                         L16_AND(L16_SRL(rate_lo, 1), one)),
+                                 L16_AND(L16_EQ(eg_shift, L16_SET(14)),
+                                         L16_AND(rate_lo, one))));
+        if (!chip->eg_state)
+        {
+            shift_lo = zero;
+        }
+
+        /* Higher rates step every sample */
+        shift_hi = L16_ADD(L16_AND(rate_hi, three),
+                           L16_OR(L16_OR(L16_AND(L16_EQ(rate_lo, zero), incstep0),
+                                         L16_AND(L16_EQ(rate_lo, one), incstep1)),
+                                  L16_OR(L16_AND(L16_EQ(rate_lo, L16_SET(2)), incstep2),
+                                         L16_AND(L16_EQ(rate_lo, three), incstep3))));
+        shift_hi = L16_SELECT(L16_GT(shift_hi, three), three, shift_hi);
+        shift_hi = L16_SELECT(L16_EQ(shift_hi, zero), eg_state, shift_hi);
+
+        shift = L16_SELECT(L16_GT(L16_SET(12), rate_hi), shift_lo, shift_hi);
+        shift = L16_ANDNOT(L16_EQ(reg_rate, zero), shift);
+        shift_pos = L16_GT(shift, zero);
+
+        /* Instant attack, and envelope off */
+        new_rout = L16_ANDNOT(L16_AND(reset, rate15), rout);
+        eg_off = L16_EQ(L16_AND(rout, L16_SET(0x1f8)), L16_SET(0x1f8));
+        new_rout = L16_SELECT(L16_ANDNOT(is_att, L16_ANDNOT(reset, eg_off)),
+                              L16_SET(0x1ff), new_rout);
+
+        /* Attack: ~rout >> (4 - shift) */
+        not_rout = L16_XOR(rout, L16_SET(-1));
+        att_inc = L16_SELECT(L16_EQ(shift, one), L16_SRA(not_rout, 3),
+                             L16_SELECT(L16_EQ(shift, L16_SET(2)),
+                                        L16_SRA(not_rout, 2),
+                                        L16_SRA(not_rout, 1)));
+        att_cond = L16_AND(L16_AND(is_att, key),
+                           L16_ANDNOT(L16_EQ(rout, zero),
+                                      L16_ANDNOT(rate15, shift_pos)));
+
+        /* Decay, sustain, and release: 1 << (shift - 1) */
+        sl_hit = L16_EQ(L16_SRL(rout, 4), L16_LOAD(&lanes->eg_sl[ii]));
+        dsr_cond = L16_ANDNOT(L16_OR(L16_OR(is_att, eg_off),
+                                     L16_OR(reset, L16_AND(is_dec, sl_hit))),
+                              shift_pos);
+
+        inc = L16_OR(L16_AND(att_cond, att_inc),
+                     L16_AND(dsr_cond,
+                             L16_SELECT(L16_EQ(shift, three), L16_SET(4), shift)));
+        L16_STORE(&lanes->eg_rout[ii],
+                  L16_AND(L16_ADD(new_rout, inc), L16_SET(0x1ff)));
+
+        gen = L16_SELECT(L16_AND(is_att, L16_EQ(rout, zero)),
+                         L16_SET(envelope_gen_num_decay), gen);
+        gen = L16_SELECT(L16_AND(is_dec, sl_hit),
+                         L16_SET(envelope_gen_num_sustain), gen);
+        gen = L16_ANDNOT(reset, gen);
+        gen = L16_SELECT(L16_EQ(key, zero),
+                         L16_SET(envelope_gen_num_release), gen);
+        L16_STORE(&lanes->eg_gen[ii], gen);
+    }
+}
+
+/* Equivalent of OPL3_PhaseGenerate over four slots at a time, followed by
+   the serial noise and rhythm-mode parts */
+static void OPL3_LanesPhaseGenerate(opl3_chip *chip)
+{
+    opl3_lanes *lanes = &chip->lanes;
+    const uint8_t vibpos = chip->vibpos;
+    const uint8_t vib_on = (vibpos & 3) != 0;
+    const int vib_shift = (vibpos & 1) + chip->vibshift;
+    const lanes32 seven = L32_SET(7);
+    const lanes32 mask16 = L32_SET(0xffff);
+    lanes32 fnum, range, basefreq, phase;
+    uint32_t noise, noise13 = 0, noise16 = 0;
+    uint16_t phase13, phase17;
+    uint8_t rm_xor, n_bit;
+    uint8_t ii;
+
+    for (ii = 0; ii < OPL_LANES; ii += 4)
+    {
+        fnum = L32_LOAD(&lanes->pg_fnum[ii]);
+        if (vib_on)
+        {
+            range = L32_SRLV(L32_AND(L32_SRL(fnum, 7), seven), vib_shift);
+            if (vibpos & 4)
+            {
+                range = L32_SUB(L32_SET(0), range);
+            }
+            fnum = L32_ADD(fnum, L32_AND(range, L32_LOAD(&lanes->pg_vib[ii])));
+        }
+        basefreq = L32_SRL(L32_MUL(fnum, L32_LOAD(&lanes->pg_blockmul[ii])), 1);
+        phase = L32_LOAD(&lanes->pg_phase[ii]);
+        L32_STORE(&lanes->pg_phase_out[ii], L32_AND(L32_SRL(phase, 9), mask16));
+        phase = L32_ANDNOT(L32_LOAD_MASK16(&lanes->pg_reset[ii]), phase);
+        phase = L32_ADD(phase, L32_SRL(L32_MUL(basefreq, L32_LOAD(&lanes->pg_mult[ii])), 1));
+        L32_STORE(&lanes->pg_phase[ii], phase);
+    }
+
+    /* Each slot clocks the noise generator once */
+    noise = chip->noise;
+    for (ii = 0; ii < 36; ii++)
+    {
+        if (ii == 13)
+        {
+            noise13 = noise;
+        }
+        if (ii == 16)
+        {
+            noise16 = noise;
+        }
+        n_bit = ((noise >> 14) ^ noise) & 0x01;
+        noise = (noise >> 1) | (n_bit << 22);
+    }
+    chip->noise = noise;
+
+    /* Rhythm mode, in slot order: hh (13), sd (16), tc (17) */
+    phase13 = (uint16_t)lanes->pg_phase_out[13];
+    chip->rm_hh_bit2 = (phase13 >> 2) & 1;
+    chip->rm_hh_bit3 = (phase13 >> 3) & 1;
+    chip->rm_hh_bit7 = (phase13 >> 7) & 1;
+    chip->rm_hh_bit8 = (phase13 >> 8) & 1;
+    if (chip->rhy & 0x20)
+    {
+        rm_xor = (chip->rm_hh_bit2 ^ chip->rm_hh_bit7)
+               | (chip->rm_hh_bit3 ^ chip->rm_tc_bit5)
+               | (chip->rm_tc_bit3 ^ chip->rm_tc_bit5);
+        lanes->pg_phase_out[13] = rm_xor << 9;
+        if (rm_xor ^ (noise13 & 1))
+        {
+            lanes->pg_phase_out[13] |= 0xd0;
+        }
+        else
+        {
+            lanes->pg_phase_out[13] |= 0x34;
+        }
+
+        lanes->pg_phase_out[16] = (chip->rm_hh_bit8 << 9)
+                                | ((chip->rm_hh_bit8 ^ (noise16 & 1)) << 8);
+
+        phase17 = (uint16_t)lanes->pg_phase_out[17];
+        chip->rm_tc_bit3 = (phase17 >> 3) & 1;
+        chip->rm_tc_bit5 = (phase17 >> 5) & 1;
+        rm_xor = (chip->rm_hh_bit2 ^ chip->rm_hh_bit7)
+               | (chip->rm_hh_bit3 ^ chip->rm_tc_bit5)
+               | (chip->rm_tc_bit3 ^ chip->rm_tc_bit5);
+        lanes->pg_phase_out[17] = (rm_xor << 9) | 0x80;
+    }
+}
+
+static void OPL3_LanesSlotGenerate(opl3_chip *chip, uint8_t first, uint8_t last)
+{
+    opl3_lanes *lanes = &chip->lanes;
+    uint8_t ii;
+
+    for (ii = first; ii < last; ii++)
+    {
+        lanes->val[ii] = envelope_sin[lanes->wf[ii]](
+            (uint16_t)(lanes->pg_phase_out[ii] + lanes->val[lanes->mod[ii]]),
+            (uint16_t)lanes->eg_out[ii]);
+    }
+}
+
+static int32_t OPL3_LanesMix(opl3_chip *chip, uint8_t right)
+{
+    const opl3_lanes *lanes = &chip->lanes;
+    const opl3_channel *channel;
+    const uint8_t *out;
+    int32_t mix = 0;
+    int16_t accm;
+    uint8_t ii;
+
+    for (ii = 0; ii < 18; ii++)
+    {
+        channel = &chip->channel[ii];
+        out = lanes->ch_out[ii];
+        accm = lanes->val[out[0]] + lanes->val[out[1]]
+             + lanes->val[out[2]] + lanes->val[out[3]];
+#if OPL_ENABLE_STEREOEXT
+        mix += (int16_t)((accm * (right ? channel->rightpan : channel->leftpan)) >> 16);
+#else
+        mix += (int16_t)(accm & (right ? channel->chb : channel->cha));
+#endif
+    }
+    return mix;
+}
+
+static void OPL3_GenerateLanes(opl3_chip *chip, int16_t *buf)
+{
+    buf[1] = OPL3_ClipSample(chip->mixbuff[1]);
+
+    OPL3_LanesCalcFB(chip);
+    OPL3_LanesEnvelopeCalc(chip);
+    OPL3_LanesPhaseGenerate(chip);
+
+#if OPL_QUIRK_CHANNELSAMPLEDELAY
+    OPL3_LanesSlotGenerate(chip, 0, 15);
+    chip->mixbuff[0] = OPL3_LanesMix(chip, 0);
+    OPL3_LanesSlotGenerate(chip, 15, 18);
+    buf[0] = OPL3_ClipSample(chip->mixbuff[0]);
+    OPL3_LanesSlotGenerate(chip, 18, 33);
+    chip->mixbuff[1] = OPL3_LanesMix(chip, 1);
+    OPL3_LanesSlotGenerate(chip, 33, 36);
+#else
+    OPL3_LanesSlotGenerate(chip, 0, 36);
+    chip->mixbuff[0] = OPL3_LanesMix(chip, 0);
+    buf[0] = OPL3_ClipSample(chip->mixbuff[0]);
+    chip->mixbuff[1] = OPL3_LanesMix(chip, 1);
+#endif
+
+    OPL3_ClockTimers(chip);
+    if (OPL3_ProcessWriteBuf(chip))
+    {
+        OPL3_LanesGatherRegs(chip);
+    }
+}
+
+void OPL3_GenerateStreamLanes(opl3_chip *chip, int16_t *sndptr, uint32_t numsamples)
+{
+    uint32_t i;
+
+    OPL3_LanesGather(chip);
+    for (i = 0; i < numsamples; i++)
+    {
+        OPL3_Resample(chip, sndptr, OPL3_GenerateLanes);
+        sndptr += 2;
+    }
+    OPL3_LanesScatter(chip);
+}
@@ -104,6 +104,44 @@ struct _opl3_channel {
     uint8_t ch_num;
 };
 
+/*
+    Slot-parallel (SIMD) generator state, see OPL3_GenerateStreamLanes.
+    The 36 slots are padded to a multiple of 8 lanes.
+*/
+#define OPL_LANES 40
+
+typedef struct _opl3_lanes {
+    /* Register-derived state, gathered from the slots after each write */
+    int16_t eg_ar[OPL_LANES];
+    int16_t eg_dr[OPL_LANES];
+    int16_t eg_sr[OPL_LANES]; /* sustain rate: zero for sustained sounds */
+    int16_t eg_rr[OPL_LANES];
+    int16_t eg_sl[OPL_LANES];
+    int16_t eg_ks[OPL_LANES];
+    int16_t eg_base[OPL_LANES]; /* total level plus key scale level */
+    int16_t eg_trem[OPL_LANES]; /* lane mask */
+    int16_t eg_key[OPL_LANES];  /* lane mask */
+    int32_t pg_fnum[OPL_LANES];
+    int32_t pg_blockmul[OPL_LANES];
+    int32_t pg_vib[OPL_LANES];  /* lane mask */
+    int32_t pg_mult[OPL_LANES];
+    uint8_t fb[OPL_LANES];
+    uint8_t wf[OPL_LANES];
+    uint8_t mod[OPL_LANES];     /* index into val */
+    uint8_t ch_out[18][4];      /* index into val */
+
+    /* Dynamic state, scattered back to the slots after each stream */
+    int16_t eg_rout[OPL_LANES];
+    int16_t eg_gen[OPL_LANES];
+    int16_t eg_out[OPL_LANES];
+    int16_t pg_reset[OPL_LANES]; /* lane mask */
+    uint32_t pg_phase[OPL_LANES];
+    uint32_t pg_phase_out[OPL_LANES];
+    int16_t prout[OPL_LANES];
+    /* Slot outputs, followed by their feedback and a zero */
+    int16_t val[OPL_LANES * 2 + 1];
+} opl3_lanes;
+
 typedef struct _opl3_writebuf {
     uint64_t time;
     uint16_t reg;
@@ -151,6 +189,8 @@ struct _opl3_chip {
     uint32_t writebuf_last;
     uint64_t writebuf_lasttime;
     opl3_writebuf writebuf[OPL_WRITEBUF_SIZE];
+
+    opl3_lanes lanes;
 };
 
 void OPL3_Generate(opl3_chip *chip, int16_t *buf);
@@ -159,6 +199,8 @@ void OPL3_Reset(opl3_chip *chip, uint32_t samplerate);
 void OPL3_WriteReg(opl3_chip *chip, uint16_t reg, uint8_t v);
 void OPL3_WriteRegBuffered(opl3_chip *chip, uint16_t reg, uint8_t v);
 void OPL3_GenerateStream(opl3_chip *chip, int16_t *sndptr, uint32_t numsamples);
+/* Bit-exact equivalent of OPL3_GenerateStream, evaluating slots in SIMD lanes */
+void OPL3_GenerateStreamLanes(opl3_chip *chip, int16_t *sndptr, uint32_t numsamples);
 
 #ifdef __cplusplus
 }
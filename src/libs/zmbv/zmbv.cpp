@@ -18,13 +18,16 @@
 
 #include "zmbv.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <utility>
 
 #include "mem_unaligned.h"
+#include "simd.h"
 #include "support.h"
 
 constexpr uint8_t DBZV_VERSION_HIGH = 0;
@@ -46,6 +49,217 @@ constexpr int ZLIB_MEM_LEVEL = 9;                    // 1 to 9 (default 8)
 constexpr auto ZLIB_STRATEGY = Z_FILTERED; // Z_DEFAULT_STRATEGY, Z_FILTERED,
                                            // Z_HUFFMAN_ONLY, Z_RLE, Z_FIXED
 
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2) || defined(SIMD_NEON)
+constexpr bool zmbv_simd_available = true;
+
+// The bytes of each 16 that the motion search compares: the colour bytes of
+// every pixel, or of every fourth pixel when sampling
+template <class P, int step>
+struct MismatchSelect {
+	uint8_t bytes[16] = {};
+	constexpr MismatchSelect()
+	{
+		for (auto i = 0; i < 16; ++i) {
+			const auto pixel = i / static_cast<int>(sizeof(P));
+			const auto alpha = sizeof(P) == 4 && i % 4 == 3;
+			bytes[i] = (pixel % step == 0 && !alpha) ? 0xff : 0x00;
+		}
+	}
+};
+
+template <class P, int step>
+constexpr MismatchSelect<P, step> mismatch_select = {};
+
+// Loading from 32 - n gives a vector whose first n bytes are set
+constexpr uint8_t lane_bytes[64] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff};
+
+#if defined(SIMD_AVX2)
+using zmbv_vec_t = __m256i;
+constexpr int vector_bytes = 32;
+
+static inline zmbv_vec_t load_bytes(const uint8_t *p)
+{
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+static inline zmbv_vec_t load_select(const uint8_t *select)
+{
+	return _mm256_broadcastsi128_si256(
+	        _mm_loadu_si128(reinterpret_cast<const __m128i *>(select)));
+}
+
+// Sets every byte of the pixels that match in the selected bytes
+template <class P>
+static inline zmbv_vec_t same_pixels(const zmbv_vec_t a, const zmbv_vec_t b,
+                                     const zmbv_vec_t select)
+{
+	const auto diff = _mm256_and_si256(_mm256_xor_si256(a, b), select);
+	const auto zero = _mm256_setzero_si256();
+	if constexpr (sizeof(P) == 1)
+		return _mm256_cmpeq_epi8(diff, zero);
+	if constexpr (sizeof(P) == 2)
+		return _mm256_cmpeq_epi16(diff, zero);
+	return _mm256_cmpeq_epi32(diff, zero);
+}
+
+// Adds one to each byte of counts that's set in same
+static inline zmbv_vec_t tally(const zmbv_vec_t counts, const zmbv_vec_t same)
+{
+	return _mm256_sub_epi8(counts, same);
+}
+
+static inline zmbv_vec_t tally(const zmbv_vec_t counts, const zmbv_vec_t same,
+                               const zmbv_vec_t lanes)
+{
+	return _mm256_sub_epi8(counts, _mm256_and_si256(same, lanes));
+}
+
+static inline int sum_bytes(const zmbv_vec_t counts)
+{
+	const auto sums = _mm256_sad_epu8(counts, _mm256_setzero_si256());
+	const auto sum = _mm_add_epi64(_mm256_castsi256_si128(sums),
+	                               _mm256_extracti128_si256(sums, 1));
+	return _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+}
+#elif defined(SIMD_SSE2)
+using zmbv_vec_t = __m128i;
+constexpr int vector_bytes = 16;
+
+static inline zmbv_vec_t load_bytes(const uint8_t *p)
+{
+	return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+static inline zmbv_vec_t load_select(const uint8_t *select)
+{
+	return load_bytes(select);
+}
+
+// Sets every byte of the pixels that match in the selected bytes
+template <class P>
+static inline zmbv_vec_t same_pixels(const zmbv_vec_t a, const zmbv_vec_t b,
+                                     const zmbv_vec_t select)
+{
+	const auto diff = _mm_and_si128(_mm_xor_si128(a, b), select);
+	const auto zero = _mm_setzero_si128();
+	if constexpr (sizeof(P) == 1)
+		return _mm_cmpeq_epi8(diff, zero);
+	if constexpr (sizeof(P) == 2)
+		return _mm_cmpeq_epi16(diff, zero);
+	return _mm_cmpeq_epi32(diff, zero);
+}
+
+// Adds one to each byte of counts that's set in same
+static inline zmbv_vec_t tally(const zmbv_vec_t counts, const zmbv_vec_t same)
+{
+	return _mm_sub_epi8(counts, same);
+}
+
+static inline zmbv_vec_t tally(const zmbv_vec_t counts, const zmbv_vec_t same,
+                               const zmbv_vec_t lanes)
+{
+	return _mm_sub_epi8(counts, _mm_and_si128(same, lanes));
+}
+
+static inline int sum_bytes(const zmbv_vec_t counts)
+{
+	const auto sums = _mm_sad_epu8(counts, _mm_setzero_si128());
+	return _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+}
+#else
+using zmbv_vec_t = uint8x16_t;
+constexpr int vector_bytes = 16;
+
+static inline zmbv_vec_t load_bytes(const uint8_t *p)
+{
+	return vld1q_u8(p);
+}
+
+static inline zmbv_vec_t load_select(const uint8_t *select)
+{
+	return vld1q_u8(select);
+}
+
+// Sets every byte of the pixels that match in the selected bytes
+template <class P>
+static inline zmbv_vec_t same_pixels(const zmbv_vec_t a, const zmbv_vec_t b,
+                                     const zmbv_vec_t select)
+{
+	const auto diff = vandq_u8(veorq_u8(a, b), select);
+	if constexpr (sizeof(P) == 1)
+		return vceqq_u8(diff, vdupq_n_u8(0));
+	if constexpr (sizeof(P) == 2)
+		return vreinterpretq_u8_u16(
+		        vceqq_u16(vreinterpretq_u16_u8(diff), vdupq_n_u16(0)));
+	return vreinterpretq_u8_u32(
+	        vceqq_u32(vreinterpretq_u32_u8(diff), vdupq_n_u32(0)));
+}
+
+// Adds one to each byte of counts that's set in same
+static inline zmbv_vec_t tally(const zmbv_vec_t counts, const zmbv_vec_t same)
+{
+	return vsubq_u8(counts, same);
+}
+
+static inline zmbv_vec_t tally(const zmbv_vec_t counts, const zmbv_vec_t same,
+                               const zmbv_vec_t lanes)
+{
+	return vsubq_u8(counts, vandq_u8(same, lanes));
+}
+
+static inline int sum_bytes(const zmbv_vec_t counts)
+{
+	const auto sums = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(counts)));
+	return static_cast<int>(vgetq_lane_u64(sums, 0) + vgetq_lane_u64(sums, 1));
+}
+#endif
+
+/* Counts the pixels of a block, or of every fourth pixel in every fourth row
+ * when step is 4, that differ between the old and new frames. Like the scalar
+ * loops, 32-bit pixels only compare their low 24 bits. Each row is compared
+ * a vector at a time, with the matching bytes tallied per byte lane. Every
+ * vector of every row adds at most one to a lane, so the lanes can't overflow
+ * for the encoder's 16x16 blocks. Bytes left out by the selection always
+ * match, so the mismatches are whatever bytes remain. */
+static_assert(16 * ((16 * 4 + vector_bytes - 1) / vector_bytes) <= UINT8_MAX,
+              "A 16x16 block of 32-bit pixels overflows the byte lanes");
+
+template <class P, int step>
+static int CountMismatches(const P *pold, const P *pnew, const int pitch,
+                           const int dx, const int dy)
+{
+	const auto rows = (dy + step - 1) / step;
+	const auto row_bytes = dx * static_cast<int>(sizeof(P));
+	assert(rows * ((row_bytes + vector_bytes - 1) / vector_bytes) <= UINT8_MAX);
+	const auto whole_bytes = row_bytes - row_bytes % vector_bytes;
+	const auto select = load_select(mismatch_select<P, step>.bytes);
+	// Only the last vector of a row can run past the block
+	const auto last_lanes = load_bytes(lane_bytes + 32 - (row_bytes - whole_bytes));
+	auto counts = zmbv_vec_t{};
+	for (auto y = 0; y < rows; ++y) {
+		const auto o = reinterpret_cast<const uint8_t *>(pold);
+		const auto n = reinterpret_cast<const uint8_t *>(pnew);
+		auto i = 0;
+		for (; i < whole_bytes; i += vector_bytes)
+			counts = tally(counts, same_pixels<P>(load_bytes(o + i),
+			                                      load_bytes(n + i), select));
+		if (i < row_bytes)
+			counts = tally(counts,
+			               same_pixels<P>(load_bytes(o + i), load_bytes(n + i), select),
+			               last_lanes);
+		pold += pitch * step;
+		pnew += pitch * step;
+	}
+	const auto mismatched_bytes = rows * row_bytes - sum_bytes(counts);
+	return mismatched_bytes / static_cast<int>(sizeof(P));
+}
+#else
+constexpr bool zmbv_simd_available = false;
+#endif
+
 ZMBV_FORMAT BPPFormat(const int bpp)
 {
 	switch (bpp) {
@@ -104,6 +318,7 @@ bool VideoCodec::SetupBuffers(const ZMBV_FORMAT _format, const int blockwidth, c
 		yblocks++;
 	blockcount = static_cast<FrameBlock_offset>(yblocks) * xblocks;
 	blocks.resize(blockcount);
+	matches.resize(blockcount);
 
 	size_t i = 0;
 	for (auto y = 0; y < yblocks; ++y) {
@@ -153,7 +368,10 @@ int VideoCodec::PossibleBlock(const int vx, const int vy, const FrameBlock_it bl
 	int ret = 0;
 	P *pold = reinterpret_cast<P *>(oldframe) + block->start + (vy * pitch) + vx;
 	P *pnew = reinterpret_cast<P *>(newframe) + block->start;
-	;
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2) || defined(SIMD_NEON)
+	if (simd)
+		return CountMismatches<P, 4>(pold, pnew, pitch, block->dx, block->dy);
+#endif
 	for (auto y = 0; y < block->dy; y += 4) {
 		for (auto x = 0; x < block->dx; x += 4) {
 			int test = 0 - ((pold[x] - pnew[x]) & 0x00ffffff);
@@ -171,7 +389,10 @@ int VideoCodec::CompareBlock(const int vx, const int vy, const FrameBlock_it blo
 	int ret = 0;
 	P *pold =  reinterpret_cast<P *>(oldframe) + block->start + (vy * pitch) + vx;
 	P *pnew = reinterpret_cast<P *>(newframe) + block->start;
-	;
+#if defined(SIMD_AVX2) || defined(SIMD_SSE2) || defined(SIMD_NEON)
+	if (simd)
+		return CountMismatches<P, 1>(pold, pnew, pitch, block->dx, block->dy);
+#endif
 	for (auto y = 0; y < block->dy; y++) {
 		for (auto x = 0; x < block->dx; x++) {
 			const int test = 0 - ((pold[x] - pnew[x]) & 0x00ffffff);
@@ -184,20 +405,75 @@ int VideoCodec::CompareBlock(const int vx, const int vy, const FrameBlock_it blo
 }
 
 template <class P>
-void VideoCodec::AddXorBlock(const int vx, const int vy, const FrameBlock_it block)
+void VideoCodec::AddXorBlock(const int vx, const int vy, const FrameBlock_it block, uint32_t offset)
 {
 	P *pold = reinterpret_cast<P *>(oldframe) + block->start + (vy * pitch) + vx;
 	P *pnew = reinterpret_cast<P *>(newframe) + block->start;
 	for (auto y = 0; y < block->dy; ++y) {
 		for (auto x = 0; x < block->dx; ++x) {
-			*reinterpret_cast<P *>(&work[workUsed]) = pnew[x] ^ pold[x];
-			workUsed += sizeof(P);
+			*reinterpret_cast<P *>(&work[offset]) = pnew[x] ^ pold[x];
+			offset += sizeof(P);
 		}
 		pold += pitch;
 		pnew += pitch;
 	}
 }
 
+template <class P>
+VideoCodec::BlockMatch VideoCodec::FindBestMatch(const FrameBlock_it block)
+{
+	BlockMatch best = {};
+	best.change = CompareBlock<P>(0, 0, block);
+	auto possibles = 64;
+	for (auto v = 0; v < VectorCount && possibles; v++) {
+		if (best.change < 4)
+			break;
+		auto vx = VectorTable[v].x;
+		auto vy = VectorTable[v].y;
+		if (PossibleBlock<P>(vx, vy, block) < 4) {
+			possibles--;
+			// if (!possibles) Msg("Ran out of possibles, at %d of %d best%d\n",v,VectorCount,bestchange);
+			auto testchange = CompareBlock<P>(vx, vy, block);
+			if (testchange < best.change) {
+				best.change = testchange;
+				best.vx = check_cast<int8_t>(vx);
+				best.vy = check_cast<int8_t>(vy);
+			}
+		}
+	}
+	return best;
+}
+
+bool VideoCodec::SetSIMD(const bool enabled)
+{
+	simd = enabled && zmbv_simd_available;
+	return simd == enabled;
+}
+
+void VideoCodec::SetParallelFor(parallel_for_f _parallel_for)
+{
+	parallel_for = std::move(_parallel_for);
+}
+
+// Hands out the blocks in runs, one run per job
+void VideoCodec::ForEachBlock(const std::function<void(FrameBlock_offset b)> &job)
+{
+	constexpr FrameBlock_offset blocks_per_job = 32;
+	const auto num_jobs = static_cast<int>((blockcount + blocks_per_job - 1) / blocks_per_job);
+	const auto run = [&](const int j) {
+		const auto first = j * blocks_per_job;
+		const auto last = std::min(first + blocks_per_job, blockcount);
+		for (auto b = first; b < last; ++b)
+			job(b);
+	};
+	if (parallel_for) {
+		parallel_for(num_jobs, run);
+	} else {
+		for (auto j = 0; j < num_jobs; ++j)
+			run(j);
+	}
+}
+
 template <class P>
 void VideoCodec::AddXorFrame()
 {
@@ -206,35 +482,27 @@ void VideoCodec::AddXorFrame()
 	workUsed = (workUsed + blockcount * 2 + 3) & ~3;
 
 	assert(static_cast<size_t>(blockcount) == blocks.size());
+	/* The searches only read the frames, so the blocks are independent */
+	ForEachBlock([this](const FrameBlock_offset b) {
+		matches[b] = FindBestMatch<P>(blocks.begin() + b);
+	});
+
+	/* Lay out the vectors and the xor data of the changed blocks in order */
 	for (FrameBlock_offset b = 0; b < blockcount; ++b) {
-		const auto block = blocks.begin() + b;
-		int8_t bestvx = 0;
-		int8_t bestvy = 0;
-		auto bestchange = CompareBlock<P>(0, 0, block);
-		auto possibles = 64;
-		for (auto v = 0; v < VectorCount && possibles; v++) {
-			if (bestchange < 4)
-				break;
-			auto vx = VectorTable[v].x;
-			auto vy = VectorTable[v].y;
-			if (PossibleBlock<P>(vx, vy, block) < 4) {
-				possibles--;
-				// if (!possibles) Msg("Ran out of possibles, at %d of %d best%d\n",v,VectorCount,bestchange);
-				auto testchange = CompareBlock<P>(vx, vy, block);
-				if (testchange < bestchange) {
-					bestchange = testchange;
-					bestvx = check_cast<int8_t>(vx);
-					bestvy = check_cast<int8_t>(vy);
-				}
-			}
-		}
-		vectors[b * 2 + 0] = static_cast<uint8_t>(left_shift_signed(bestvx, 1));
-		vectors[b * 2 + 1] = static_cast<uint8_t>(left_shift_signed(bestvy, 1));
-		if (bestchange) {
+		auto &match = matches[b];
+		vectors[b * 2 + 0] = static_cast<uint8_t>(left_shift_signed(match.vx, 1));
+		vectors[b * 2 + 1] = static_cast<uint8_t>(left_shift_signed(match.vy, 1));
+		if (match.change) {
 			vectors[b * 2 + 0] |= 1;
-			AddXorBlock<P>(bestvx, bestvy, block);
+			match.xor_offset = workUsed;
+			workUsed += static_cast<uint32_t>(blocks[b].dx * blocks[b].dy) * sizeof(P);
 		}
 	}
+	ForEachBlock([this](const FrameBlock_offset b) {
+		const auto &match = matches[b];
+		if (match.change)
+			AddXorBlock<P>(match.vx, match.vy, blocks.begin() + b, match.xor_offset);
+	});
 }
 
 bool VideoCodec::SetupCompress(const int _width, const int _height)
@@ -260,7 +528,7 @@ bool VideoCodec::SetupDecompress(const int _width, const int _height)
 	return true;
 }
 
-bool VideoCodec::PrepareCompressFrame(int flags, const ZMBV_FORMAT _format, uint8_t *pal, uint8_t *writeBuf, const uint32_t writeSize)
+bool VideoCodec::PrepareCompressFrame(int flags, const ZMBV_FORMAT _format, const uint8_t *pal, uint8_t *writeBuf, const uint32_t writeSize)
 {
 	if (_format != format) {
 		if (!SetupBuffers(_format, 16, 16))
@@ -326,7 +594,7 @@ bool VideoCodec::PrepareCompressFrame(int flags, const ZMBV_FORMAT _format, uint
 	return true;
 }
 
-void VideoCodec::CompressLines(const int lineCount, uint8_t *lineData[])
+void VideoCodec::CompressLines(const int lineCount, const uint8_t *const lineData[])
 {
 	const auto linePitch = pitch * pixelsize;
 	const auto lineWidth = width * pixelsize;
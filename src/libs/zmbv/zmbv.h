@@ -19,6 +19,7 @@
 #ifndef DOSBOX_ZMBV_H
 #define DOSBOX_ZMBV_H
 
+#include <functional>
 #include <vector>
 
 #include <zlib.h>
@@ -46,6 +47,13 @@ private:
 		int dx = 0;
 		int dy = 0;
 	};
+	// The outcome of a block's motion search
+	struct BlockMatch {
+		int8_t vx = 0;
+		int8_t vy = 0;
+		int change = 0;
+		uint32_t xor_offset = 0; // into the work buffer
+	};
 	struct CodecVector {
 		int x = 0;
 		int y = 0;
@@ -81,6 +89,7 @@ private:
 	using FrameBlock_it = std::vector<FrameBlock>::const_iterator;
 	using FrameBlock_offset = std::vector<FrameBlock>::difference_type;
 	FrameBlock_offset blockcount = 0;
+	std::vector<BlockMatch> matches = {};
 	uint32_t workUsed = 0;
 	uint32_t workPos = 0;
 
@@ -95,9 +104,19 @@ private:
 	Compress compress = {};
 	z_stream zstream = {};
 
+public:
+	// Runs job(0) through job(num_jobs - 1), possibly in parallel, and
+	// returns once they've all finished
+	using parallel_for_f = std::function<void(int num_jobs, const std::function<void(int job)> &job)>;
+
+private:
+	parallel_for_f parallel_for = {};
+	bool simd = true;
+
 	// methods
 	void CreateVectorTable();
 	bool SetupBuffers(ZMBV_FORMAT format, int blockwidth, int blockheight);
+	void ForEachBlock(const std::function<void(FrameBlock_offset b)> &job);
 
 	template <class P>
 	void AddXorFrame();
@@ -108,7 +127,9 @@ private:
 	template <class P>
 	int CompareBlock(int vx, int vy, FrameBlock_it block);
 	template <class P>
-	void AddXorBlock(int vx, int vy, FrameBlock_it block);
+	BlockMatch FindBestMatch(FrameBlock_it block);
+	template <class P>
+	void AddXorBlock(int vx, int vy, FrameBlock_it block, uint32_t offset);
 	template <class P>
 	void UnXorBlock(int vx, int vy, FrameBlock_it block);
 	template <class P>
@@ -125,8 +146,16 @@ public:
 	ZMBV_FORMAT BPPFormat(int bpp);
 	int NeededSize(int _width, int _height, ZMBV_FORMAT _format);
 
-	void CompressLines(int lineCount, uint8_t *lineData[]);
-	bool PrepareCompressFrame(int flags, ZMBV_FORMAT _format, uint8_t *pal, uint8_t *writeBuf, uint32_t writeSize);
+	// Spreads the motion search of compressed frames over parallel_for,
+	// which doesn't change the compressed data
+	void SetParallelFor(parallel_for_f _parallel_for);
+
+	// Switches the motion search between its SIMD and scalar block
+	// comparisons, returning false if this build has no SIMD version
+	bool SetSIMD(bool enabled);
+
+	void CompressLines(int lineCount, const uint8_t *const lineData[]);
+	bool PrepareCompressFrame(int flags, ZMBV_FORMAT _format, const uint8_t *pal, uint8_t *writeBuf, uint32_t writeSize);
 	int FinishCompressFrame();
 	void FinishVideo();
 	bool DecompressFrame(uint8_t *framedata, int size);
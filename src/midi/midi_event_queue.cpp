@@ -0,0 +1,102 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "midi_event_queue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "pic.h"
+
+void MidiEventQueue::Reset(const int sample_rate, const uint32_t latency_frames)
+{
+	assert(sample_rate > 0);
+	const std::lock_guard<std::mutex> lock(mutex);
+	events.clear();
+	frames_per_ms = sample_rate / 1000.0;
+	last_played_at = PIC_FullIndex();
+	played_frames = 0;
+	last_event_frame = 0;
+	latency = latency_frames;
+	render_frame = 0;
+}
+
+void MidiEventQueue::AddPlayedFrames(const uint16_t frames)
+{
+	played_frames += frames;
+	last_played_at = PIC_FullIndex();
+}
+
+// The mixer requests frames once per millisecond tick, so events arriving
+// part way through the tick are placed that far into the tick's frames.
+// Events never move ahead of those before them.
+uint64_t MidiEventQueue::GetEventFrame()
+{
+	const auto elapsed_ms = std::clamp(PIC_FullIndex() - last_played_at, 0.0, 1.0);
+	const auto offset = static_cast<uint64_t>(std::lround(elapsed_ms * frames_per_ms));
+	const auto frame = played_frames + offset + latency;
+	last_event_frame = std::max(frame, last_event_frame);
+	return last_event_frame;
+}
+
+void MidiEventQueue::Push(MidiEvent &&event)
+{
+	const std::lock_guard<std::mutex> lock(mutex);
+	events.emplace_back(std::move(event));
+}
+
+void MidiEventQueue::PushMsg(const uint8_t *msg)
+{
+	MidiEvent event = {};
+	event.frame = GetEventFrame();
+	std::copy(msg, msg + event.msg.size(), event.msg.begin());
+	Push(std::move(event));
+}
+
+void MidiEventQueue::PushSysex(const uint8_t *sysex, const size_t len)
+{
+	MidiEvent event = {};
+	event.frame = GetEventFrame();
+	event.sysex.assign(sysex, sysex + len);
+	Push(std::move(event));
+}
+
+bool MidiEventQueue::PopDue(MidiEvent &event)
+{
+	const std::lock_guard<std::mutex> lock(mutex);
+	if (events.empty() || events.front().frame > render_frame)
+		return false;
+	event = std::move(events.front());
+	events.pop_front();
+	return true;
+}
+
+uint16_t MidiEventQueue::FramesUntilNextEvent(const uint16_t max_frames)
+{
+	const std::lock_guard<std::mutex> lock(mutex);
+	if (events.empty())
+		return max_frames;
+	if (events.front().frame <= render_frame)
+		return 0; // it arrived after the due events were applied
+	const auto until_next = events.front().frame - render_frame;
+	return static_cast<uint16_t>(std::min<uint64_t>(until_next, max_frames));
+}
@@ -0,0 +1,111 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#ifndef DOSBOX_MIDI_EVENT_QUEUE_H
+#define DOSBOX_MIDI_EVENT_QUEUE_H
+
+#include "dosbox.h"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+/*
+MidiEventQueue hands timestamped MIDI events from the emulation thread to a
+synthesizer's render thread.
+
+Each event is stamped with the output frame it should sound at: the frames
+the mixer has played so far, plus the emulated time elapsed since the mixer's
+last request, plus a fixed latency that covers how far the render thread can
+run ahead of playback. The render thread applies events once its render
+position reaches their frame, and splits its render calls at those frames, so
+events land on the exact frame instead of on a buffer boundary, and only the
+render thread touches the synth.
+
+Emulation thread:
+  queue.Reset(sample_rate, latency_frames); // before rendering starts
+  queue.AddPlayedFrames(frames);            // in the mixer callback
+  queue.PushMsg(msg) or queue.PushSysex(data, len);
+
+Render thread:
+  while (frames_done < buffer_frames) {
+    const auto n = queue.ApplyDueEvents(buffer_frames - frames_done, apply);
+    render(n);
+    frames_done += n;
+  }
+*/
+
+struct MidiEvent {
+	uint64_t frame = 0; // output frame at which the event takes effect
+	std::array<uint8_t, 3> msg = {};
+	std::vector<uint8_t> sysex = {}; // used instead of msg, if populated
+};
+
+class MidiEventQueue {
+public:
+	void Reset(int sample_rate, uint32_t latency_frames);
+
+	// Emulation thread
+	void AddPlayedFrames(uint16_t frames);
+	void PushMsg(const uint8_t *msg);
+	void PushSysex(const uint8_t *sysex, size_t len);
+
+	// Render thread: calls apply(const MidiEvent &) for the events due at
+	// the render position, then returns how many frames to render before
+	// the next event (at most max_frames) and advances past them.
+	template <typename Apply>
+	uint16_t ApplyDueEvents(uint16_t max_frames, Apply apply);
+
+private:
+	uint64_t GetEventFrame();
+	void Push(MidiEvent &&event);
+	bool PopDue(MidiEvent &event);
+	uint16_t FramesUntilNextEvent(uint16_t max_frames);
+
+	std::deque<MidiEvent> events = {};
+	std::mutex mutex = {};
+
+	// Emulation thread
+	double frames_per_ms = 0.0;
+	double last_played_at = 0.0; // emulated time of the mixer's last request
+	uint64_t played_frames = 0;
+	uint64_t last_event_frame = 0;
+	uint32_t latency = 0;
+
+	// Render thread
+	uint64_t render_frame = 0;
+};
+
+template <typename Apply>
+uint16_t MidiEventQueue::ApplyDueEvents(const uint16_t max_frames, Apply apply)
+{
+	MidiEvent event = {};
+	while (PopDue(event))
+		apply(event);
+
+	const auto frames = FramesUntilNextEvent(max_frames);
+	render_frame += frames;
+	return frames;
+}
+
+#endif
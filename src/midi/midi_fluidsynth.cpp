@@ -205,7 +205,8 @@ static std::string find_sf_file(const std::string &name)
 }
 
 MidiHandlerFluidsynth::MidiHandlerFluidsynth()
-        : soft_limiter("FSYNTH"),
+        : buffers(num_buffers, std::vector<int16_t>(FRAMES_PER_BUFFER * 2)),
+          soft_limiter("FSYNTH"),
           keep_rendering(false)
 {}
 
@@ -229,6 +230,10 @@ bool MidiHandlerFluidsynth::Open([[maybe_unused]] const char *conf)
 	                                       this, std::placeholders::_1);
 	mixer_channel->RegisterLevelCallBack(set_mixer_level);
 
+	mixer_channel->RegisterQueueDepthCallBack([this] {
+		return MixerChannel::QueueDepth{buffers.Size(), buffers.MaxCapacity()};
+	});
+
 	// Detailed explanation of all available FluidSynth settings:
 	// http://www.fluidsynth.org/api/fluidsettings.xml
 
@@ -400,12 +405,15 @@ bool MidiHandlerFluidsynth::Open([[maybe_unused]] const char *conf)
 	channel = std::move(mixer_channel);
 	selected_font = soundfont;
 
-	// Start rendering audio
+	// Start rendering audio. Events are scheduled one ring's worth of
+	// frames ahead, which is as far as the renderer can be ahead of playback.
 	keep_rendering = true;
+	buffers.Reset();
+	events.Reset(channel->GetSampleRate(), (num_buffers + 1) * FRAMES_PER_BUFFER);
 	const auto render = std::bind(&MidiHandlerFluidsynth::Render, this);
 	renderer = std::thread(render);
 	set_thread_name(renderer, "dosbox:fsynth");
-	play_buffer = playable.Dequeue(); // populate the first play buffer
+	play_buffer = buffers.BeginRead(); // wait for the first play buffer
 
 	// Start playback
 	channel->Enable(true);
@@ -427,12 +435,10 @@ void MidiHandlerFluidsynth::Close()
 	if (channel)
 		channel->Enable(false);
 
-	// Stop rendering and drain the rings
+	// Stop rendering and release the renderer if it's waiting on the ring
 	keep_rendering = false;
-	if (!backstock.Size())
-		backstock.Enqueue(std::move(play_buffer));
-	while (playable.Size())
-		play_buffer = playable.Dequeue();
+	buffers.Stop();
+	play_buffer = nullptr;
 
 	// Wait for the rendering thread to finish
 	if (renderer.joinable())
@@ -453,6 +459,25 @@ void MidiHandlerFluidsynth::Close()
 
 void MidiHandlerFluidsynth::PlayMsg(const uint8_t *msg)
 {
+	events.PushMsg(msg);
+}
+
+void MidiHandlerFluidsynth::PlaySysex(uint8_t *sysex, size_t len)
+{
+	events.PushSysex(sysex, len);
+}
+
+// Called by the render thread once it reaches the event's frame
+void MidiHandlerFluidsynth::ApplyEvent(const MidiEvent &event)
+{
+	if (!event.sysex.empty()) {
+		const auto data = reinterpret_cast<const char *>(event.sysex.data());
+		const auto n = static_cast<int>(event.sysex.size());
+		fluid_synth_sysex(synth.get(), data, n, nullptr, nullptr, nullptr, false);
+		return;
+	}
+
+	const auto msg = event.msg.data();
 	const int chanID = msg[0] & 0b1111;
 
 	switch (msg[0] & 0b1111'0000) {
@@ -477,31 +502,27 @@ void MidiHandlerFluidsynth::PlayMsg(const uint8_t *msg)
 	case 0b1110'0000:
 		fluid_synth_pitch_bend(synth.get(), chanID, msg[1] + (msg[2] << 7));
 		break;
-	default: {
-		uint64_t tmp;
-		memcpy(&tmp, msg, sizeof(tmp));
-		LOG_MSG("MIDI: unknown MIDI command: %0" PRIx64, tmp);
+	default:
+		LOG_MSG("MIDI: unknown MIDI command: %02x %02x %02x", msg[0],
+		        msg[1], msg[2]);
 		break;
 	}
-	}
-}
-
-void MidiHandlerFluidsynth::PlaySysex(uint8_t *sysex, size_t len)
-{
-	const char *data = reinterpret_cast<const char *>(sysex);
-	const auto n = static_cast<int>(len);
-	fluid_synth_sysex(synth.get(), data, n, nullptr, nullptr, nullptr, false);
 }
 
 void MidiHandlerFluidsynth::MixerCallBack(uint16_t requested_frames)
 {
+	events.AddPlayedFrames(requested_frames);
 	while (requested_frames) {
 		const auto frames_to_be_played = std::min(GetRemainingFrames(),
 		                                          requested_frames);
-		const auto sample_offset_in_buffer = play_buffer.data() +
+		if (!play_buffer) {
+			channel->AddSilence();
+			return;
+		}
+		const auto sample_offset_in_buffer = play_buffer->data() +
 		                                     last_played_frame * 2;
 
-		assert(frames_to_be_played <= play_buffer.size());
+		assert(frames_to_be_played <= play_buffer->size());
 		channel->AddSamples_s16(frames_to_be_played, sample_offset_in_buffer);
 
 		requested_frames -= frames_to_be_played;
@@ -513,42 +534,48 @@ void MidiHandlerFluidsynth::MixerCallBack(uint16_t requested_frames)
 uint16_t MidiHandlerFluidsynth::GetRemainingFrames()
 {
 	// If the current buffer has some frames left, then return those ...
-	if (last_played_frame < FRAMES_PER_BUFFER)
+	if (play_buffer && last_played_frame < FRAMES_PER_BUFFER)
 		return FRAMES_PER_BUFFER - last_played_frame;
 
-	// Otherwise put the spent buffer in backstock and get the next buffer
-	backstock.Enqueue(std::move(play_buffer));
-	play_buffer = playable.Dequeue();
+	// Otherwise hand the spent buffer back and wait for the next one
+	if (play_buffer)
+		buffers.EndRead();
+	play_buffer = buffers.BeginRead();
 	last_played_frame = 0; // reset the frame counter to the beginning
 
 	return FRAMES_PER_BUFFER;
 }
 
-// Populates the playable queue with freshly rendered buffers
+// Keeps the ring populated with freshly rendered buffers
 void MidiHandlerFluidsynth::Render()
 {
-	// Allocate our buffers once and reuse for the duration.
+	// Allocate our render buffer once and reuse for the duration.
 	constexpr auto SAMPLES_PER_BUFFER = FRAMES_PER_BUFFER * 2; // L & R
 	std::vector<float> render_buffer(SAMPLES_PER_BUFFER);
-	std::vector<int16_t> playable_buffer(SAMPLES_PER_BUFFER);
 
-	// Populate the backstock using copies of the current buffer.
-	while (backstock.Size() < backstock.MaxCapacity() - 1)
-		backstock.Enqueue(playable_buffer);
-	backstock.Enqueue(std::move(playable_buffer));
-	assert(backstock.Size() == backstock.MaxCapacity());
+	const auto apply_event = [this](const MidiEvent &event) {
+		ApplyEvent(event);
+	};
 
 	while (keep_rendering.load()) {
-		fluid_synth_write_float(synth.get(), FRAMES_PER_BUFFER,
-		                        render_buffer.data(), 0, 2,
-		                        render_buffer.data(), 1, 2);
+		// Split the render where events are due
+		uint16_t frames_done = 0;
+		while (frames_done < FRAMES_PER_BUFFER) {
+			const auto frames = events.ApplyDueEvents(
+			        FRAMES_PER_BUFFER - frames_done, apply_event);
+			const auto out = render_buffer.data() + frames_done * 2;
+			fluid_synth_write_float(synth.get(), frames, out, 0, 2, out, 1, 2);
+			frames_done += frames;
+		}
 
-		// Grab the next buffer from backstock and populate it ...
-		playable_buffer = backstock.Dequeue();
+		// Wait for a free buffer in the ring and populate it in-place ...
+		const auto playable_buffer = buffers.BeginWrite();
+		if (!playable_buffer)
+			break;
 		soft_limiter.Process(render_buffer, FRAMES_PER_BUFFER,
-		                     playable_buffer);
-		// and then move it into the playable queue
-		playable.Enqueue(std::move(playable_buffer));
+		                     *playable_buffer);
+		// and then publish it to the mixer
+		buffers.EndWrite();
 	}
 }
 
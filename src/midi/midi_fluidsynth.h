@@ -33,8 +33,9 @@
 #include <fluidsynth.h>
 #include <thread>
 
+#include "midi_event_queue.h"
 #include "mixer.h"
-#include "rwqueue.h"
+#include "rwring.h"
 #include "soft_limiter.h"
 
 class MidiHandlerFluidsynth final : public MidiHandler {
@@ -50,6 +51,7 @@ public:
 	MIDI_RC ListAll(Program *caller) override;
 
 private:
+	void ApplyEvent(const MidiEvent &event);
 	void MixerCallBack(uint16_t requested_frames);
 	void SetMixerLevel(const AudioFrame &levels) noexcept;
 	uint16_t GetRemainingFrames();
@@ -64,14 +66,14 @@ private:
 	mixer_channel_t channel = nullptr;
 	std::string selected_font = "";
 
-	std::vector<int16_t> play_buffer = {};
 	static constexpr auto num_buffers = 8;
-	RWQueue<std::vector<int16_t>> playable{num_buffers};
-	RWQueue<std::vector<int16_t>> backstock{num_buffers};
+	RWRing<std::vector<int16_t>> buffers;
+	const std::vector<int16_t> *play_buffer = nullptr;
 
 	std::thread renderer = {};
 	SoftLimiter soft_limiter;
 
+	MidiEventQueue events = {};
 	uint16_t last_played_frame = 0; // relative frame-offset in the play buffer
 	std::atomic_bool keep_rendering = {};
 	bool is_open = false;
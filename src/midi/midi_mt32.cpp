@@ -31,8 +31,6 @@
 #include <set>
 #include <string>
 
-#include <SDL_endian.h>
-
 #include "control.h"
 #include "cross.h"
 #include "fs_utils.h"
@@ -364,7 +362,8 @@ static mt32emu_report_handler_i get_report_handler_interface()
 }
 
 MidiHandler_mt32::MidiHandler_mt32()
-        : soft_limiter("MT32"),
+        : buffers(num_buffers, std::vector<int16_t>(FRAMES_PER_BUFFER * 2)),
+          soft_limiter("MT32"),
           keep_rendering(false)
 {}
 
@@ -538,6 +537,10 @@ bool MidiHandler_mt32::Open([[maybe_unused]] const char *conf)
 	                                       this, std::placeholders::_1);
 	mixer_channel->RegisterLevelCallBack(set_mixer_level);
 
+	mixer_channel->RegisterQueueDepthCallBack([this] {
+		return MixerChannel::QueueDepth{buffers.Size(), buffers.MaxCapacity()};
+	});
+
 	const auto sample_rate = mixer_channel->GetSampleRate();
 
 	mt32_service->setAnalogOutputMode(ANALOG_MODE);
@@ -557,12 +560,15 @@ bool MidiHandler_mt32::Open([[maybe_unused]] const char *conf)
 	service = std::move(mt32_service);
 	channel = std::move(mixer_channel);
 
-	// Start rendering audio
+	// Start rendering audio. Events are scheduled one ring's worth of
+	// frames ahead, which is as far as the renderer can be ahead of playback.
 	keep_rendering = true;
+	buffers.Reset();
+	events.Reset(sample_rate, (num_buffers + 1) * FRAMES_PER_BUFFER);
 	const auto render = std::bind(&MidiHandler_mt32::Render, this);
 	renderer = std::thread(render);
 	set_thread_name(renderer, "dosbox:mt32");
-	play_buffer = playable.Dequeue(); // populate the first play buffer
+	play_buffer = buffers.BeginRead(); // wait for the first play buffer
 
 	// Start playback
 	channel->Enable(true);
@@ -609,12 +615,10 @@ void MidiHandler_mt32::Close()
 	if (channel)
 		channel->Enable(false);
 
-	// Stop rendering and drain the rings
+	// Stop rendering and release the renderer if it's waiting on the ring
 	keep_rendering = false;
-	if (!backstock.Size())
-		backstock.Enqueue(std::move(play_buffer));
-	while (playable.Size())
-		play_buffer = playable.Dequeue();
+	buffers.Stop();
+	play_buffer = nullptr;
 
 	// Wait for the rendering thread to finish
 	if (renderer.joinable())
@@ -632,42 +636,35 @@ void MidiHandler_mt32::Close()
 	channel.reset();
 	service.reset();
 	soft_limiter.Reset();
-	total_buffers_played = 0;
 	last_played_frame = 0;
 
 	is_open = false;
 }
 
-uint32_t MidiHandler_mt32::GetMidiEventTimestamp() const
-{
-	const uint32_t played_frames = total_buffers_played * FRAMES_PER_BUFFER;
-	return service->convertOutputToSynthTimestamp(played_frames +
-	                                              last_played_frame);
-}
-
 void MidiHandler_mt32::PlayMsg(const uint8_t *msg)
 {
-	const auto msg_words = reinterpret_cast<const uint32_t *>(msg);
-	const std::lock_guard<std::mutex> lock(service_mutex);
-	service->playMsgAt(SDL_SwapLE32(*msg_words), GetMidiEventTimestamp());
+	events.PushMsg(msg);
 }
 
 void MidiHandler_mt32::PlaySysex(uint8_t *sysex, size_t len)
 {
 	assert(len <= UINT32_MAX);
-	const auto msg_len = static_cast<uint32_t>(len);
-	const std::lock_guard<std::mutex> lock(service_mutex);
-	service->playSysexAt(sysex, msg_len, GetMidiEventTimestamp());
+	events.PushSysex(sysex, len);
 }
 
 // The callback operates at the frame-level, steadily adding samples to the
 // mixer until the requested numbers of frames is met.
 void MidiHandler_mt32::MixerCallBack(uint16_t requested_frames)
 {
+	events.AddPlayedFrames(requested_frames);
 	while (requested_frames) {
 		const auto frames_to_be_played = std::min(GetRemainingFrames(),
 		                                          requested_frames);
-		const auto sample_offset_in_buffer = play_buffer.data() +
+		if (!play_buffer) {
+			channel->AddSilence();
+			return;
+		}
+		const auto sample_offset_in_buffer = play_buffer->data() +
 		                                     last_played_frame * 2;
 		channel->AddSamples_s16(frames_to_be_played, sample_offset_in_buffer);
 		requested_frames -= frames_to_be_played;
@@ -679,43 +676,53 @@ void MidiHandler_mt32::MixerCallBack(uint16_t requested_frames)
 uint16_t MidiHandler_mt32::GetRemainingFrames()
 {
 	// If the current buffer has some frames left, then return those ...
-	if (last_played_frame < FRAMES_PER_BUFFER)
+	if (play_buffer && last_played_frame < FRAMES_PER_BUFFER)
 		return FRAMES_PER_BUFFER - last_played_frame;
 
-	// Otherwise put the spent buffer in backstock and get the next buffer
-	backstock.Enqueue(std::move(play_buffer));
-	play_buffer = playable.Dequeue();
-	total_buffers_played++;
+	// Otherwise hand the spent buffer back and wait for the next one
+	if (play_buffer)
+		buffers.EndRead();
+	play_buffer = buffers.BeginRead();
 	last_played_frame = 0; // reset the frame counter to the beginning
 
 	return FRAMES_PER_BUFFER;
 }
 
-// Keep the playable queue populated with freshly rendered buffers
+// Keep the ring populated with freshly rendered buffers
 void MidiHandler_mt32::Render()
 {
-	// Allocate our buffers once and reuse for the duration.
+	// Allocate our render buffer once and reuse for the duration.
 	constexpr auto SAMPLES_PER_BUFFER = FRAMES_PER_BUFFER * 2; // L & R
 	std::vector<float> render_buffer(SAMPLES_PER_BUFFER);
-	std::vector<int16_t> playable_buffer(SAMPLES_PER_BUFFER);
 
-	// Populate the backstock using copies of the current buffer.
-	while (backstock.Size() < backstock.MaxCapacity() - 1)
-		backstock.Enqueue(playable_buffer);
-	backstock.Enqueue(std::move(playable_buffer));
-	assert(backstock.Size() == backstock.MaxCapacity());
+	// Events are played as the render position reaches them
+	const auto apply_event = [this](const MidiEvent &event) {
+		if (event.sysex.empty()) {
+			const auto &m = event.msg;
+			service->playMsg(static_cast<uint32_t>(m[0] | m[1] << 8 | m[2] << 16));
+		} else {
+			service->playSysex(event.sysex.data(),
+			                   static_cast<uint32_t>(event.sysex.size()));
+		}
+	};
 
 	while (keep_rendering.load()) {
-		{
+		uint16_t frames_done = 0;
+		while (frames_done < FRAMES_PER_BUFFER) {
 			const std::lock_guard<std::mutex> lock(service_mutex);
-			service->renderFloat(render_buffer.data(), FRAMES_PER_BUFFER);
+			const auto frames = events.ApplyDueEvents(
+			        FRAMES_PER_BUFFER - frames_done, apply_event);
+			service->renderFloat(render_buffer.data() + frames_done * 2, frames);
+			frames_done += frames;
 		}
-		// Grab the next buffer from backstock and populate it ...
-		playable_buffer = backstock.Dequeue();
-		soft_limiter.Process(render_buffer, FRAMES_PER_BUFFER, playable_buffer);
-
-		// and then move it into the playable queue
-		playable.Enqueue(std::move(playable_buffer));
+		// Wait for a free buffer in the ring and populate it in-place ...
+		const auto playable_buffer = buffers.BeginWrite();
+		if (!playable_buffer)
+			break;
+		soft_limiter.Process(render_buffer, FRAMES_PER_BUFFER, *playable_buffer);
+
+		// and then publish it to the mixer
+		buffers.EndWrite();
 	}
 }
 
@@ -35,8 +35,9 @@
 #define MT32EMU_API_TYPE 3
 #include <mt32emu/mt32emu.h>
 
+#include "midi_event_queue.h"
 #include "mixer.h"
-#include "rwqueue.h"
+#include "rwring.h"
 #include "soft_limiter.h"
 
 static_assert(MT32EMU_VERSION_MAJOR > 2 ||
@@ -58,7 +59,6 @@ public:
 	void PrintStats();
 
 private:
-	uint32_t GetMidiEventTimestamp() const;
 	service_t GetService();
 	void MixerCallBack(uint16_t len);
 	void SetMixerLevel(const AudioFrame &desired) noexcept;
@@ -68,20 +68,16 @@ private:
 	// Managed objects
 	mixer_channel_t channel = nullptr;
 
-	std::vector<int16_t> play_buffer = {};
 	static constexpr auto num_buffers = 4;
-	RWQueue<std::vector<int16_t>> playable{num_buffers};
-	RWQueue<std::vector<int16_t>> backstock{num_buffers};
+	RWRing<std::vector<int16_t>> buffers;
+	const std::vector<int16_t> *play_buffer = nullptr;
 
 	std::mutex service_mutex = {};
 	service_t service = {};
 	std::thread renderer = {};
 	SoftLimiter soft_limiter;
 
-	// The following two members let us determine the total number of played
-	// frames, which is used by GetMidiEventTimestamp() to calculate a total
-	// time offset.
-	uint32_t total_buffers_played = 0;
+	MidiEventQueue events = {};
 	uint16_t last_played_frame = 0; // relative frame-offset in the play buffer
 
 	std::atomic_bool keep_rendering = {};
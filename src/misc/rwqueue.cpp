@@ -96,4 +96,4 @@ T RWQueue<T>::Dequeue()
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 #include <vector>
 template class RWQueue<int>; // Unit tests
-template class RWQueue<std::vector<int16_t>>; // MT-32 and FluidSynth
+template class RWQueue<std::vector<int16_t>>; // OPL
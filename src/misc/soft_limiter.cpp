@@ -25,6 +25,7 @@
 #include <cmath>
 #include <limits>
 
+#include "simd.h"
 #include "support.h"
 
 constexpr static auto relaxed = std::memory_order_relaxed;
@@ -47,6 +48,100 @@ void SoftLimiter::UpdateLevels(const AudioFrame &desired_levels,
 	            desired_levels.right * desired_multiplier};
 }
 
+// Returns the largest absolute left and right values in the interleaved
+// sequence.
+static AudioFrame find_abs_peaks(const float *in, const int frames) noexcept
+{
+	const int samples = frames * 2;
+	int i = 0;
+	AudioFrame peaks = {0, 0};
+
+#if defined(SIMD_AVX2)
+	const auto abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+	auto maxes = _mm256_setzero_ps();
+	for (; i + 8 <= samples; i += 8)
+		maxes = _mm256_max_ps(maxes,
+		                      _mm256_and_ps(_mm256_loadu_ps(in + i), abs_mask));
+	alignas(32) float lanes[8];
+	_mm256_store_ps(lanes, maxes);
+	for (int lane = 0; lane < 8; lane += 2) {
+		peaks.left = std::max(peaks.left, lanes[lane]);
+		peaks.right = std::max(peaks.right, lanes[lane + 1]);
+	}
+#elif defined(SIMD_SSE2)
+	const auto abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	auto maxes = _mm_setzero_ps();
+	for (; i + 4 <= samples; i += 4)
+		maxes = _mm_max_ps(maxes, _mm_and_ps(_mm_loadu_ps(in + i), abs_mask));
+	alignas(16) float lanes[4];
+	_mm_store_ps(lanes, maxes);
+	peaks = {std::max(lanes[0], lanes[2]), std::max(lanes[1], lanes[3])};
+#elif defined(SIMD_NEON)
+	auto maxes = vdupq_n_f32(0);
+	for (; i + 4 <= samples; i += 4)
+		maxes = vmaxq_f32(maxes, vabsq_f32(vld1q_f32(in + i)));
+	float lanes[4];
+	vst1q_f32(lanes, maxes);
+	peaks = {std::max(lanes[0], lanes[2]), std::max(lanes[1], lanes[3])};
+#endif
+	for (; i < samples; i += 2) {
+		peaks.left = std::max(peaks.left, fabsf(in[i]));
+		peaks.right = std::max(peaks.right, fabsf(in[i + 1]));
+	}
+	return peaks;
+}
+
+// Scales the interleaved sequence by the left and right scalars, truncating
+// the results into the output array.
+static void scale_interleaved(const float *in,
+                              const int frames,
+                              const AudioFrame scalars,
+                              int16_t *out) noexcept
+{
+	const int samples = frames * 2;
+	int i = 0;
+
+#if defined(SIMD_AVX2)
+	const auto lr = _mm256_setr_ps(scalars.left, scalars.right,
+	                               scalars.left, scalars.right,
+	                               scalars.left, scalars.right,
+	                               scalars.left, scalars.right);
+	for (; i + 16 <= samples; i += 16) {
+		const auto lo = _mm256_cvttps_epi32(
+		        _mm256_mul_ps(_mm256_loadu_ps(in + i), lr));
+		const auto hi = _mm256_cvttps_epi32(
+		        _mm256_mul_ps(_mm256_loadu_ps(in + i + 8), lr));
+		// The pack works per 128-bit lane, so restore the sample order
+		const auto packed = _mm256_permute4x64_epi64(
+		        _mm256_packs_epi32(lo, hi), 0xd8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+	}
+#elif defined(SIMD_SSE2)
+	const auto lr = _mm_setr_ps(scalars.left, scalars.right, scalars.left,
+	                            scalars.right);
+	for (; i + 8 <= samples; i += 8) {
+		const auto lo = _mm_cvttps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i), lr));
+		const auto hi = _mm_cvttps_epi32(
+		        _mm_mul_ps(_mm_loadu_ps(in + i + 4), lr));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+		                 _mm_packs_epi32(lo, hi));
+	}
+#elif defined(SIMD_NEON)
+	const float lr_array[4] = {scalars.left, scalars.right, scalars.left,
+	                           scalars.right};
+	const auto lr = vld1q_f32(lr_array);
+	for (; i + 8 <= samples; i += 8) {
+		const auto lo = vcvtq_s32_f32(vmulq_f32(vld1q_f32(in + i), lr));
+		const auto hi = vcvtq_s32_f32(vmulq_f32(vld1q_f32(in + i + 4), lr));
+		vst1q_s16(out + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+	}
+#endif
+	for (; i < samples; i += 2) {
+		out[i] = static_cast<int16_t>(in[i] * scalars.left);
+		out[i + 1] = static_cast<int16_t>(in[i + 1] * scalars.right);
+	}
+}
+
 //  Limit the input array and returned as integer array
 void SoftLimiter::Process(const std::vector<float> &in,
                           const uint16_t frames,
@@ -61,6 +156,23 @@ void SoftLimiter::Process(const std::vector<float> &in,
 	assert(in.size() >= samples);
 	assert(out.size() >= samples);
 
+	// Fast path: a sequence that stays inbounds can't start a new peak, so
+	// we can skip the zero-crossing analysis and scale it in one pass.
+	const auto scalars = prescale.load(relaxed);
+	if (scalars.left >= 0 && scalars.right >= 0) {
+		const auto abs_peaks = find_abs_peaks(in.data(), frames);
+		const AudioFrame peaks = {abs_peaks.left * scalars.left,
+		                          abs_peaks.right * scalars.right};
+		if (peaks.left <= bounds && peaks.right <= bounds) {
+			global_peaks.left = std::max(global_peaks.left, peaks.left);
+			global_peaks.right = std::max(global_peaks.right, peaks.right);
+			ScaleWithoutNewPeaks(in, frames, scalars, out);
+			SaveTailFrame(frames, out);
+			Release();
+			return;
+		}
+	}
+
 	auto precross_peak_pos_left = in.end();
 	auto precross_peak_pos_right = in.end();
 	auto zero_cross_left = in.end();
@@ -69,15 +181,24 @@ void SoftLimiter::Process(const std::vector<float> &in,
 	FindPeaksAndZeroCrosses(in, precross_peak_pos_left, precross_peak_pos_right,
 	                        zero_cross_left, zero_cross_right, samples);
 
+	// Without a new peak in either channel, the whole sequence is scaled
+	if (precross_peak_pos_left == in.end() &&
+	    precross_peak_pos_right == in.end()) {
+		ScaleWithoutNewPeaks(in, frames, scalars, out);
+		SaveTailFrame(frames, out);
+		Release();
+		return;
+	}
+
 	// Given the local peaks found in each side channel, scale or copy the
 	// input array into the output array
 	constexpr int8_t left = 0;
-	ScaleOrCopy<left>(in, samples, prescale.load(relaxed).left,
+	ScaleOrCopy<left>(in, samples, scalars.left,
 	                  precross_peak_pos_left, zero_cross_left,
 	                  global_peaks.left, tail_frame.left, out);
 
 	constexpr int8_t right = 1;
-	ScaleOrCopy<right>(in, samples, prescale.load(relaxed).right,
+	ScaleOrCopy<right>(in, samples, scalars.right,
 	                   precross_peak_pos_right, zero_cross_right,
 	                   global_peaks.right, tail_frame.right, out);
 
@@ -207,6 +328,27 @@ void SoftLimiter::ScaleOrCopy(const std::vector<float> &in,
 	}
 }
 
+// Scale both channels of a sequence that holds no new peaks, either by their
+// prescalar or, if still releasing a prior peak, as a ratio of that peak.
+void SoftLimiter::ScaleWithoutNewPeaks(const std::vector<float> &in,
+                                       const uint16_t frames,
+                                       const AudioFrame &prescalars,
+                                       std::vector<int16_t> &out) noexcept
+{
+	auto get_scalar = [this](const float prescalar, const float global_peak) {
+		if (global_peak > bounds) {
+			limited_tally++;
+			return prescalar * bounds / global_peak;
+		}
+		++non_limited_tally;
+		return prescalar;
+	};
+	const AudioFrame scalars = {get_scalar(prescalars.left, global_peaks.left),
+	                            get_scalar(prescalars.right,
+	                                       global_peaks.right)};
+	scale_interleaved(in.data(), frames, scalars, out.data());
+}
+
 // Apply the polynomial coefficients to the sequence
 void SoftLimiter::PolyFit(in_iterator_t in_pos,
                           const in_iterator_t in_end,
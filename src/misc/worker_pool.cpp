@@ -0,0 +1,112 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "worker_pool.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "support.h"
+
+WorkerPool::WorkerPool(const int num_threads, const char *thread_name)
+{
+	assert(num_threads > 0);
+	for (int i = 1; i < num_threads; ++i) {
+		workers.emplace_back(&WorkerPool::Work, this);
+		set_thread_name(workers.back(), thread_name);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		should_quit = true;
+	}
+	has_jobs.notify_all();
+	for (auto &worker : workers)
+		worker.join();
+}
+
+int WorkerPool::DefaultNumThreads(const int max_threads)
+{
+	const auto host_threads = static_cast<int>(std::thread::hardware_concurrency());
+	return std::clamp(host_threads, 1, std::max(max_threads, 1));
+}
+
+void WorkerPool::Run(const int jobs, const job_f &job)
+{
+	if (jobs <= 0)
+		return;
+	if (workers.empty() || jobs == 1) {
+		for (int i = 0; i < jobs; ++i)
+			job(i);
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		assert(!current_job);
+		current_job = &job;
+		num_jobs = jobs;
+		next_job = 0;
+		unfinished_jobs = jobs;
+		++batch;
+	}
+	has_jobs.notify_all();
+
+	RunJobs();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	jobs_done.wait(lock, [this] { return unfinished_jobs == 0; });
+	current_job = nullptr;
+}
+
+// Takes jobs from the current batch until none are left
+void WorkerPool::RunJobs()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (next_job < num_jobs) {
+		const auto job_num = next_job++;
+		const auto &job = *current_job;
+		lock.unlock();
+		job(job_num);
+		lock.lock();
+		if (--unfinished_jobs == 0)
+			jobs_done.notify_all();
+	}
+}
+
+void WorkerPool::Work()
+{
+	uint32_t last_batch = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			has_jobs.wait(lock, [&] {
+				return should_quit || batch != last_batch;
+			});
+			if (should_quit)
+				return;
+			last_batch = batch;
+		}
+		RunJobs();
+	}
+}
@@ -0,0 +1,125 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "dma.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "dosbox_test_fixture.h"
+#include "mem.h"
+
+namespace {
+
+class DmaTest : public DOSBoxTestFixture {
+public:
+	// Points the channel at the given physical address and length in bytes
+	DmaChannel *Program(const uint8_t num, const PhysPt address,
+	                    const uint32_t bytes, const bool autoinit)
+	{
+		auto chan = GetDMAChannel(num);
+		EXPECT_TRUE(chan);
+		const auto shift = chan->DMA16;
+		chan->SetPage(static_cast<uint8_t>(address >> 16));
+		chan->baseaddr = static_cast<uint16_t>((address & 0xffff) >> shift);
+		chan->curraddr = chan->baseaddr;
+		chan->basecnt = static_cast<uint16_t>((bytes >> shift) - 1);
+		chan->currcnt = chan->basecnt;
+		chan->autoinit = autoinit;
+		return chan;
+	}
+
+	void FillPattern(const PhysPt start, const uint32_t bytes)
+	{
+		for (uint32_t i = 0; i < bytes; ++i)
+			phys_writeb(start + i, static_cast<uint8_t>(i * 7 + (i >> 8)));
+	}
+
+	std::vector<uint8_t> ReadMemory(const PhysPt start, const uint32_t bytes)
+	{
+		std::vector<uint8_t> data(bytes);
+		for (uint32_t i = 0; i < bytes; ++i)
+			data[i] = phys_readb(start + i);
+		return data;
+	}
+};
+
+TEST_F(DmaTest, ReadsAcrossPages)
+{
+	// Starts mid-page and spans several pages of extended memory
+	constexpr PhysPt address = 0x120f80;
+	constexpr uint32_t bytes = 3 * 4096 + 100;
+	FillPattern(address, bytes);
+
+	auto chan = Program(1, address, bytes, false);
+	std::vector<uint8_t> data(bytes);
+	EXPECT_EQ(chan->Read(bytes, data.data()), bytes);
+	EXPECT_EQ(data, ReadMemory(address, bytes));
+}
+
+TEST_F(DmaTest, Reads16BitWordsAcrossPages)
+{
+	constexpr PhysPt address = 0x20ff00;
+	constexpr uint32_t bytes = 8192;
+	FillPattern(address, bytes);
+
+	auto chan = Program(5, address, bytes, false);
+	std::vector<uint8_t> data(bytes);
+	EXPECT_EQ(chan->Read(bytes / 2, data.data()), bytes / 2);
+	EXPECT_EQ(data, ReadMemory(address, bytes));
+}
+
+TEST_F(DmaTest, WritesAcrossPages)
+{
+	constexpr PhysPt address = 0x30f123;
+	constexpr uint32_t bytes = 5000;
+	std::vector<uint8_t> data(bytes);
+	for (uint32_t i = 0; i < bytes; ++i)
+		data[i] = static_cast<uint8_t>(i ^ 0x5a);
+
+	auto chan = Program(1, address, bytes, false);
+	EXPECT_EQ(chan->Write(bytes, data.data()), bytes);
+	EXPECT_EQ(ReadMemory(address, bytes), data);
+}
+
+TEST_F(DmaTest, AutoInitWrapsInChunks)
+{
+	// Reads the block twice over in uneven chunks, as the Sound Blaster does
+	constexpr PhysPt address = 0x40000;
+	constexpr uint32_t bytes = 4096 + 512;
+	FillPattern(address, bytes);
+	const auto block = ReadMemory(address, bytes);
+
+	auto chan = Program(1, address, bytes, true);
+	std::vector<uint8_t> data(bytes * 2);
+	size_t pos = 0;
+	for (size_t chunk = 100; pos < data.size(); chunk += 333) {
+		const auto n = std::min(chunk, data.size() - pos);
+		EXPECT_EQ(chan->Read(n, data.data() + pos), n);
+		pos += n;
+	}
+	EXPECT_EQ(std::vector<uint8_t>(data.begin(), data.begin() + bytes), block);
+	EXPECT_EQ(std::vector<uint8_t>(data.begin() + bytes, data.end()), block);
+	EXPECT_TRUE(chan->tcount);
+}
+
+} // namespace
@@ -0,0 +1,146 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/hardware/flac_encoder.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "byteorder.h"
+
+// The decoder is built into the decoders library
+#include "../src/libs/decoders/dr_flac.h"
+
+namespace {
+
+// Encodes the little-endian stereo frames in uneven chunks, as the capture
+// writer hands them over
+std::vector<uint8_t> encode(const std::vector<int16_t> &frames, const uint32_t rate)
+{
+	FlacEncoder encoder(rate);
+	std::vector<uint8_t> stream = encoder.GetHeader();
+	const auto header_size = stream.size();
+
+	const size_t num_frames = frames.size() / 2;
+	size_t pos = 0;
+	for (size_t chunk = 1000; pos < num_frames; chunk += 777) {
+		const auto n = std::min(chunk, num_frames - pos);
+		encoder.Add(frames.data() + pos * 2, n, stream);
+		pos += n;
+	}
+	encoder.Finish(stream);
+
+	const auto header = encoder.GetHeader();
+	EXPECT_EQ(header.size(), header_size);
+	std::copy(header.begin(), header.end(), stream.begin());
+	return stream;
+}
+
+void expect_round_trip(const std::vector<int16_t> &samples, const uint32_t rate)
+{
+	std::vector<int16_t> le_samples(samples.size());
+	for (size_t i = 0; i < samples.size(); ++i)
+		le_samples[i] = static_cast<int16_t>(
+		        host_to_le16(static_cast<uint16_t>(samples[i])));
+
+	const auto stream = encode(le_samples, rate);
+
+	unsigned int channels = 0;
+	unsigned int decoded_rate = 0;
+	drflac_uint64 decoded_frames = 0;
+	auto decoded = drflac_open_memory_and_read_pcm_frames_s16(
+	        stream.data(), stream.size(), &channels, &decoded_rate,
+	        &decoded_frames, nullptr);
+	ASSERT_NE(decoded, nullptr);
+	EXPECT_EQ(channels, 2u);
+	EXPECT_EQ(decoded_rate, rate);
+	ASSERT_EQ(decoded_frames, samples.size() / 2);
+	const std::vector<int16_t> actual(decoded, decoded + samples.size());
+	drflac_free(decoded, nullptr);
+	EXPECT_EQ(actual, samples);
+}
+
+std::vector<int16_t> make_tones(const size_t num_frames)
+{
+	constexpr double pi = 3.14159265358979323846;
+	std::vector<int16_t> samples(num_frames * 2);
+	for (size_t i = 0; i < num_frames; ++i) {
+		const auto t = static_cast<double>(i) / 48000;
+		samples[i * 2] = static_cast<int16_t>(12000 * std::sin(2 * pi * 440 * t));
+		samples[i * 2 + 1] = static_cast<int16_t>(9000 * std::sin(2 * pi * 660 * t + 1));
+	}
+	return samples;
+}
+
+TEST(FlacEncoder, RoundTripsTones)
+{
+	expect_round_trip(make_tones(48000), 48000);
+}
+
+TEST(FlacEncoder, RoundTripsLongStreams)
+{
+	// Frame numbers past 127 take more than one byte in the frame header
+	expect_round_trip(make_tones(FlacEncoder::block_size * 200), 48000);
+}
+
+TEST(FlacEncoder, RoundTripsNoise)
+{
+	std::mt19937 rng(2021);
+	std::uniform_int_distribution<int> dist(INT16_MIN, INT16_MAX);
+	std::vector<int16_t> samples(10000 * 2);
+	for (auto &s : samples)
+		s = static_cast<int16_t>(dist(rng));
+	expect_round_trip(samples, 44100);
+}
+
+TEST(FlacEncoder, RoundTripsExtremesAndSilence)
+{
+	std::vector<int16_t> samples(FlacEncoder::block_size * 2);
+	// Opposite full-scale channels need the full 17-bit side channel
+	for (size_t i = FlacEncoder::block_size; i < samples.size(); i += 2) {
+		samples[i] = (i & 2) ? INT16_MIN : INT16_MAX;
+		samples[i + 1] = (i & 2) ? INT16_MAX : INT16_MIN;
+	}
+	expect_round_trip(samples, 49716);
+}
+
+TEST(FlacEncoder, RoundTripsShortStreams)
+{
+	expect_round_trip(make_tones(1), 22050);
+	expect_round_trip(make_tones(5), 22050);
+	expect_round_trip(make_tones(FlacEncoder::block_size + 3), 32000);
+}
+
+TEST(FlacEncoder, CompressesTones)
+{
+	const auto samples = make_tones(48000);
+	std::vector<int16_t> le_samples(samples.size());
+	for (size_t i = 0; i < samples.size(); ++i)
+		le_samples[i] = static_cast<int16_t>(
+		        host_to_le16(static_cast<uint16_t>(samples[i])));
+
+	const auto stream = encode(le_samples, 48000);
+	EXPECT_LT(stream.size(), samples.size() * sizeof(int16_t) / 2);
+}
+
+} // namespace
@@ -0,0 +1,227 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "../src/hardware/gus.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "dosbox_test_fixture.h"
+#include "inout.h"
+#include "setup.h"
+
+namespace {
+
+constexpr io_port_t gus_base = 0x240 - 0x200;
+
+// Frames rendered per millisecond step, close to the rate of 32 voices
+constexpr uint16_t frames_per_ms = 19;
+
+struct RegisterWrite {
+	int ms = 0;
+	bool is_word = false;
+	io_port_t port = 0;
+	uint16_t value = 0;
+};
+
+// Writes a register stream in the style of a tracker player: 32 active
+// voices, 8 of them playing looped 8-bit samples with volume ramps and the
+// rest idle, as is common with module players
+std::vector<RegisterWrite> make_register_stream()
+{
+	std::mt19937 rng(1993);
+	std::vector<RegisterWrite> writes = {};
+	int ms = 0;
+	const auto write_byte = [&](const io_port_t offset, const uint8_t value) {
+		writes.push_back({ms, false, static_cast<io_port_t>(gus_base + offset), value});
+	};
+	const auto write_reg = [&](const uint8_t reg, const uint16_t value) {
+		write_byte(0x303, reg);
+		writes.push_back({ms, true, static_cast<io_port_t>(gus_base + 0x304), value});
+	};
+	const auto write_addr = [&](const uint8_t msw_reg, const uint32_t addr) {
+		const auto pos = addr << 9;
+		write_reg(msw_reg, static_cast<uint16_t>((pos >> 16) & 0x1fff));
+		write_reg(msw_reg + 1, static_cast<uint16_t>(pos & 0xffff));
+	};
+
+	// Reset the card with all 32 voices active
+	write_reg(0x4c, 0x0000);
+	write_reg(0x4c, 0x0100);
+	write_reg(0x0e, 31 << 8);
+
+	// Upload a sine, square, saw, and noise sample of 256 bytes each
+	constexpr double pi = 3.14159265358979323846;
+	std::vector<uint32_t> samples = {};
+	for (int k = 0; k < 4; ++k) {
+		const uint32_t addr = 0x1000 + k * 0x1000;
+		write_reg(0x44, static_cast<uint16_t>((addr >> 16) << 8));
+		for (int i = 0; i < 256; ++i) {
+			const double x = k == 0 ? sin(2 * pi * i / 64)
+			               : k == 1 ? ((i / 32) % 2 ? 1.0 : -1.0)
+			               : k == 2 ? (i % 128) / 64.0 - 1
+			                        : static_cast<int>(rng() % 201) / 100.0 - 1;
+			write_reg(0x43, static_cast<uint16_t>((addr + i) & 0xffff));
+			write_byte(0x307, static_cast<uint8_t>(static_cast<int>(x * 100)));
+		}
+		samples.push_back(addr);
+	}
+
+	// Silence the voices and start the DAC
+	for (uint8_t v = 0; v < 32; ++v) {
+		write_byte(0x302, v);
+		write_reg(0x00, 0x0300);
+		write_reg(0x0d, 0x0300);
+		write_reg(0x09, 0x0000);
+		write_reg(0x0c, 0x0700);
+	}
+	write_reg(0x4c, 0x0700);
+
+	// Play a row every 40 ms, triggering or releasing some of 8 channels
+	int started[8] = {};
+	bool playing[8] = {};
+	for (int row = 0; row < 50; ++row) {
+		ms = row * 40;
+		for (uint8_t ch = 0; ch < 8; ++ch) {
+			if (rng() % 10 < 3) {
+				const auto sample = samples[rng() % samples.size()];
+				write_byte(0x302, ch);
+				write_reg(0x00, 0x0300);
+				write_reg(0x0d, 0x0300);
+				write_addr(0x02, sample);
+				write_addr(0x04, sample + 255);
+				write_addr(0x0a, sample);
+				write_reg(0x01, static_cast<uint16_t>(200 + rng() % 2200));
+				write_reg(0x0c, static_cast<uint16_t>((rng() % 16) << 8));
+				write_reg(0x09, 0x0400);
+				write_reg(0x07, 0x10 << 8);
+				write_reg(0x08, static_cast<uint16_t>((0xa0 + rng() % 0x50) << 8));
+				write_reg(0x06, static_cast<uint16_t>((20 + rng() % 40) << 8));
+				write_reg(0x0d, 0x0000);
+				write_reg(0x00, 0x0800);
+				started[ch] = row;
+				playing[ch] = true;
+			} else if (playing[ch] && row - started[ch] > 4) {
+				write_byte(0x302, ch);
+				write_reg(0x07, 0x0000);
+				write_reg(0x06, 0x3f << 8);
+				write_reg(0x0d, 0x4000);
+				playing[ch] = false;
+			}
+		}
+	}
+	ms += 500;
+	write_reg(0x4c, 0x0000);
+	return writes;
+}
+
+class GusTest : public DOSBoxTestFixture {
+public:
+	void SetUp() override
+	{
+		DOSBoxTestFixture::SetUp();
+		section = control->GetSection("gus");
+		ASSERT_TRUE(section);
+		section->HandleInputline("gus=true");
+	}
+
+	void TearDown() override
+	{
+		GUS_SetRunRendering(true);
+		DOSBoxTestFixture::TearDown();
+	}
+
+	// Replays the register stream on a freshly started card and returns
+	// its output, adding the time spent rendering to render_time
+	std::vector<int16_t> Play(const std::vector<RegisterWrite> &writes,
+	                          std::chrono::nanoseconds &render_time)
+	{
+		section->ExecuteDestroy();
+		section->ExecuteInit();
+
+		using namespace std::chrono;
+		std::vector<int16_t> output = {};
+		int rendered_ms = 0;
+		const auto render_until = [&](const int ms) {
+			for (; rendered_ms < ms; ++rendered_ms) {
+				const auto size = output.size();
+				output.resize(size + frames_per_ms * 2);
+				const auto start = steady_clock::now();
+				GUS_Render(frames_per_ms, output.data() + size);
+				render_time += steady_clock::now() - start;
+			}
+		};
+		for (const auto &w : writes) {
+			render_until(w.ms);
+			if (w.is_word)
+				IO_WriteW(w.port, w.value);
+			else
+				IO_WriteB(w.port, static_cast<uint8_t>(w.value));
+		}
+		section->ExecuteDestroy();
+		return output;
+	}
+
+	Section *section = nullptr;
+};
+
+TEST_F(GusTest, RunsMatchFrameAtATime)
+{
+	const auto writes = make_register_stream();
+	std::chrono::nanoseconds render_time{0};
+
+	GUS_SetRunRendering(false);
+	const auto expected = Play(writes, render_time);
+	GUS_SetRunRendering(true);
+	const auto actual = Play(writes, render_time);
+
+	ASSERT_EQ(expected.size(), actual.size());
+	int64_t energy = 0;
+	for (size_t i = 0; i < expected.size(); ++i) {
+		energy += std::abs(expected[i]);
+		ASSERT_EQ(expected[i], actual[i]) << "at sample " << i;
+	}
+	// Make sure the voices actually played
+	EXPECT_GT(energy, 0);
+}
+
+// Reports how long each renderer takes with the register stream
+TEST_F(GusTest, DISABLED_BenchmarkRenderRegisterStream)
+{
+	const auto writes = make_register_stream();
+	for (const bool runs : {false, true}) {
+		GUS_SetRunRendering(runs);
+		std::chrono::nanoseconds render_time{0};
+		const auto output = Play(writes, render_time);
+		using namespace std::chrono;
+		std::cout << "GUS rendered " << output.size() / 2 << " frames "
+		          << (runs ? "in runs" : "a frame at a time") << " in "
+		          << duration_cast<microseconds>(render_time).count()
+		          << " us\n";
+	}
+}
+
+} // namespace
@@ -0,0 +1,160 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "mixer.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "cpu.h"
+#include "dosbox_test_fixture.h"
+#include "timer.h"
+
+namespace {
+
+constexpr int cycles_per_ms = 1000;
+
+// A channel at the mixer's rate that counts the frames it's asked for
+struct CountingChannel {
+	mixer_channel_t channel = nullptr;
+	int frames = 0;
+
+	explicit CountingChannel(const char *name)
+	{
+		channel = MIXER_AddChannel(
+		        [this](const uint16_t requested) {
+			        const std::vector<int16_t> silence(requested);
+			        channel->AddSamples_m16(requested, silence.data());
+			        frames += requested;
+		        },
+		        0, name);
+		channel->Enable(true);
+	}
+
+	~CountingChannel()
+	{
+		// The mixer keeps the channel, so stop it calling back
+		channel->Enable(false);
+	}
+};
+
+// A sleep-enabled mono channel at the mixer's rate that plays level(frame)
+struct LevelChannel {
+	mixer_channel_t channel = nullptr;
+	int frame = 0;
+
+	LevelChannel(const char *name, const std::function<int16_t(int)> level)
+	{
+		channel = MIXER_AddChannel(
+		        [this, level](const uint16_t requested) {
+			        std::vector<int16_t> samples(requested);
+			        for (auto &sample : samples)
+				        sample = level(frame++);
+			        channel->AddSamples_m16(requested, samples.data());
+		        },
+		        0, name);
+		channel->Enable(true);
+		channel->ConfigureSleep(true);
+	}
+
+	~LevelChannel()
+	{
+		channel->Enable(false);
+	}
+};
+
+class MixerTest : public DOSBoxTestFixture {
+public:
+	void SetUp() override
+	{
+		DOSBoxTestFixture::SetUp();
+		saved_cycles = {CPU_Cycles, CPU_CycleLeft, CPU_CycleMax};
+		CPU_CycleMax = cycles_per_ms;
+		CPU_Cycles = 0;
+		CPU_CycleLeft = cycles_per_ms;
+	}
+
+	void TearDown() override
+	{
+		CPU_Cycles = saved_cycles[0];
+		CPU_CycleLeft = saved_cycles[1];
+		CPU_CycleMax = saved_cycles[2];
+		DOSBoxTestFixture::TearDown();
+	}
+
+private:
+	std::array<int32_t, 3> saved_cycles = {};
+};
+
+// Devices such as the Sound Blaster's DAC fill their channel up to the
+// current point in the tick when the game writes to them. That has to track
+// the frames the offline mixer renders, or the channel drifts ahead of the
+// ones the mixer only pulls at the end of each tick.
+TEST_F(MixerTest, OfflineFillUpStaysAligned)
+{
+	CountingChannel filled("FILLED");
+	CountingChannel ticked("TICKED");
+	const int rate = filled.channel->GetSampleRate();
+
+	// A newly enabled channel renders one frame more than it's asked for
+	// the first time, so settle both before switching to offline mode
+	TIMER_AddTick();
+	filled.frames = 0;
+	ticked.frames = 0;
+	MIXER_StartOffline();
+
+	for (int tick = 1; tick <= 100; ++tick) {
+		// Run most of the tick's cycles, then fill up to that point,
+		// which should be as far into the frames this tick renders
+		const int tick_frames = tick * rate / 1000 - ticked.frames;
+		CPU_CycleLeft = cycles_per_ms / 100;
+		filled.channel->FillUp();
+		ASSERT_EQ(filled.frames - ticked.frames, tick_frames * 99 / 100)
+		        << "filled up mid-way through tick " << tick;
+
+		TIMER_AddTick();
+		ASSERT_EQ(filled.frames, ticked.frames) << "after tick " << tick;
+		ASSERT_EQ(ticked.frames, tick * rate / 1000) << "after tick " << tick;
+	}
+}
+
+// A device that leaves its output at a DC offset is as quiet as one that
+// outputs zeroes, so its channel goes to sleep all the same, while one that
+// keeps changing level stays awake
+TEST_F(MixerTest, SteadyLevelChannelSleeps)
+{
+	LevelChannel steady("STEADY", [](int) { return int16_t{4000}; });
+	LevelChannel tone("TONE", [](const int frame) {
+		return static_cast<int16_t>(frame % 40 < 20 ? 4000 : -4000);
+	});
+	MIXER_StartOffline();
+
+	for (int tick = 0; tick < 4000; ++tick)
+		TIMER_AddTick();
+
+	EXPECT_FALSE(steady.channel->is_enabled);
+	EXPECT_TRUE(tone.channel->is_enabled);
+}
+
+} // namespace
@@ -0,0 +1,203 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "mixer.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cpu.h"
+#include "dosbox_test_fixture.h"
+#include "setup.h"
+
+namespace {
+
+// Emulated cycles per millisecond, which sets the PIT timestamp resolution
+constexpr int cycles_per_ms = 3000;
+
+class PcSpeakerTest : public DOSBoxTestFixture {
+public:
+	void SetUp() override
+	{
+		DOSBoxTestFixture::SetUp();
+		section = control->GetSection("speaker");
+		ASSERT_TRUE(section);
+		saved_cycles = {CPU_Cycles, CPU_CycleLeft, CPU_CycleMax};
+		CPU_CycleMax = cycles_per_ms;
+		CPU_CycleLeft = 0;
+	}
+
+	void TearDown() override
+	{
+		CPU_Cycles = saved_cycles[0];
+		CPU_CycleLeft = saved_cycles[1];
+		CPU_CycleMax = saved_cycles[2];
+		DOSBoxTestFixture::TearDown();
+	}
+
+	void UseRenderer(const std::string &renderer)
+	{
+		section->ExecuteDestroy();
+		section->HandleInputline("pcrender=" + renderer);
+		section->ExecuteInit();
+	}
+
+	// Puts the speaker into the same state for each renderer, as the
+	// levels it queues depend on its previous PIT and PWM modes
+	void ResetSpeaker()
+	{
+		CPU_Cycles = cycles_per_ms;
+		PCSPEAKER_SetType(0);
+		PCSPEAKER_SetCounter(40, 0);
+		PCSPEAKER_SetCounter(40, 0);
+		PCSPEAKER_SetType(3);
+		Render(1);
+	}
+
+	// Renders the given number of ticks, calling program(tick) before
+	// each so it can drive the speaker during that tick
+	template <typename Programmer>
+	std::vector<int16_t> Render(const int ms, Programmer program)
+	{
+		const auto frames_per_ms = static_cast<uint16_t>(
+		        MIXER_FindChannel("SPKR")->GetSampleRate() / 1000);
+		std::vector<int16_t> out(static_cast<size_t>(ms * frames_per_ms));
+		for (int t = 0; t < ms; ++t) {
+			program(t);
+			CPU_Cycles = 0;
+			PCSPEAKER_Render(frames_per_ms, out.data() + t * frames_per_ms);
+		}
+		return out;
+	}
+
+	std::vector<int16_t> Render(const int ms)
+	{
+		return Render(ms, [](int) {});
+	}
+
+	// Retriggers the PIT's one-shot mode, as RealSound does, at the given
+	// rate. The count of each pulse sets the speaker's level.
+	static void PlayPulses(const int pulses_per_ms,
+	                       const std::function<int(int)> &count_of_pulse)
+	{
+		for (int i = 0; i < pulses_per_ms; ++i) {
+			// Place each pulse at its time within the tick
+			CPU_Cycles = cycles_per_ms - i * cycles_per_ms / pulses_per_ms;
+			PCSPEAKER_SetCounter(count_of_pulse(i), 0);
+		}
+	}
+
+	Section *section = nullptr;
+	std::array<Bit32s, 3> saved_cycles = {};
+};
+
+// The energy of the signal's variation around its mean
+double ac_energy(const std::vector<int16_t> &samples)
+{
+	double mean = 0.0;
+	for (const auto s : samples)
+		mean += s;
+	mean /= static_cast<double>(samples.size());
+	double energy = 0.0;
+	for (const auto s : samples)
+		energy += (s - mean) * (s - mean);
+	return energy;
+}
+
+// A single step has to settle at the level the speaker was set to,
+// whichever renderer draws the edge
+TEST_F(PcSpeakerTest, StepSettlesToSameLevel)
+{
+	std::vector<int16_t> levels = {};
+	for (const std::string renderer : {"integrated", "bandlimited"}) {
+		UseRenderer(renderer);
+		ResetSpeaker();
+		const auto out = Render(10, [](const int tick) {
+			if (tick == 2) {
+				CPU_Cycles = cycles_per_ms / 2;
+				PCSPEAKER_SetCounter(70, 0);
+			}
+		});
+		levels.push_back(out.back());
+	}
+	EXPECT_GT(std::abs(levels[0]), 1000);
+	EXPECT_NEAR(levels[1], levels[0], std::abs(levels[0]) / 100 + 2);
+}
+
+// A square wave well above the speaker's Nyquist frequency should all but
+// vanish with band-limited steps, while averaging each sample's period lets
+// much of it alias back into the audible range
+TEST_F(PcSpeakerTest, BandLimitedAliasesLess)
+{
+	// Edges per tick of a whole-kHz square wave at about 80% of the
+	// speaker's rate, so every tick starts on a rising edge
+	const auto rate = MIXER_FindChannel("SPKR")->GetSampleRate();
+	const auto edges_per_ms = 2 * (rate * 8 / 10 / 1000);
+	const auto play_square_wave = [=](int) {
+		PlayPulses(edges_per_ms, [](const int i) { return i % 2 ? 0 : 80; });
+	};
+
+	std::vector<double> energies = {};
+	for (const std::string renderer : {"integrated", "bandlimited"}) {
+		UseRenderer(renderer);
+		ResetSpeaker();
+		// Let the impulses of the first edges pass before measuring
+		Render(5, play_square_wave);
+		energies.push_back(ac_energy(Render(100, play_square_wave)));
+	}
+	EXPECT_GT(energies[0], 0.0);
+	EXPECT_LT(energies[1], energies[0] / 10);
+}
+
+// Renders the same RealSound-style signal, a 440 Hz tone on a 16 kHz
+// carrier, with both renderers and reports how long each took
+TEST_F(PcSpeakerTest, DISABLED_BenchmarkPwmRenderers)
+{
+	using namespace std::chrono;
+	constexpr int ms = 5000;
+	constexpr int carrier_hz = 16000;
+	constexpr double pi = 3.14159265358979323846;
+	for (const std::string renderer : {"integrated", "bandlimited"}) {
+		UseRenderer(renderer);
+		ResetSpeaker();
+		int pulse = 0;
+		const auto start = steady_clock::now();
+		Render(ms, [&](int) {
+			PlayPulses(carrier_hz / 1000, [&](int) {
+				const auto tone = sin(2 * pi * 440 * pulse++ / carrier_hz);
+				return static_cast<int>(40 + 30 * tone);
+			});
+		});
+		const auto elapsed = steady_clock::now() - start;
+		std::cout << "PC speaker " << renderer << " renderer played " << ms
+		          << " ms of PWM audio in "
+		          << duration_cast<microseconds>(elapsed).count() << " us\n";
+	}
+}
+
+} // namespace
@@ -0,0 +1,207 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "dosbox.h"
+#include "render.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int width = 320;
+constexpr int height = 200;
+
+// Indexes into the scalers' source bpp rows and 32-bit output column
+constexpr int src_8 = 0;
+constexpr int src_32 = 4;
+constexpr int src_9 = 5;
+constexpr int dst_32 = 3;
+
+int bytes_per_pixel(const int src)
+{
+	return src == src_32 ? 4 : 1;
+}
+
+struct Frames {
+	std::vector<std::vector<uint8_t>> sources = {};
+	std::vector<uint32_t> palette = {};
+};
+
+// A first frame of noise followed by frames with a few changed rectangles,
+// so both the changed and unchanged spans of a line are covered
+Frames make_frames(const int src, const int num_frames)
+{
+	std::mt19937 rng(2021);
+	Frames frames;
+	frames.palette.resize(256);
+	for (auto &colour : frames.palette)
+		colour = rng();
+
+	const int line_bytes = width * bytes_per_pixel(src);
+	std::vector<uint8_t> image(line_bytes * height);
+	for (auto &b : image)
+		b = static_cast<uint8_t>(rng());
+	frames.sources.push_back(image);
+	for (int f = 1; f < num_frames; ++f) {
+		for (int r = 0; r < 3; ++r) {
+			const int x0 = rng() % line_bytes;
+			const int y0 = rng() % height;
+			const int x1 = std::min<int>(line_bytes, x0 + 1 + rng() % 90);
+			const int y1 = std::min<int>(height, y0 + 1 + rng() % 40);
+			for (int y = y0; y < y1; ++y)
+				for (int x = x0; x < x1; ++x)
+					image[y * line_bytes + x] = static_cast<uint8_t>(rng());
+		}
+		frames.sources.push_back(image);
+	}
+	return frames;
+}
+
+struct Output {
+	std::vector<uint8_t> pixels = {};
+	std::vector<std::vector<uint16_t>> changed_lines = {};
+};
+
+// Feeds the frames through a line handler like RENDER_StartUpdate,
+// RENDER_DrawLine, and RENDER_EndUpdate would
+Output scale(const ScalerSimpleBlock_t &scaler, const bool linear,
+             const int src, const Frames &frames)
+{
+	const auto handler = linear ? scaler.Linear[src][dst_32]
+	                            : scaler.Random[src][dst_32];
+	const int line_bytes = width * bytes_per_pixel(src);
+
+	render.src.width = width;
+	render.src.height = height;
+	render.scale.cachePitch = line_bytes;
+	for (int i = 0; i < 256; ++i) {
+		render.pal.lut.b32[i] = frames.palette[i];
+		render.pal.modified[i] = 0;
+	}
+	for (int y = 0; y < height; ++y)
+		Scaler_Aspect[y] = static_cast<Bit8u>(scaler.yscale);
+
+	Output output;
+	const int pitch = width * static_cast<int>(scaler.xscale) * 4;
+	output.pixels.assign(pitch * height * scaler.yscale, 0);
+	std::memset(&scalerSourceCache, 0xff, sizeof(scalerSourceCache));
+
+	for (const auto &source : frames.sources) {
+		render.scale.outLine = 0;
+		render.scale.cacheRead = reinterpret_cast<Bit8u *>(&scalerSourceCache);
+		render.scale.outWrite = output.pixels.data();
+		render.scale.outPitch = pitch;
+		Scaler_ChangedLines[0] = 0;
+		Scaler_ChangedLineIndex = 0;
+		for (int y = 0; y < height; ++y)
+			handler(source.data() + y * line_bytes);
+		output.changed_lines.emplace_back(
+		        Scaler_ChangedLines,
+		        Scaler_ChangedLines + Scaler_ChangedLineIndex + 1);
+	}
+	return output;
+}
+
+struct NamedScaler {
+	const char *name;
+	const ScalerSimpleBlock_t &scaler;
+};
+
+const std::vector<NamedScaler> simple_scalers = {
+        {"Normal1x", ScaleNormal1x}, {"NormalDw", ScaleNormalDw},
+        {"NormalDh", ScaleNormalDh}, {"Normal2x", ScaleNormal2x},
+        {"Normal3x", ScaleNormal3x}, {"TV2x", ScaleTV2x},
+        {"TV3x", ScaleTV3x},         {"RGB2x", ScaleRGB2x},
+        {"RGB3x", ScaleRGB3x},       {"Scan2x", ScaleScan2x},
+        {"Scan3x", ScaleScan3x},
+};
+
+class RenderScalersTest : public ::testing::Test {
+public:
+	void SetUp() override
+	{
+		if (!Scaler_SetSIMD(true))
+			GTEST_SKIP() << "No SIMD support in this build";
+	}
+
+	void TearDown() override { Scaler_SetSIMD(true); }
+};
+
+TEST_F(RenderScalersTest, SIMDMatchesScalar)
+{
+	for (const int src : {src_8, src_9, src_32}) {
+		const auto frames = make_frames(src, 6);
+		for (const auto &s : simple_scalers) {
+			for (const bool linear : {false, true}) {
+				Scaler_SetSIMD(false);
+				const auto expected = scale(s.scaler, linear, src, frames);
+				Scaler_SetSIMD(true);
+				const auto actual = scale(s.scaler, linear, src, frames);
+				EXPECT_TRUE(expected.pixels == actual.pixels)
+				        << s.name << " from source " << src
+				        << (linear ? " linear" : " random");
+				EXPECT_EQ(expected.changed_lines, actual.changed_lines)
+				        << s.name << " from source " << src
+				        << (linear ? " linear" : " random");
+			}
+		}
+	}
+}
+
+// Reports how many fully changed lines per second each path scales
+TEST_F(RenderScalersTest, DISABLED_BenchmarkLinesPerSecond)
+{
+	constexpr int num_frames = 60;
+	const std::vector<NamedScaler> scalers = {{"Normal2x", ScaleNormal2x},
+	                                          {"Normal3x", ScaleNormal3x},
+	                                          {"TV2x", ScaleTV2x},
+	                                          {"Scan3x", ScaleScan3x}};
+	for (const int src : {src_8, src_32}) {
+		// Every frame differs from the last in every line
+		auto frames = make_frames(src, 1);
+		for (int f = 1; f < num_frames; ++f) {
+			frames.sources.push_back(frames.sources.back());
+			for (auto &b : frames.sources.back())
+				b = static_cast<uint8_t>(b + 1);
+		}
+		for (const auto &s : scalers) {
+			for (const bool simd : {false, true}) {
+				Scaler_SetSIMD(simd);
+				using namespace std::chrono;
+				const auto start = steady_clock::now();
+				scale(s.scaler, false, src, frames);
+				const duration<double> elapsed = steady_clock::now() - start;
+				const auto lines_per_s = num_frames * height / elapsed.count();
+				std::cout << s.name << " from " << (src == src_8 ? 8 : 32)
+				          << " bpp " << (simd ? "SIMD  " : "scalar")
+				          << ": " << static_cast<int64_t>(lines_per_s)
+				          << " lines/s\n";
+			}
+		}
+	}
+}
+
+} // namespace
@@ -23,9 +23,14 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
 #include <thread>
 #include <vector>
 
+#include "rwring.h"
+
 namespace {
 
 constexpr auto iterations = 10000;
@@ -238,4 +243,196 @@ TEST(RWQueue,ContainerMoveAsync)
 	EXPECT_EQ(q.Size(), 0);
 }
 
+TEST(RWRing, TrivialSerial)
+{
+	RWRing<int> r(65);
+	for (int iteration = 0; iteration != 128; ++iteration) {
+		EXPECT_EQ(r.MaxCapacity(), 65);
+		EXPECT_EQ(r.Size(), 0);
+		EXPECT_TRUE(r.IsEmpty());
+		for (int i = 0; i != 65; ++i) {
+			auto block = r.BeginWrite();
+			ASSERT_TRUE(block);
+			*block = i;
+			r.EndWrite();
+		}
+		EXPECT_EQ(r.Size(), 65);
+		EXPECT_FALSE(r.IsEmpty());
+
+		for (int i = 0; i != 65; ++i) {
+			const auto block = r.BeginRead();
+			ASSERT_TRUE(block);
+			EXPECT_EQ(*block, i);
+			r.EndRead();
+		}
+		EXPECT_TRUE(r.IsEmpty());
+	}
+}
+
+TEST(RWRing, TrivialZeroCapacity)
+{
+	// Zero capacity
+	EXPECT_DEBUG_DEATH({ RWRing<int> r(0); }, "");
+}
+
+TEST(RWRing, ContainerBlocksStayInPlace)
+{
+	RWRing<container_t> r(4, container_t(512));
+	std::vector<const container_t *> addresses = {};
+	for (int i = 0; i != 8; ++i) {
+		auto block = r.BeginWrite();
+		ASSERT_TRUE(block);
+		EXPECT_EQ(block->size(), 512);
+		(*block)[0] = static_cast<int16_t>(i);
+		r.EndWrite();
+
+		const auto played = r.BeginRead();
+		ASSERT_EQ(played, block);
+		EXPECT_EQ((*played)[0], i);
+		r.EndRead();
+		addresses.push_back(played);
+	}
+	// The ring cycles through its four pre-allocated blocks
+	for (size_t i = 4; i != addresses.size(); ++i)
+		EXPECT_EQ(addresses[i], addresses[i - 4]);
+}
+
+TEST(RWRing, StopReleasesWaitingSides)
+{
+	RWRing<int> r(2);
+	std::thread reader([&r] { EXPECT_FALSE(r.BeginRead()); });
+	r.Stop();
+	reader.join();
+
+	r.Reset();
+	for (int i = 0; i != 2; ++i) {
+		*r.BeginWrite() = i;
+		r.EndWrite();
+	}
+	std::thread writer([&r] { EXPECT_FALSE(r.BeginWrite()); });
+	r.Stop();
+	writer.join();
+
+	// Re-armed rings start over empty
+	r.Reset();
+	EXPECT_TRUE(r.IsEmpty());
+	EXPECT_TRUE(r.BeginWrite());
+}
+
+void ring_consume(RWRing<int> *r, const size_t *max_depth)
+{
+	for (int i = 0; i != iterations; ++i) {
+		EXPECT_TRUE(r->Size() <= *max_depth);
+		const auto block = r->BeginRead();
+		ASSERT_TRUE(block);
+		EXPECT_EQ(*block, i);
+		r->EndRead();
+	}
+}
+
+void ring_produce(RWRing<int> *r, const size_t *max_depth)
+{
+	for (int i = 0; i != iterations; ++i) {
+		auto block = r->BeginWrite();
+		ASSERT_TRUE(block);
+		*block = i;
+		r->EndWrite();
+		EXPECT_TRUE(r->Size() <= *max_depth);
+	}
+}
+
+TEST(RWRing, TrivialAsync)
+{
+	const size_t max_depth = 8;
+	RWRing<int> r(max_depth);
+
+	std::thread writer(ring_produce, &r, &max_depth);
+	std::thread reader(ring_consume, &r, &max_depth);
+
+	writer.join();
+	reader.join();
+
+	// Make sure we've consumed all produced items and the ring is empty
+	EXPECT_EQ(r.Size(), 0);
+}
+
+// Handoff benchmark
+// ~~~~~~~~~~~~~~~~~
+// A producer and consumer hammer a shallow queue so both sides regularly
+// find it full or empty. Each item's latency is the time from just before
+// it was offered to just after it was taken.
+
+using handoff_clock = std::chrono::steady_clock;
+using handoff_times = std::vector<handoff_clock::time_point>;
+
+constexpr size_t handoff_depth = 4;
+constexpr int handoff_iterations = 100000;
+
+void report_handoffs(const char *name, const handoff_times &sent,
+                     const handoff_times &received)
+{
+	using namespace std::chrono;
+	std::vector<int64_t> latencies_ns = {};
+	latencies_ns.reserve(sent.size());
+	for (size_t i = 0; i != sent.size(); ++i)
+		latencies_ns.push_back(
+		        duration_cast<nanoseconds>(received[i] - sent[i]).count());
+	std::sort(latencies_ns.begin(), latencies_ns.end());
+
+	const auto percentile = [&](const size_t p) {
+		return latencies_ns[(latencies_ns.size() - 1) * p / 100];
+	};
+	const auto total = duration_cast<microseconds>(received.back() -
+	                                               sent.front());
+	std::cout << name << ": " << sent.size() << " handoffs in "
+	          << total.count() << " us, latency median " << percentile(50)
+	          << " ns, p99 " << percentile(99) << " ns\n";
+}
+
+TEST(RWQueue, DISABLED_BenchmarkHandoffLatency)
+{
+	RWQueue<int> q(handoff_depth);
+	handoff_times sent(handoff_iterations);
+	handoff_times received(handoff_iterations);
+
+	std::thread writer([&] {
+		for (int i = 0; i != handoff_iterations; ++i) {
+			sent[i] = handoff_clock::now();
+			q.Enqueue(i);
+		}
+	});
+	for (int i = 0; i != handoff_iterations; ++i) {
+		ASSERT_EQ(q.Dequeue(), i);
+		received[i] = handoff_clock::now();
+	}
+	writer.join();
+
+	report_handoffs("RWQueue", sent, received);
+}
+
+TEST(RWRing, DISABLED_BenchmarkHandoffLatency)
+{
+	RWRing<int> r(handoff_depth);
+	handoff_times sent(handoff_iterations);
+	handoff_times received(handoff_iterations);
+
+	std::thread writer([&] {
+		for (int i = 0; i != handoff_iterations; ++i) {
+			sent[i] = handoff_clock::now();
+			*r.BeginWrite() = i;
+			r.EndWrite();
+		}
+	});
+	for (int i = 0; i != handoff_iterations; ++i) {
+		const auto block = r.BeginRead();
+		ASSERT_TRUE(block);
+		ASSERT_EQ(*block, i);
+		r.EndRead();
+		received[i] = handoff_clock::now();
+	}
+	writer.join();
+
+	report_handoffs("RWRing", sent, received);
+}
+
 } // namespace
@@ -22,6 +22,11 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
 namespace {
 
 TEST(SoftLimiter, InboundsProcessAllFrames)
@@ -323,4 +328,98 @@ TEST(SoftLimiter, RangeMultiply)
 	EXPECT_EQ(out, expected);
 }
 
+// Fills the interleaved sequence with noise within the given amplitude
+void fill_noise(std::mt19937 &rng, const float amplitude, std::vector<float> &in)
+{
+	std::uniform_real_distribution<float> dist(-amplitude, amplitude);
+	for (auto &sample : in)
+		sample = dist(rng);
+}
+
+// Inbounds sequences take the vectorized path; every sequence length, and
+// therefore every vector tail, should match the scalar per-sample result.
+TEST(SoftLimiter, InboundsMatchScalarScaling)
+{
+	std::mt19937 rng(2021);
+	SoftLimiter limiter("test-channel");
+	const AudioFrame levels = {0.8f, 0.3f};
+	limiter.UpdateLevels(levels, 1.0f);
+
+	for (uint16_t frames = 1; frames <= 67; ++frames) {
+		std::vector<float> in(frames * 2);
+		fill_noise(rng, 32000.0f, in);
+		std::vector<int16_t> out(frames * 2);
+		limiter.Process(in, frames, out);
+
+		for (size_t i = 0; i < in.size(); i += 2) {
+			ASSERT_EQ(out[i], static_cast<int16_t>(in[i] * levels.left))
+			        << "left sample " << i / 2 << " of " << frames;
+			ASSERT_EQ(out[i + 1],
+			          static_cast<int16_t>(in[i + 1] * levels.right))
+			        << "right sample " << i / 2 << " of " << frames;
+		}
+	}
+}
+
+// While releasing a prior peak, inbounds sequences are scaled as a ratio of
+// that peak, and should match the scalar per-sample result.
+TEST(SoftLimiter, ReleaseMatchScalarScaling)
+{
+	std::mt19937 rng(2021);
+	SoftLimiter limiter("test-channel");
+	std::vector<int16_t> out(2);
+	limiter.Process({-80000.0f, 60000.0f}, 1, out);
+
+	constexpr float bounds = INT16_MAX - 1;
+	for (uint16_t frames = 1; frames <= 67; ++frames) {
+		const auto peaks = limiter.GetPeaks();
+		ASSERT_GT(peaks.left, bounds);
+		ASSERT_GT(peaks.right, bounds);
+
+		std::vector<float> in(frames * 2);
+		fill_noise(rng, 30000.0f, in);
+		out.resize(in.size());
+		limiter.Process(in, frames, out);
+
+		const AudioFrame scalars = {1.0f * bounds / peaks.left,
+		                            1.0f * bounds / peaks.right};
+		for (size_t i = 0; i < in.size(); i += 2) {
+			ASSERT_EQ(out[i], static_cast<int16_t>(in[i] * scalars.left))
+			        << "left sample " << i / 2 << " of " << frames;
+			ASSERT_EQ(out[i + 1],
+			          static_cast<int16_t>(in[i + 1] * scalars.right))
+			        << "right sample " << i / 2 << " of " << frames;
+		}
+	}
+}
+
+// Reports the throughput of inbounds sequences, which skip peak analysis,
+// and of sequences that need limiting.
+TEST(SoftLimiter, DISABLED_BenchmarkThroughput)
+{
+	constexpr uint16_t frames = 512;
+	constexpr int iterations = 4000;
+	std::mt19937 rng(2021);
+
+	auto run = [&](const char *name, const float amplitude) {
+		SoftLimiter limiter("test-channel");
+		std::vector<float> in(frames * 2);
+		std::vector<int16_t> out(frames * 2);
+		using namespace std::chrono;
+		nanoseconds elapsed{0};
+		for (int i = 0; i < iterations; ++i) {
+			fill_noise(rng, amplitude, in);
+			const auto start = steady_clock::now();
+			limiter.Process(in, frames, out);
+			elapsed += steady_clock::now() - start;
+		}
+		const auto frames_per_us = static_cast<double>(frames) *
+		                           iterations / (elapsed.count() / 1000.0);
+		std::cout << name << ": " << frames_per_us
+		          << " frames per microsecond\n";
+	};
+	run("Inbounds", 30000.0f);
+	run("Limiting", 90000.0f);
+}
+
 } // namespace
@@ -0,0 +1,116 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "vga.h"
+
+#include <gtest/gtest.h>
+
+#include "dosbox_test_fixture.h"
+#include "inout.h"
+#include "pic.h"
+
+namespace {
+
+constexpr uint32_t parts_total = 4;
+constexpr uint32_t parts_lines = 100;
+
+class VgaDrawTest : public DOSBoxTestFixture {
+public:
+	void TearDown() override
+	{
+		VGA_SetFrameBatching(true);
+		DOSBoxTestFixture::TearDown();
+	}
+
+protected:
+	// Puts the beam on the frame's first displayed line, with the frame
+	// being drawn in one go at display end, as it is after enough frames
+	// without raster effects
+	static void StartBatchedFrame()
+	{
+		vga.draw.mode = PART;
+		vga.draw.lines_total = parts_total * parts_lines;
+		vga.draw.parts_total = parts_total;
+		vga.draw.parts_lines = parts_lines;
+		vga.draw.parts_left = 1;
+		vga.draw.lines_done = 0;
+		vga.draw.delay.htotal = 0.03;
+		vga.draw.delay.parts = vga.draw.delay.htotal * parts_lines;
+		vga.draw.delay.vdend = vga.draw.delay.parts * parts_total;
+		vga.draw.delay.vtotal = vga.draw.delay.vdend + 2.0;
+		vga.draw.delay.framestart = PIC_FullIndex();
+		vga.draw.batch.quiet_frames = 10;
+		vga.draw.batch.active = true;
+		vga.draw.batch.draw_skip = 0;
+	}
+
+	static void ExpectDrawnPerPart()
+	{
+		EXPECT_FALSE(vga.draw.batch.active);
+		EXPECT_EQ(vga.draw.batch.quiet_frames, 0u);
+		EXPECT_EQ(vga.draw.parts_left, parts_total);
+	}
+};
+
+TEST_F(VgaDrawTest, CrtcWriteDuringDisplayDrawsPerPart)
+{
+	StartBatchedFrame();
+
+	// Write the offset register back with the value it already has
+	IO_WriteB(0x3d4, 0x13);
+	IO_WriteB(0x3d5, IO_ReadB(0x3d5));
+
+	ExpectDrawnPerPart();
+}
+
+TEST_F(VgaDrawTest, DacWriteDuringDisplayDrawsPerPart)
+{
+	StartBatchedFrame();
+
+	IO_WriteB(0x3c8, 0);
+	IO_WriteB(0x3c9, 0x3f);
+	IO_WriteB(0x3c9, 0x00);
+	IO_WriteB(0x3c9, 0x00);
+
+	ExpectDrawnPerPart();
+}
+
+TEST_F(VgaDrawTest, WriteDuringBlankingKeepsBatch)
+{
+	StartBatchedFrame();
+	vga.draw.delay.framestart -= vga.draw.delay.vdend;
+
+	IO_WriteB(0x3c8, 0);
+	IO_WriteB(0x3c9, 0x3f);
+
+	EXPECT_TRUE(vga.draw.batch.active);
+	EXPECT_EQ(vga.draw.parts_left, 1u);
+}
+
+TEST_F(VgaDrawTest, DisablingBatchingDrawsPerPart)
+{
+	StartBatchedFrame();
+
+	VGA_SetFrameBatching(false);
+
+	ExpectDrawnPerPart();
+}
+
+} // namespace
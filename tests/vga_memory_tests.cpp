@@ -0,0 +1,243 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "vga.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "cpu.h"
+#include "dosbox_test_fixture.h"
+#include "mem.h"
+#include "regs.h"
+
+namespace {
+
+// Brings up the VGA, which fills the tables used by the write modes
+class VgaMemoryTest : public DOSBoxTestFixture {};
+
+constexpr int num_addresses = 256;
+
+// Repeats the low four bits as all-on or all-off bytes, one per plane,
+// like the graphics controller's FillTable
+uint32_t fill_planes(const uint32_t bits)
+{
+	uint32_t planes = 0;
+	for (int p = 0; p < 4; ++p)
+		if (bits & (1 << p))
+			planes |= 0xffu << (p * 8);
+	return planes;
+}
+
+// Sets the graphics controller, sequencer, and latch to random states
+void randomise_registers(std::mt19937 &rng)
+{
+	auto &config = vga.config;
+	config.write_mode = static_cast<Bit8u>(rng() % 4);
+	config.raster_op = static_cast<Bit8u>(rng() % 4);
+	config.data_rotate = static_cast<Bit8u>(rng() % 8);
+	config.full_bit_mask = 0x01010101u * (rng() & 0xff);
+	config.full_map_mask = fill_planes(rng());
+	config.full_not_map_mask = ~config.full_map_mask;
+	config.full_set_reset = fill_planes(rng());
+	config.full_enable_set_reset = fill_planes(rng());
+	config.full_not_enable_set_reset = ~config.full_enable_set_reset;
+	config.full_enable_and_set_reset = config.full_set_reset &
+	                                   config.full_enable_set_reset;
+	vga.latch.d = rng();
+}
+
+TEST_F(VgaMemoryTest, PlanarWriteSpanMatchesBytes)
+{
+	std::mt19937 rng(2021);
+	std::vector<uint32_t> planes(num_addresses);
+	const auto saved_linear = vga.mem.linear;
+	vga.mem.linear = reinterpret_cast<uint8_t *>(planes.data());
+
+	for (int round = 0; round < 2000; ++round) {
+		randomise_registers(rng);
+		for (auto &p : planes)
+			p = rng();
+		const auto before = planes;
+
+		const PhysPt start = rng() % 16;
+		const size_t count = rng() % (num_addresses - start);
+		std::vector<uint8_t> data(count);
+		for (auto &b : data)
+			b = static_cast<uint8_t>(rng());
+
+		for (size_t i = 0; i < count; ++i)
+			VGA_PlanarWrite(start + static_cast<PhysPt>(i), data[i]);
+		const auto expected = planes;
+
+		planes = before;
+		VGA_PlanarWriteSpan(start, data.data(), count);
+		ASSERT_EQ(expected, planes)
+		        << "write mode " << static_cast<int>(vga.config.write_mode)
+		        << ", raster op " << static_cast<int>(vga.config.raster_op)
+		        << ", rotate " << static_cast<int>(vga.config.data_rotate)
+		        << ", " << count << " bytes from " << start;
+	}
+	vga.mem.linear = saved_linear;
+}
+
+// Where the string instructions run from and read their source
+constexpr uint16_t code_segment = 0x2000;
+constexpr uint16_t source_segment = 0x3000;
+
+// Bytes of planar memory behind the 64 KiB window at A000
+constexpr size_t window_bytes = 0x10000 * 4;
+
+struct RepString {
+	const char *name;
+	std::vector<uint8_t> code;
+	uint16_t size;
+	bool movs;
+};
+
+// Runs the code from code_segment:0 up to the jump to itself after it
+void run_code(const std::vector<uint8_t> &code)
+{
+	const auto end = static_cast<uint16_t>(code.size());
+	for (uint16_t i = 0; i < end; ++i)
+		mem_writeb(PhysMake(code_segment, i), code[i]);
+	mem_writeb(PhysMake(code_segment, end), 0xeb); // JMP $
+	mem_writeb(PhysMake(code_segment, end + 1), 0xfe);
+
+	SegSet16(cs, code_segment);
+	reg_eip = 0;
+	while (reg_eip != end) {
+		CPU_Cycles = 0x20000;
+		(*cpudecoder)();
+	}
+}
+
+// Forward REP STOS and REP MOVS into an unchained page take the span path,
+// which has to leave video memory and the registers as writing each element
+// would, across pages, through a page not yet in the TLB, and when the
+// 16-bit index wraps
+TEST_F(VgaMemoryTest, RepStringsMatchPerElementWrites)
+{
+	vga.mode = M_VGA;
+	vga.config.chained = false;
+	vga.gfx.miscellaneous = 0x05; // graphics at A000 for 64 KiB
+	auto &config = vga.config;
+	config.write_mode = 0;
+	config.raster_op = 0;
+	config.data_rotate = 0;
+	config.full_bit_mask = 0xffffffff;
+	config.full_map_mask = fill_planes(0xb);
+	config.full_not_map_mask = ~config.full_map_mask;
+	config.full_enable_set_reset = 0;
+	config.full_not_enable_set_reset = 0xffffffff;
+
+	std::mt19937 rng(2021);
+	for (uint32_t i = 0; i < 0x10000; ++i)
+		mem_writeb(PhysMake(source_segment, static_cast<uint16_t>(i)),
+		           static_cast<uint8_t>(rng()));
+	for (size_t i = 0; i < window_bytes; ++i)
+		vga.mem.linear[i] = static_cast<uint8_t>(rng());
+	const std::vector<uint8_t> planes_before(vga.mem.linear,
+	                                         vga.mem.linear + window_bytes);
+
+	// CLD, then the REP string instruction
+	const RepString instructions[] = {
+	        {"REP STOSB", {0xfc, 0xf3, 0xaa}, 1, false},
+	        {"REP STOSW", {0xfc, 0xf3, 0xab}, 2, false},
+	        {"REP STOSD", {0xfc, 0x66, 0xf3, 0xab}, 4, false},
+	        {"REP MOVSB", {0xfc, 0xf3, 0xa4}, 1, true},
+	        {"REP MOVSW", {0xfc, 0xf3, 0xa5}, 2, true},
+	        {"REP MOVSD", {0xfc, 0x66, 0xf3, 0xa5}, 4, true},
+	};
+	// Destination and source offsets, and bytes to write: across several
+	// pages with elements split by them, and across the index wrap
+	const struct {
+		uint16_t di;
+		uint16_t si;
+		uint32_t bytes;
+	} runs[] = {
+	        {0x0ff9, 0x1ffd, 0x2c01},
+	        {0x3000, 0x5000, 0x1000},
+	        {0xfff3, 0xffe9, 0x1031},
+	};
+
+	for (const auto &instruction : instructions) {
+		for (const auto &run : runs) {
+			const auto count = run.bytes / instruction.size;
+			constexpr uint32_t fill = 0x5a3cc381;
+
+			std::copy(planes_before.begin(), planes_before.end(),
+			          vga.mem.linear);
+			VGA_SetupHandlers();
+			SegSet16(es, 0xa000);
+			SegSet16(ds, source_segment);
+			reg_edi = run.di;
+			reg_esi = run.si;
+			reg_ecx = count;
+			reg_eax = fill;
+			run_code(instruction.code);
+			const std::vector<uint8_t> planes(vga.mem.linear,
+			                                  vga.mem.linear + window_bytes);
+			const auto di = reg_edi;
+			const auto si = reg_esi;
+
+			// The same writes an element at a time
+			std::copy(planes_before.begin(), planes_before.end(),
+			          vga.mem.linear);
+			VGA_SetupHandlers();
+			uint16_t expected_di = run.di;
+			uint16_t expected_si = run.si;
+			for (uint32_t i = 0; i < count; ++i) {
+				const auto dst = PhysMake(0xa000, expected_di);
+				const auto src = PhysMake(source_segment, expected_si);
+				switch (instruction.size) {
+				case 1:
+					mem_writeb(dst, instruction.movs ? mem_readb(src)
+					                                 : static_cast<uint8_t>(fill));
+					break;
+				case 2:
+					mem_writew(dst, instruction.movs ? mem_readw(src)
+					                                 : static_cast<uint16_t>(fill));
+					break;
+				default:
+					mem_writed(dst, instruction.movs ? mem_readd(src) : fill);
+					break;
+				}
+				expected_di = static_cast<uint16_t>(expected_di + instruction.size);
+				if (instruction.movs)
+					expected_si = static_cast<uint16_t>(expected_si + instruction.size);
+			}
+			const std::vector<uint8_t> expected(vga.mem.linear,
+			                                    vga.mem.linear + window_bytes);
+
+			EXPECT_EQ(di, expected_di) << instruction.name << " to " << run.di;
+			EXPECT_EQ(si, expected_si) << instruction.name << " to " << run.di;
+			EXPECT_EQ(reg_ecx, 0u) << instruction.name << " to " << run.di;
+			ASSERT_TRUE(planes == expected)
+			        << instruction.name << " of " << count
+			        << " elements to " << run.di;
+		}
+	}
+}
+
+} // namespace
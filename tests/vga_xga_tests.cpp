@@ -0,0 +1,168 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "vga.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+extern void XGA_Write(io_port_t port, io_val_t value, io_width_t width);
+
+namespace {
+
+constexpr uint16_t screen_width = 160;
+constexpr int screen_height = 100;
+
+constexpr uint32_t draw_rectangle = 2 << 13;
+constexpr uint32_t blit_rectangle = 6 << 13;
+constexpr uint32_t draw_pattern = 7 << 13;
+
+int bytes_per_pixel(const VGAModes mode)
+{
+	switch (mode) {
+	case M_LIN8: return 1;
+	case M_LIN15:
+	case M_LIN16: return 2;
+	default: return 4;
+	}
+}
+
+uint32_t random_mix(std::mt19937 &rng)
+{
+	// Background or foreground colour, or bitmap data, as the source
+	constexpr uint32_t sources[] = {0x00, 0x20, 0x60};
+	return sources[rng() % 3] | (rng() & 0xf);
+}
+
+// Mostly on screen with some runs past its edges and video memory
+uint32_t random_coordinate(std::mt19937 &rng, const int limit)
+{
+	return rng() % (limit + limit / 4);
+}
+
+// Sets up and runs a random rectangle, blit, or pattern command through the
+// packed MMIO registers
+void run_command(std::mt19937 &rng)
+{
+	// Sometimes carry on from where the last rectangle left off
+	const uint32_t curx = random_coordinate(rng, screen_width);
+	const uint32_t cury = random_coordinate(rng, screen_height);
+	if (rng() % 4)
+		XGA_Write(0x8100, (curx << 16) | cury, io_width_t::dword);
+
+	// Now and then blit within the same rows, overlapping the source
+	uint32_t destx = random_coordinate(rng, screen_width);
+	uint32_t desty = random_coordinate(rng, screen_height);
+	if (rng() % 4 == 0) {
+		destx = curx + rng() % 9 - 4;
+		desty = cury;
+	}
+	XGA_Write(0x8108, (destx << 16) | desty, io_width_t::dword);
+
+	XGA_Write(0x8120, rng(), io_width_t::dword);
+	XGA_Write(0x8124, rng(), io_width_t::dword);
+	XGA_Write(0x8134, (random_mix(rng) << 16) | random_mix(rng), io_width_t::dword);
+
+	// Scissors that are usually the whole screen but sometimes clip
+	const bool clip = rng() % 3 == 0;
+	const uint32_t x1 = clip ? rng() % screen_width : 0;
+	const uint32_t y1 = clip ? rng() % screen_height : 0;
+	const uint32_t x2 = clip ? x1 + rng() % screen_width : 0xfff;
+	const uint32_t y2 = clip ? y1 + rng() % screen_height : 0xfff;
+	XGA_Write(0x8138, (x1 << 16) | y1, io_width_t::dword);
+	XGA_Write(0x813c, (x2 << 16) | y2, io_width_t::dword);
+
+	// Mostly the foreground mix, otherwise the video memory selects it
+	const uint32_t mix_select = rng() % 4 ? 0x00 : 0xc0;
+	XGA_Write(0x8140, mix_select, io_width_t::word);
+
+	const uint32_t major = rng() % 64;
+	const uint32_t minor = rng() % 32;
+	XGA_Write(0x8148, (major << 16) | minor, io_width_t::dword);
+
+	constexpr uint32_t commands[] = {draw_rectangle, blit_rectangle, draw_pattern};
+	const uint32_t enable = rng() % 16 ? 0x11 : 0x00;
+	const uint32_t direction = (rng() % 2 ? 0x20 : 0) | (rng() % 2 ? 0x80 : 0);
+	const uint32_t skip_last_pixel = rng() % 2 ? 0x04 : 0;
+	XGA_Write(0x8118, commands[rng() % 3] | enable | direction | skip_last_pixel,
+	          io_width_t::word);
+}
+
+class VgaXgaTest : public ::testing::Test {
+public:
+	void SetUp() override
+	{
+		saved_linear = vga.mem.linear;
+		saved_vmemsize = vga.vmemsize;
+		saved_width = vga.s3.xga_screen_width;
+		saved_mode = vga.s3.xga_color_mode;
+		vga.s3.xga_screen_width = screen_width;
+	}
+
+	void TearDown() override
+	{
+		XGA_SetBulkDraw(true);
+		vga.mem.linear = saved_linear;
+		vga.vmemsize = saved_vmemsize;
+		vga.s3.xga_screen_width = saved_width;
+		vga.s3.xga_color_mode = saved_mode;
+	}
+
+private:
+	uint8_t *saved_linear = nullptr;
+	Bit32u saved_vmemsize = 0;
+	uint16_t saved_width = 0;
+	VGAModes saved_mode = {};
+};
+
+TEST_F(VgaXgaTest, BulkDrawMatchesPerPixel)
+{
+	for (const auto mode : {M_LIN8, M_LIN15, M_LIN16, M_LIN32}) {
+		vga.s3.xga_color_mode = mode;
+		const auto size = screen_width * screen_height * bytes_per_pixel(mode);
+		// Leave the last rows outside video memory
+		vga.vmemsize = size - screen_width * bytes_per_pixel(mode) * 3;
+
+		for (int round = 0; round < 50; ++round) {
+			std::mt19937 fill_rng(round);
+			std::vector<uint8_t> start(size);
+			for (auto &b : start)
+				b = static_cast<uint8_t>(fill_rng());
+
+			std::vector<uint8_t> results[2];
+			for (const bool bulk : {false, true}) {
+				auto &memory = results[bulk];
+				memory = start;
+				vga.mem.linear = memory.data();
+				XGA_SetBulkDraw(bulk);
+				XGA_Write(0x8100, 0, io_width_t::dword);
+				std::mt19937 rng(round);
+				for (int command = 0; command < 40; ++command)
+					run_command(rng);
+			}
+			ASSERT_TRUE(results[0] == results[1])
+			        << "mode " << static_cast<int>(mode) << ", round " << round;
+		}
+	}
+}
+
+} // namespace
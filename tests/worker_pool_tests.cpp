@@ -0,0 +1,85 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+
+#include "worker_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+namespace {
+
+TEST(WorkerPool, RunsEachJobOnce)
+{
+	WorkerPool pool(4, "test");
+	EXPECT_EQ(pool.NumThreads(), 4);
+
+	std::vector<int> runs(37);
+	for (int batch = 0; batch < 500; ++batch)
+		pool.Run(static_cast<int>(runs.size()), [&](const int job) {
+			++runs[job];
+		});
+
+	for (const auto count : runs)
+		EXPECT_EQ(count, 500);
+}
+
+TEST(WorkerPool, WaitsForAllJobs)
+{
+	WorkerPool pool(3, "test");
+	std::atomic<int> finished = {0};
+	for (int batch = 1; batch <= 200; ++batch) {
+		pool.Run(batch % 7 + 1, [&](int) {
+			std::this_thread::yield();
+			++finished;
+		});
+		// Nothing can still be running once Run returns
+		const auto expected = finished.load();
+		std::this_thread::yield();
+		EXPECT_EQ(finished.load(), expected);
+	}
+}
+
+TEST(WorkerPool, SingleThreadRunsInline)
+{
+	WorkerPool pool(1, "test");
+	EXPECT_EQ(pool.NumThreads(), 1);
+
+	const auto caller = std::this_thread::get_id();
+	int runs = 0;
+	pool.Run(5, [&](int) {
+		EXPECT_EQ(std::this_thread::get_id(), caller);
+		++runs;
+	});
+	EXPECT_EQ(runs, 5);
+	pool.Run(0, [&](int) { ++runs; });
+	EXPECT_EQ(runs, 5);
+}
+
+TEST(WorkerPool, DefaultNumThreads)
+{
+	EXPECT_EQ(WorkerPool::DefaultNumThreads(1), 1);
+	EXPECT_GE(WorkerPool::DefaultNumThreads(8), 1);
+	EXPECT_LE(WorkerPool::DefaultNumThreads(8), 8);
+}
+
+} // namespace
@@ -0,0 +1,249 @@
+/*
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ *  Copyright (C) 2021-2021  The DOSBox Staging Team
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "dosbox.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "worker_pool.h"
+
+#if C_SSHOT
+
+#include "../src/libs/zmbv/zmbv.h"
+
+namespace {
+
+struct Clip {
+	int width = 0;
+	int height = 0;
+	int pixel_size = 0;
+	ZMBV_FORMAT format = ZMBV_FORMAT::NONE;
+	std::vector<std::vector<uint8_t>> frames = {};
+	std::vector<std::vector<uint8_t>> palettes = {};
+};
+
+// Frames that scroll by a few pixels and have a few rectangles redrawn, so
+// the motion search finds both moved and changed blocks
+Clip make_clip(const int width, const int height, const int pixel_size,
+               const ZMBV_FORMAT format, const int num_frames)
+{
+	std::mt19937 rng(2021);
+	Clip clip = {width, height, pixel_size, format, {}, {}};
+	const int pitch = width * pixel_size;
+	std::vector<uint8_t> image(pitch * height);
+	for (auto &b : image)
+		b = static_cast<uint8_t>(rng());
+	std::vector<uint8_t> palette(256 * 4);
+	for (auto &b : palette)
+		b = static_cast<uint8_t>(rng());
+
+	for (int f = 0; f < num_frames; ++f) {
+		const int scroll = (rng() % 7) * pixel_size;
+		std::vector<uint8_t> next(image.size());
+		for (int y = 0; y < height; ++y) {
+			const auto row = image.begin() + ((y + 1) % height) * pitch;
+			std::rotate_copy(row, row + scroll, row + pitch,
+			                 next.begin() + y * pitch);
+		}
+		for (int r = 0; r < 4; ++r) {
+			const int x0 = rng() % pitch;
+			const int y0 = rng() % height;
+			const int x1 = std::min(pitch, x0 + 1 + static_cast<int>(rng() % 64));
+			const int y1 = std::min(height, y0 + 1 + static_cast<int>(rng() % 32));
+			for (int y = y0; y < y1; ++y)
+				for (int x = x0; x < x1; ++x)
+					next[y * pitch + x] = static_cast<uint8_t>(rng());
+		}
+		image = next;
+		if (rng() % 4 == 0)
+			palette[(rng() % 256) * 4] ^= 0xff;
+		clip.frames.push_back(image);
+		clip.palettes.push_back(palette);
+	}
+	return clip;
+}
+
+// Frames that look more like a game than noise: a scrolling background of
+// few-coloured tiles with some sprites moving over it
+Clip make_scene(const int width, const int height, const int pixel_size,
+                const ZMBV_FORMAT format, const int num_frames)
+{
+	std::mt19937 rng(2021);
+	Clip clip = {width, height, pixel_size, format, {}, {}};
+	const int pitch = width * pixel_size;
+	std::vector<uint32_t> colours(16);
+	for (auto &c : colours)
+		c = rng();
+	constexpr int tile_size = 24;
+	std::vector<std::vector<uint8_t>> tiles(8);
+	for (auto &tile : tiles) {
+		tile.resize(tile_size * tile_size);
+		for (auto &t : tile)
+			t = static_cast<uint8_t>(rng() % 3 ? 0 : rng() % 16);
+	}
+	struct Sprite {
+		int x, y, dx, dy;
+		uint8_t colour;
+	};
+	std::vector<Sprite> sprites(6);
+	for (auto &s : sprites)
+		s = {static_cast<int>(rng() % width), static_cast<int>(rng() % height),
+		     static_cast<int>(rng() % 5) - 2, static_cast<int>(rng() % 5) - 2,
+		     static_cast<uint8_t>(rng() % 16)};
+	const std::vector<uint8_t> palette(256 * 4, 0x55);
+
+	const auto put = [&](std::vector<uint8_t> &image, const int x,
+	                     const int y, const uint8_t index) {
+		const uint32_t c = colours[index];
+		std::copy_n(reinterpret_cast<const uint8_t *>(&c), pixel_size,
+		            image.begin() + y * pitch + x * pixel_size);
+	};
+	for (int f = 0; f < num_frames; ++f) {
+		std::vector<uint8_t> image(pitch * height);
+		const int scroll = f * 2;
+		for (int y = 0; y < height; ++y)
+			for (int x = 0; x < width; ++x) {
+				const int tx = (x + scroll) / tile_size;
+				const int ty = y / tile_size;
+				const auto &tile = tiles[(tx * 7 + ty * 3) % tiles.size()];
+				put(image, x, y,
+				    tile[(y % tile_size) * tile_size + (x + scroll) % tile_size]);
+			}
+		for (auto &s : sprites) {
+			s.x = (s.x + s.dx + width) % width;
+			s.y = (s.y + s.dy + height) % height;
+			for (int y = s.y; y < std::min(height, s.y + 32); ++y)
+				for (int x = s.x; x < std::min(width, s.x + 32); ++x)
+					put(image, x, y, static_cast<uint8_t>(s.colour + (x ^ y) % 2));
+		}
+		clip.frames.push_back(image);
+		clip.palettes.push_back(palette);
+	}
+	return clip;
+}
+
+// Compresses the clip with a key frame every tenth frame, like the capture
+std::vector<std::vector<uint8_t>> compress(const Clip &clip, WorkerPool *pool,
+                                           const bool simd = true)
+{
+	VideoCodec codec;
+	EXPECT_TRUE(codec.SetupCompress(clip.width, clip.height));
+	codec.SetSIMD(simd);
+	if (pool)
+		codec.SetParallelFor([pool](const int num_jobs,
+		                            const WorkerPool::job_f &job) {
+			pool->Run(num_jobs, job);
+		});
+	const auto size = codec.NeededSize(clip.width, clip.height, clip.format);
+	std::vector<std::vector<uint8_t>> compressed;
+	for (size_t f = 0; f < clip.frames.size(); ++f) {
+		std::vector<uint8_t> buf(size);
+		const int flags = f % 10 == 0 ? 1 : 0;
+		EXPECT_TRUE(codec.PrepareCompressFrame(flags, clip.format,
+		                                       clip.palettes[f].data(),
+		                                       buf.data(), size));
+		for (int y = 0; y < clip.height; ++y) {
+			const uint8_t *line = clip.frames[f].data() +
+			                      y * clip.width * clip.pixel_size;
+			codec.CompressLines(1, &line);
+		}
+		buf.resize(codec.FinishCompressFrame());
+		compressed.push_back(buf);
+	}
+	codec.FinishVideo();
+	return compressed;
+}
+
+TEST(Zmbv, ParallelMotionSearchKeepsBitstream)
+{
+	WorkerPool pool(4, "test:zmbv");
+	const std::vector<Clip> clips = {
+	        make_clip(320, 200, 1, ZMBV_FORMAT::BPP_8, 24),
+	        make_clip(320, 240, 2, ZMBV_FORMAT::BPP_16, 12),
+	        make_clip(641, 479, 4, ZMBV_FORMAT::BPP_32, 12),
+	};
+	for (const auto &clip : clips) {
+		const auto expected = compress(clip, nullptr);
+		const auto actual = compress(clip, &pool);
+		ASSERT_EQ(expected.size(), actual.size());
+		for (size_t f = 0; f < expected.size(); ++f)
+			EXPECT_TRUE(expected[f] == actual[f])
+			        << clip.width << "x" << clip.height << " frame " << f;
+	}
+}
+
+TEST(Zmbv, SIMDMotionSearchKeepsBitstream)
+{
+	if (!VideoCodec().SetSIMD(true))
+		GTEST_SKIP() << "No SIMD support in this build";
+	const std::vector<Clip> clips = {
+	        make_clip(327, 203, 1, ZMBV_FORMAT::BPP_8, 24),
+	        make_clip(320, 240, 2, ZMBV_FORMAT::BPP_16, 12),
+	        make_clip(641, 479, 4, ZMBV_FORMAT::BPP_32, 12),
+	};
+	for (const auto &clip : clips) {
+		const auto expected = compress(clip, nullptr, false);
+		const auto actual = compress(clip, nullptr, true);
+		ASSERT_EQ(expected.size(), actual.size());
+		for (size_t f = 0; f < expected.size(); ++f)
+			EXPECT_TRUE(expected[f] == actual[f])
+			        << clip.width << "x" << clip.height << " frame " << f;
+	}
+}
+
+// Reports how many frames per second each path compresses on one thread
+TEST(Zmbv, DISABLED_BenchmarkFramesPerSecond)
+{
+	constexpr int num_frames = 30;
+	const bool has_simd = VideoCodec().SetSIMD(true);
+	const std::vector<Clip> clips = {
+	        make_scene(640, 480, 1, ZMBV_FORMAT::BPP_8, num_frames),
+	        make_scene(640, 480, 2, ZMBV_FORMAT::BPP_16, num_frames),
+	        make_scene(640, 480, 4, ZMBV_FORMAT::BPP_32, num_frames),
+	};
+	for (const auto &clip : clips) {
+		std::vector<std::vector<uint8_t>> outputs[2];
+		for (const bool simd : {false, true}) {
+			if (simd && !has_simd)
+				break;
+			using namespace std::chrono;
+			const auto start = steady_clock::now();
+			outputs[simd] = compress(clip, nullptr, simd);
+			const duration<double> elapsed = steady_clock::now() - start;
+			std::cout << clip.pixel_size * 8 << " bpp "
+			          << (simd ? "SIMD  " : "scalar") << ": "
+			          << num_frames / elapsed.count() << " frames/s\n";
+		}
+		if (has_simd) {
+			EXPECT_TRUE(outputs[0] == outputs[1])
+			        << clip.pixel_size * 8 << " bpp bitstreams differ";
+		}
+	}
+}
+
+} // namespace
+
+#endif